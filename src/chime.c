@@ -0,0 +1,133 @@
+#include <pebble.h>
+#include "settings.h"
+#include "night_mode.h"
+#include "power_policy.h"
+#include "chime.h"
+
+time_t Chime_nextTime;
+
+// the seconds between chimes that Chime_nextTime was scheduled with
+static int scheduledInterval;
+
+// the pulses used to count the hours
+#define CHIME_COUNT_PULSE_MS 150
+#define CHIME_COUNT_GAP_MS   250
+
+static uint32_t countSegments[12 * 2 - 1];
+
+static int chimeInterval() {
+  if(globalSettings.hourlyVibe == 1) {        // hourly vibes only
+    return SECONDS_PER_HOUR;
+  } else if(globalSettings.hourlyVibe == 2) { // hourly and half-hourly
+    return SECONDS_PER_HOUR / 2;
+  }
+
+  return 0;
+}
+
+// the first chime strictly after the given time, on the local clock
+static time_t nextChimeAfter(time_t t, int interval) {
+  struct tm* timeInfo = localtime(&t);
+  int intoHour = timeInfo->tm_min * SECONDS_PER_MINUTE + timeInfo->tm_sec;
+
+  return t + interval - intoHour % interval;
+}
+
+void Chime_schedule() {
+  scheduledInterval = chimeInterval();
+
+  Chime_nextTime = (scheduledInterval > 0) ? nextChimeAfter(time(NULL), scheduledInterval) : 0;
+}
+
+bool Chime_isQuiet(time_t t) {
+  if(quiet_time_is_active() || NightMode_isActive || !PowerPolicy_current->allowChimes) {
+    return true;
+  }
+
+  int start = globalSettings.quietHoursStart;
+  int end = globalSettings.quietHoursEnd;
+
+  // the same start and end hour means there are no quiet hours
+  if(start == end) {
+    return false;
+  }
+
+  int hour = localtime(&t)->tm_hour;
+
+  // the quiet hours may run past midnight
+  if(start < end) {
+    return hour >= start && hour < end;
+  } else {
+    return hour >= start || hour < end;
+  }
+}
+
+static void countHours(int hour) {
+  int pulses = hour % 12;
+
+  if(pulses == 0) {
+    pulses = 12;
+  }
+
+  for(int i = 0; i < pulses * 2 - 1; i++) {
+    countSegments[i] = (i % 2 == 0) ? CHIME_COUNT_PULSE_MS : CHIME_COUNT_GAP_MS;
+  }
+
+  VibePattern pat = {
+    .durations = countSegments,
+    .num_segments = pulses * 2 - 1,
+  };
+  vibes_enqueue_custom_pattern(pat);
+}
+
+static void vibrate(time_t t) {
+  struct tm* timeInfo = localtime(&t);
+  bool isHour = timeInfo->tm_min < 30;
+
+  switch(globalSettings.chimePattern) {
+    case CHIME_PATTERN_SHORT:
+      vibes_short_pulse();
+      break;
+    case CHIME_PATTERN_LONG:
+      vibes_long_pulse();
+      break;
+    case CHIME_PATTERN_COUNT_HOURS:
+      if(isHour) {
+        countHours(timeInfo->tm_hour);
+      } else {
+        vibes_short_pulse();
+      }
+      break;
+    default:
+      // only the half-hourly chimes tell the hour apart
+      if(isHour && globalSettings.hourlyVibe == 2) {
+        vibes_double_pulse();
+      } else {
+        vibes_short_pulse();
+      }
+      break;
+  }
+}
+
+void Chime_update(time_t now) {
+  if(Chime_nextTime == 0) {
+    return;
+  }
+
+  if(now < Chime_nextTime) {
+    // the clock was set back: the next chime is earlier than planned
+    if(Chime_nextTime - now > scheduledInterval) {
+      Chime_nextTime = nextChimeAfter(now, scheduledInterval);
+    }
+
+    return;
+  }
+
+  // a chime more than a minute late means the clock was set forward past
+  // it, and it isn't worth buzzing for
+  if(now - Chime_nextTime < SECONDS_PER_MINUTE && !Chime_isQuiet(Chime_nextTime)) {
+    vibrate(Chime_nextTime);
+  }
+
+  Chime_nextTime = nextChimeAfter(now, scheduledInterval);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * The hourly and half-hourly vibrations. The time of the next chime is
+ * worked out once, when the settings change or a chime goes off, so that
+ * the tick handler only has to compare it with the current time.
+ */
+
+typedef enum {
+  CHIME_PATTERN_STANDARD    = 0, // a double pulse on the hour, a short one on the half hour
+  CHIME_PATTERN_SHORT       = 1, // a short pulse every time
+  CHIME_PATTERN_LONG        = 2, // a long pulse every time
+  CHIME_PATTERN_COUNT_HOURS = 3  // one pulse per hour on the hour (12-hour), one on the half hour
+} ChimePattern;
+
+// the time of the next chime, or 0 if the chimes are off
+extern time_t Chime_nextTime;
+
+/*
+ * Works out when the next chime is due from the current settings. Call it
+ * at launch and whenever the settings change
+ */
+void Chime_schedule();
+
+/*
+ * Vibrates if a chime is due (and it isn't quiet time), then schedules the
+ * next one. Cheap enough to call on every tick
+ */
+void Chime_update(time_t now);
+
+// returns true if chimes should be silent at the given time (or in night
+// mode, or on a critical battery)
+bool Chime_isQuiet(time_t t);
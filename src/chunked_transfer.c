@@ -0,0 +1,136 @@
+#include <pebble.h>
+#include "chunked_transfer.h"
+#include "messaging.h"
+#include "weather.h"
+
+// how far each stream's latest transfer got
+typedef struct {
+  uint16_t id;
+  uint32_t length;
+  uint32_t received;
+} TransferState;
+
+static TransferState transfers[TRANSFER_STREAM_COUNT];
+
+static bool finishHourlyForecast(uint32_t length) {
+  if(!Weather_finishHourlyData(length)) {
+    return false;
+  }
+
+  Weather_saveHourlyData();
+  return true;
+}
+
+// indexed by stream
+static const ChunkedTransferSink sinks[TRANSFER_STREAM_COUNT] = {
+  [TRANSFER_STREAM_HOURLY_FORECAST] = {
+    Weather_beginHourlyData, Weather_writeHourlyData, finishHourlyForecast, MESSAGE_CHANGED_WEATHER
+  }
+};
+
+// the phone may send numbers in fewer bytes than they were written with
+static uint32_t tupleUint(const Tuple* tuple) {
+  switch(tuple->length) {
+    case 1:
+      return tuple->value->uint8;
+    case 2:
+      return tuple->value->uint16;
+    default:
+      return tuple->value->uint32;
+  }
+}
+
+static bool isUnfinished(const TransferState* transfer) {
+  return transfer->id != 0 && transfer->received < transfer->length;
+}
+
+static void writeResume(DictionaryIterator* iterator, int stream) {
+  dict_write_uint8(iterator, KEY_CHUNK_STREAM, stream);
+  dict_write_uint16(iterator, KEY_CHUNK_ID, transfers[stream].id);
+  dict_write_uint32(iterator, KEY_CHUNK_OFFSET, transfers[stream].received);
+}
+
+// asks the phone to carry on from the next chunk the stream needs
+static void requestResume(int stream) {
+  DictionaryIterator *iter;
+
+  // if a message is on its way, the next weather request asks instead
+  if(app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    return;
+  }
+
+  writeResume(iter, stream);
+  app_message_outbox_send();
+}
+
+uint32_t ChunkedTransfer_receive(DictionaryIterator* iterator) {
+  Tuple *stream_tuple = dict_find(iterator, KEY_CHUNK_STREAM);
+  Tuple *id_tuple = dict_find(iterator, KEY_CHUNK_ID);
+  Tuple *offset_tuple = dict_find(iterator, KEY_CHUNK_OFFSET);
+  Tuple *length_tuple = dict_find(iterator, KEY_CHUNK_LENGTH);
+  Tuple *data_tuple = dict_find(iterator, KEY_CHUNK_DATA);
+
+  if(!stream_tuple || !id_tuple || !offset_tuple || !length_tuple || !data_tuple) {
+    return 0;
+  }
+
+  uint32_t stream = tupleUint(stream_tuple);
+  uint16_t id = tupleUint(id_tuple);
+  uint32_t offset = tupleUint(offset_tuple);
+  uint32_t length = tupleUint(length_tuple);
+
+  if(stream >= TRANSFER_STREAM_COUNT || id == 0 || data_tuple->length == 0) {
+    return 0;
+  }
+
+  const ChunkedTransferSink* sink = &sinks[stream];
+  TransferState* transfer = &transfers[stream];
+
+  // a new transfer replaces whatever was left of the last one
+  if(id != transfer->id || length != transfer->length) {
+    if(!sink->begin(length)) {
+      return 0;
+    }
+
+    transfer->id = id;
+    transfer->length = length;
+    transfer->received = 0;
+  }
+
+  // a chunk we already have, sent again because its acknowledgement was lost
+  if(offset < transfer->received || transfer->received == transfer->length) {
+    return 0;
+  }
+
+  // chunks went missing in between
+  if(offset > transfer->received) {
+    requestResume(stream);
+    return 0;
+  }
+
+  uint32_t chunkLength = data_tuple->length;
+
+  if(chunkLength > length - offset) {
+    chunkLength = length - offset;
+  }
+
+  sink->write(offset, data_tuple->value->data, chunkLength);
+  transfer->received += chunkLength;
+
+  if(transfer->received < transfer->length || !sink->finish(length)) {
+    return 0;
+  }
+
+  return sink->changes;
+}
+
+bool ChunkedTransfer_writeResume(DictionaryIterator* iterator) {
+  for(int stream = 0; stream < TRANSFER_STREAM_COUNT; stream++) {
+    if(isUnfinished(&transfers[stream])) {
+      writeResume(iterator, stream);
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * Data too large for one AppMessage comes from the phone in chunks. Every
+ * chunk message says which transfer it belongs to and where it goes:
+ *
+ * KEY_CHUNK_STREAM  uint8, what the data is (a TransferStream)
+ * KEY_CHUNK_ID      uint16, which transfer on the stream; a new one replaces
+ *                   the transfer in progress
+ * KEY_CHUNK_OFFSET  uint32, where in the transfer the chunk starts, which is
+ *                   also its sequence number
+ * KEY_CHUNK_LENGTH  uint32, the length of the whole transfer
+ * KEY_CHUNK_DATA    the chunk itself
+ *
+ * The phone sends a chunk once the one before it was acknowledged. Each chunk
+ * is handed to the stream's sink as it arrives, and the sink decodes it
+ * straight into wherever the data ends up, so a transfer is never held in
+ * memory whole. A chunk that already arrived is ignored. If one went missing,
+ * or the transfer broke off, the watch sends back the stream, the id and the
+ * offset it expects next, and the phone picks up from there.
+ */
+
+typedef enum {
+  TRANSFER_STREAM_HOURLY_FORECAST = 0,
+
+  TRANSFER_STREAM_COUNT
+} TransferStream;
+
+typedef struct {
+  // a transfer of the given length starts; returns false to refuse it
+  bool (*begin)(uint32_t length);
+
+  // decodes a chunk; chunks come in order, without gaps or overlaps
+  void (*write)(uint32_t offset, const uint8_t* data, uint16_t length);
+
+  // the whole transfer arrived; returns true if it was applied
+  bool (*finish)(uint32_t length);
+
+  // what an applied transfer changed, as passed to the messaging callback
+  uint32_t changes;
+} ChunkedTransferSink;
+
+/*
+ * Handles the chunk in a message, if it has one. Returns what the message
+ * changed, which is nothing until a transfer is complete
+ */
+uint32_t ChunkedTransfer_receive(DictionaryIterator* iterator);
+
+/*
+ * Adds where to pick up an unfinished transfer to an outgoing message.
+ * Returns false if there is nothing to resume
+ */
+bool ChunkedTransfer_writeResume(DictionaryIterator* iterator);
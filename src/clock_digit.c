@@ -1,7 +1,8 @@
 #include <pebble.h>
 #include "clock_digit.h"
+#include "clock_glyphs.h"
 
-void adjustImagePalette(ClockDigit* this);
+void adjustImagePalette(ClockDigit* this, GBitmap* image, int fontId);
 
 /*
  * Array mapping numbers to resource ids
@@ -39,43 +40,105 @@ uint32_t ClockDigit_imageIds[3][10] = {
    RESOURCE_ID_CLOCK_DIGIT_BOLD_9}
 };
 
+/*
+ * The vector font: each digit is a list of strokes on a 9x13 grid, drawn as
+ * thick lines scaled to the digit's box. Points are packed as (x << 4) | y;
+ * VECTOR_STROKE_END ends a stroke and VECTOR_GLYPH_END the digit
+ */
+#define VECTOR_GRID_WIDTH  8
+#define VECTOR_GRID_HEIGHT 12
+#define VECTOR_STROKE_END  0xF0
+#define VECTOR_GLYPH_END   0xFF
+#define P(x, y) (((x) << 4) | (y))
+
+static const uint8_t vectorGlyphs[10][24] = {
+  {P(2,0), P(6,0), P(8,2), P(8,10), P(6,12), P(2,12), P(0,10), P(0,2), P(2,0), VECTOR_GLYPH_END},
+  {P(2,2), P(5,0), P(5,12), VECTOR_GLYPH_END},
+  {P(0,2), P(2,0), P(6,0), P(8,2), P(8,4), P(0,12), P(8,12), VECTOR_GLYPH_END},
+  {P(0,2), P(2,0), P(6,0), P(8,2), P(8,4), P(6,6), P(3,6), VECTOR_STROKE_END,
+   P(6,6), P(8,8), P(8,10), P(6,12), P(2,12), P(0,10), VECTOR_GLYPH_END},
+  {P(6,12), P(6,0), P(0,8), P(8,8), VECTOR_GLYPH_END},
+  {P(8,0), P(1,0), P(0,5), P(6,5), P(8,7), P(8,10), P(6,12), P(2,12), P(0,10), VECTOR_GLYPH_END},
+  {P(7,0), P(4,0), P(0,4), P(0,10), P(2,12), P(6,12), P(8,10), P(8,7), P(6,5), P(2,5), P(0,7),
+   VECTOR_GLYPH_END},
+  {P(0,0), P(8,0), P(3,12), VECTOR_GLYPH_END},
+  {P(2,6), P(0,4), P(0,2), P(2,0), P(6,0), P(8,2), P(8,4), P(6,6), P(2,6), P(0,8), P(0,10), P(2,12),
+   P(6,12), P(8,10), P(8,8), P(6,6), VECTOR_GLYPH_END},
+  {P(1,12), P(4,12), P(8,8), P(8,2), P(6,0), P(2,0), P(0,2), P(0,5), P(2,7), P(6,7), P(8,5),
+   VECTOR_GLYPH_END}
+};
+
+#undef P
+
 void ClockDigit_setNumber(ClockDigit* this, int number, int fontId) {
 
-  if(this->currentNum != number || this->currentFontId != fontId) {
+  // in case the digit was blank, show it again
+  if(this->isBlank) {
+    this->isBlank = false;
+    layer_mark_dirty(this->layer);
+  }
+
+  if(this->currentNum == number && this->currentFontId == fontId) {
+    return;
+  }
+
+  layer_mark_dirty(this->layer);
 
+  if(fontId == FONT_SETTING_VECTOR || ClockGlyphs_getFont(fontId)) {
+    // glyphs need no image; free the one the last font used
+    if(this->currentImage) {
+      gbitmap_destroy(this->currentImage);
+      this->currentImage = NULL;
+    }
+
+    this->currentNum = number;
+    this->currentFontId = fontId;
+  } else {
     //save the old digit image so we can dellocate it
     GBitmap* oldImage = this->currentImage;
 
     //change over to the new digit image
     this->currentImageId = ClockDigit_imageIds[fontId][number];
     this->currentImage = gbitmap_create_with_resource(this->currentImageId);
-    this->currentNum = number;
-    this->currentFontId = fontId;
 
     //set the palette properly
-    adjustImagePalette(this);
+    adjustImagePalette(this, this->currentImage, fontId);
 
-    //set the layer to the new image
-    bitmap_layer_set_bitmap(this->imageLayer, this->currentImage);
+    this->currentNum = number;
+    this->currentFontId = fontId;
 
     //deallocate the old bg image
-    gbitmap_destroy(oldImage);
+    if(oldImage) {
+      gbitmap_destroy(oldImage);
+    }
   }
-
-  // in case the layer was set to hidden, unhide
-  layer_set_hidden((Layer *)this->imageLayer, false);
 }
 
 void ClockDigit_setBlank(ClockDigit* this) {
-  layer_set_hidden((Layer *)this->imageLayer, true);
+  if(!this->isBlank) {
+    this->isBlank = true;
+    layer_mark_dirty(this->layer);
+  }
 }
 
 void ClockDigit_offsetPosition(ClockDigit* this, int posOffset) {
-  layer_set_frame((Layer*)this->imageLayer,
-                  GRect(this->position.x + posOffset, this->position.y, 48, 71));
+  if(this->positionOffset != posOffset) {
+    this->positionOffset = posOffset;
+    layer_mark_dirty(this->layer);
+  }
+}
+
+// where the digit is drawn, in the clock layer's coordinates
+static GRect getFrame(ClockDigit* this) {
+  return GRect(this->position.x + this->positionOffset, this->position.y, 48, 71);
 }
 
 void ClockDigit_setColor(ClockDigit* this, GColor fg, GColor bg) {
+  // the face sets the colors again after every settings change
+  if(gcolor_equal(fg, this->fgColor) && gcolor_equal(bg, this->bgColor)) {
+    return;
+  }
+
   // set the new colors
   this->fgColor = fg;
   this->bgColor = bg;
@@ -96,35 +159,48 @@ void ClockDigit_setColor(ClockDigit* this, GColor fg, GColor bg) {
 
   #endif
 
-  adjustImagePalette(this);
+  // in the same order as the palettes below
+  this->glyphColors[0] = ClockGlyphs_resolveColor(this->fgColor);
+  this->glyphColors[1] = ClockGlyphs_resolveColor(this->midColor1);
+  this->glyphColors[2] = ClockGlyphs_resolveColor(this->midColor2);
+  this->glyphColors[3] = ClockGlyphs_resolveColor(this->bgColor);
+
+  if(this->currentImage) {
+    adjustImagePalette(this, this->currentImage, this->currentFontId);
+  }
+
+  layer_mark_dirty(this->layer);
 }
 
-void ClockDigit_construct(ClockDigit* this, GPoint pos) {
+void ClockDigit_construct(ClockDigit* this, GPoint pos, Layer* layer) {
   this->currentNum = -1;
-  this->bgColor = GColorWhite;
-  this->fgColor = GColorBlack;
+  this->currentFontId = -1;
+  this->currentImage = NULL;
   this->position = pos;
+  this->positionOffset = 0;
+  this->layer = layer;
 
-  this->imageLayer = bitmap_layer_create(GRect(pos.x, pos.y, 48, 71));
+  // nothing is shown (or loaded) until the face sets the number
+  this->isBlank = true;
 
-  ClockDigit_setBlank(this);
-  ClockDigit_setNumber(this, 1, 0);
+  // no color matches these, so the first colors set always take
+  this->bgColor = GColorClear;
+  this->fgColor = GColorClear;
   ClockDigit_setColor(this, GColorBlack, GColorWhite);
 }
 
 void ClockDigit_destruct(ClockDigit* this) {
-  // destroy the background layer
-  bitmap_layer_destroy(this->imageLayer);
-
   // deallocate the background image
-  gbitmap_destroy(this->currentImage);
+  if(this->currentImage) {
+    gbitmap_destroy(this->currentImage);
+  }
 }
 
-void adjustImagePalette(ClockDigit* this) {
-  GColor* pal = gbitmap_get_palette(this->currentImage);
+void adjustImagePalette(ClockDigit* this, GBitmap* image, int fontId) {
+  GColor* pal = gbitmap_get_palette(image);
 
   #ifdef PBL_COLOR
-    if(this->currentFontId == FONT_SETTING_DEFAULT || this->currentFontId == FONT_SETTING_BOLD) {
+    if(fontId == FONT_SETTING_DEFAULT || fontId == FONT_SETTING_BOLD) {
       pal[0] = this->fgColor;
       pal[1] = this->midColor1;
       pal[2] = this->midColor2;
@@ -138,3 +214,63 @@ void adjustImagePalette(ClockDigit* this) {
     pal[1] = this->bgColor;
   #endif
 }
+
+static void drawVectorGlyph(ClockDigit* this, GContext* ctx, GRect bounds) {
+
+  // the strokes are about a sixth of the digit's width; odd widths are drawn best
+  int strokeWidth = (bounds.size.w / 6) | 1;
+  int margin = strokeWidth / 2 + 2;
+  int width = bounds.size.w - margin * 2;
+  int height = bounds.size.h - margin * 2;
+
+  graphics_context_set_stroke_color(ctx, this->fgColor);
+  graphics_context_set_stroke_width(ctx, strokeWidth);
+
+  #ifdef PBL_COLOR
+    graphics_context_set_antialiased(ctx, true);
+  #endif
+
+  const uint8_t* glyph = vectorGlyphs[this->currentNum];
+  GPoint previous = GPointZero;
+  bool isStrokeStart = true;
+
+  for(int i = 0; glyph[i] != VECTOR_GLYPH_END; i++) {
+    if(glyph[i] == VECTOR_STROKE_END) {
+      isStrokeStart = true;
+      continue;
+    }
+
+    GPoint point = GPoint(bounds.origin.x + margin + (glyph[i] >> 4) * width / VECTOR_GRID_WIDTH,
+                          bounds.origin.y + margin + (glyph[i] & 0x0F) * height / VECTOR_GRID_HEIGHT);
+
+    if(!isStrokeStart) {
+      graphics_draw_line(ctx, previous, point);
+    }
+
+    previous = point;
+    isStrokeStart = false;
+  }
+}
+
+void ClockDigit_draw(ClockDigit* this, GContext* ctx) {
+  if(this->isBlank || this->currentNum < 0 || this->currentNum > 9) {
+    return;
+  }
+
+  GRect frame = getFrame(this);
+
+  if(this->currentFontId == FONT_SETTING_VECTOR) {
+    drawVectorGlyph(this, ctx, frame);
+    return;
+  }
+
+  const ClockGlyphFont* font = ClockGlyphs_getFont(this->currentFontId);
+
+  if(font) {
+    // the clock layer covers the window, so its coordinates are the screen's
+    ClockGlyphs_draw(ctx, font, this->currentNum, frame.origin, this->glyphColors);
+  } else if(this->currentImage) {
+    graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+    graphics_draw_bitmap_in_rect(ctx, this->currentImage, frame);
+  }
+}
@@ -7,30 +7,46 @@
 #define FONT_SETTING_BOLD    2
 #define FONT_SETTING_BOLD_H  3
 #define FONT_SETTING_BOLD_M  4
+#define FONT_SETTING_VECTOR  5
 
 /*
- * Represents a single digit, as shown on the clock.
+ * Represents a single digit, as shown on the clock. The four digits are all
+ * drawn by the one clock layer, which each digit marks dirty only when what
+ * it shows actually changes.
  */
 typedef struct {
   int currentNum;
+  bool isBlank;
   GColor bgColor;
   GColor fgColor;
   GColor midColor1;
   GColor midColor2;
   GPoint position;
+  int positionOffset;
   uint32_t currentImageId;
   int currentFontId;
   GBitmap* currentImage;
-  BitmapLayer* imageLayer;
+
+  // the clock layer the digit is drawn in
+  Layer* layer;
+
+  // the colors above, as the packed glyphs write them to the framebuffer
+  uint8_t glyphColors[4];
 } ClockDigit;
 
 /*
- * Sets the number shown. Allocates the appropriate background image.
+ * Sets the number shown. The image fonts are drawn from their packed glyphs
+ * when those can be loaded; otherwise this allocates the appropriate
+ * background image.
  */
 void ClockDigit_setNumber(ClockDigit* this, int number, int fontId);
+
 void ClockDigit_setBlank(ClockDigit* this);
 void ClockDigit_setColor(ClockDigit* this, GColor fg, GColor bg);
 void ClockDigit_offsetPosition(ClockDigit* this, int posOffset);
 
-void ClockDigit_construct(ClockDigit* this, GPoint pos);
+// draws the digit; called from the clock layer's update proc
+void ClockDigit_draw(ClockDigit* this, GContext* ctx);
+
+void ClockDigit_construct(ClockDigit* this, GPoint pos, Layer* layer);
 void ClockDigit_destruct(ClockDigit* this);
@@ -0,0 +1,226 @@
+#include <pebble.h>
+#include "clock_glyphs.h"
+#include "clock_digit.h"
+
+#define HEADER_SIZE 10
+#define SECTION_HEADER_SIZE 22
+
+// indexed by font id
+static const uint32_t resourceIds[] = {
+  RESOURCE_ID_CLOCK_GLYPHS_DEFAULT,
+  RESOURCE_ID_CLOCK_GLYPHS_LECO,
+  RESOURCE_ID_CLOCK_GLYPHS_BOLD
+};
+
+static ClockGlyphFont fonts[CLOCK_GLYPHS_CACHE_SIZE];
+
+// when each cached font was last asked for, to pick one to replace
+static uint32_t lastUsed[CLOCK_GLYPHS_CACHE_SIZE];
+static uint32_t useCount;
+
+static uint16_t readUint16(const uint8_t* in) {
+  return in[0] | (in[1] << 8);
+}
+
+static bool loadFont(ClockGlyphFont* font, int fontId) {
+  ResHandle handle = resource_get_handle(resourceIds[fontId]);
+  uint8_t header[HEADER_SIZE];
+
+  if(!handle || resource_load_byte_range(handle, 0, header, HEADER_SIZE) != HEADER_SIZE) {
+    return false;
+  }
+
+  #ifdef PBL_COLOR
+    uint16_t offset = readUint16(&header[2]);
+    uint16_t size = readUint16(&header[4]);
+  #else
+    uint16_t offset = readUint16(&header[6]);
+    uint16_t size = readUint16(&header[8]);
+  #endif
+
+  if(size < SECTION_HEADER_SIZE) {
+    return false;
+  }
+
+  uint8_t* data = malloc(size);
+
+  if(!data) {
+    return false;
+  }
+
+  if(resource_load_byte_range(handle, offset, data, size) != size || (data[0] != 1 && data[0] != 2)) {
+    free(data);
+    return false;
+  }
+
+  font->fontId = fontId;
+  font->width = header[0];
+  font->height = header[1];
+  font->bitsPerPixel = data[0];
+  font->paletteSize = data[1];
+  font->data = data;
+
+  return true;
+}
+
+const ClockGlyphFont* ClockGlyphs_getFont(int fontId) {
+  if(fontId < 0 || fontId >= (int)ARRAY_LENGTH(resourceIds)) {
+    return NULL;
+  }
+
+  int slot = 0;
+
+  for(int i = 0; i < CLOCK_GLYPHS_CACHE_SIZE; i++) {
+    if(fonts[i].data && fonts[i].fontId == fontId) {
+      lastUsed[i] = ++useCount;
+      return &fonts[i];
+    }
+
+    // otherwise, replace an empty slot or the one used longest ago
+    if(!fonts[i].data || (fonts[slot].data && lastUsed[i] < lastUsed[slot])) {
+      slot = i;
+    }
+  }
+
+  if(fonts[slot].data) {
+    free(fonts[slot].data);
+    fonts[slot].data = NULL;
+  }
+
+  if(!loadFont(&fonts[slot], fontId)) {
+    return NULL;
+  }
+
+  lastUsed[slot] = ++useCount;
+  return &fonts[slot];
+}
+
+uint8_t ClockGlyphs_resolveColor(GColor color) {
+  #ifdef PBL_COLOR
+    return color.argb;
+  #else
+    // the framebuffer has a bit per pixel, set for white
+    return gcolor_equal(color, GColorWhite) ? 1 : 0;
+  #endif
+}
+
+#ifdef PBL_COLOR
+
+// fills the pixels from x0 up to x1 (not included) in a row of an 8 bit framebuffer
+static inline void fillRun(uint8_t* row, int minX, int maxX, int x0, int x1, uint8_t value) {
+  if(x0 < minX) {
+    x0 = minX;
+  }
+
+  if(x1 > maxX + 1) {
+    x1 = maxX + 1;
+  }
+
+  if(x0 < x1) {
+    memset(row + x0, value, x1 - x0);
+  }
+}
+
+#else
+
+// fills the pixels from x0 up to x1 (not included) in a row of a 1 bit framebuffer
+static inline void fillRun(uint8_t* row, int minX, int maxX, int x0, int x1, uint8_t value) {
+  if(x0 < minX) {
+    x0 = minX;
+  }
+
+  if(x1 > maxX + 1) {
+    x1 = maxX + 1;
+  }
+
+  // pixels are least significant bit first; whole bytes in the middle are set at once
+  while(x0 < x1 && (x0 & 7)) {
+    row[x0 >> 3] = value ? (row[x0 >> 3] | (1 << (x0 & 7))) : (row[x0 >> 3] & ~(1 << (x0 & 7)));
+    x0++;
+  }
+
+  if(x1 - x0 >= 8) {
+    memset(row + (x0 >> 3), value ? 0xFF : 0x00, (x1 - x0) >> 3);
+    x0 += (x1 - x0) & ~7;
+  }
+
+  while(x0 < x1) {
+    row[x0 >> 3] = value ? (row[x0 >> 3] | (1 << (x0 & 7))) : (row[x0 >> 3] & ~(1 << (x0 & 7)));
+    x0++;
+  }
+}
+
+#endif
+
+void ClockGlyphs_draw(GContext* ctx, const ClockGlyphFont* font, int digit, GPoint origin,
+                      const uint8_t* colors) {
+  if(digit < 0 || digit > 9) {
+    return;
+  }
+
+  // the value to write for each palette index
+  uint8_t values[4];
+
+  if(font->paletteSize > 2) {
+    memcpy(values, colors, 4);
+  } else {
+    values[0] = colors[0];
+    values[1] = colors[3];
+  }
+
+  GBitmap* frameBuffer = graphics_capture_frame_buffer(ctx);
+
+  if(!frameBuffer) {
+    return;
+  }
+
+  GRect bounds = gbitmap_get_bounds(frameBuffer);
+  const uint8_t* run = font->data + readUint16(&font->data[2 + digit * 2]);
+  const int bitsPerPixel = font->bitsPerPixel;
+  const uint8_t indexMask = (1 << bitsPerPixel) - 1;
+
+  for(int y = 0; y < font->height; y++) {
+    int screenY = origin.y + y;
+
+    // rows off the screen are still decoded, to get to the next row's runs
+    bool isVisible = screenY >= 0 && screenY < bounds.size.h;
+    uint8_t* row = NULL;
+    int minX = 0;
+    int maxX = -1;
+
+    if(isVisible) {
+      #ifdef PBL_COLOR
+        // round screens have a different span on each row
+        GBitmapDataRowInfo info = gbitmap_get_data_row_info(frameBuffer, screenY);
+        row = info.data;
+        minX = info.min_x;
+        maxX = info.max_x;
+      #else
+        row = gbitmap_get_data(frameBuffer) + screenY * gbitmap_get_bytes_per_row(frameBuffer);
+        maxX = bounds.size.w - 1;
+      #endif
+    }
+
+    for(int x = 0; x < font->width; ) {
+      uint8_t packed = *run++;
+      int length = (packed >> bitsPerPixel) + 1;
+
+      if(isVisible) {
+        fillRun(row, minX, maxX, origin.x + x, origin.x + x + length, values[packed & indexMask]);
+      }
+
+      x += length;
+    }
+  }
+
+  graphics_release_frame_buffer(ctx, frameBuffer);
+}
+
+void ClockGlyphs_deinit() {
+  for(int i = 0; i < CLOCK_GLYPHS_CACHE_SIZE; i++) {
+    if(fonts[i].data) {
+      free(fonts[i].data);
+      fonts[i].data = NULL;
+    }
+  }
+}
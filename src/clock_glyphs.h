@@ -0,0 +1,53 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * The image clock fonts, packed as run-length encoded glyphs (built from the
+ * digit images by tools/pack_digits.py) and drawn straight into the
+ * framebuffer. A font is loaded in a single allocation the first time it is
+ * used, so changing digits allocates and decodes nothing.
+ *
+ * Each resource starts with the glyph size and where its two sections are:
+ * uint8 width, uint8 height, then the uint16 offset and size of the colour
+ * section and of the black & white one. Only the section for the platform is
+ * loaded. A section holds uint8 bits per pixel, uint8 palette size, the
+ * uint16 offset within the section of each of the ten glyphs, and then the
+ * glyphs themselves, as runs that never cross a row. Each run is a byte with
+ * the palette index in its low bits (1 or 2, the bits per pixel) and the
+ * length less one in the rest. Multi-byte values are little endian.
+ */
+
+// the hour and the minutes may use different fonts, so keep two loaded
+#define CLOCK_GLYPHS_CACHE_SIZE 2
+
+typedef struct {
+  int fontId;
+  uint8_t width;
+  uint8_t height;
+  uint8_t bitsPerPixel;
+  uint8_t paletteSize;
+
+  // the platform's section, as loaded from the resource
+  uint8_t* data;
+} ClockGlyphFont;
+
+/*
+ * Returns the packed glyphs for an image font (FONT_SETTING_DEFAULT, _LECO
+ * or _BOLD), loading them if need be, or NULL if they can't be loaded
+ */
+const ClockGlyphFont* ClockGlyphs_getFont(int fontId);
+
+// the value a color is written to the framebuffer as
+uint8_t ClockGlyphs_resolveColor(GColor color);
+
+/*
+ * Draws a digit with its top left corner at the given point on the screen.
+ * The colors are resolved values, in palette order: the foreground, the two
+ * antialiasing shades, then the background. Fonts without antialiasing only
+ * use the first and the last.
+ */
+void ClockGlyphs_draw(GContext* ctx, const ClockGlyphFont* font, int digit, GPoint origin,
+                      const uint8_t* colors);
+
+// frees the loaded fonts
+void ClockGlyphs_deinit();
@@ -0,0 +1,171 @@
+#include <pebble.h>
+#include "settings.h"
+#include "weather.h"
+#include "clock_digit.h"
+#include "sidebar.h"
+#include "display_state.h"
+
+void DisplayState_computeDigits(int* digits, int* digitFonts, struct tm* timeInfo) {
+  int hour = timeInfo->tm_hour;
+
+  if (!clock_is_24h_style()) {
+    if(hour > 12) {
+      hour %= 12;
+    } else if(timeInfo->tm_hour == 0) {
+      hour = 12;
+    }
+  }
+
+  int hourFont = globalSettings.clockFontId;
+  int minuteFont = globalSettings.clockFontId;
+
+  if(globalSettings.clockFontId == FONT_SETTING_BOLD_H) {
+    hourFont = FONT_SETTING_BOLD;
+    minuteFont = FONT_SETTING_DEFAULT;
+  } else if(globalSettings.clockFontId == FONT_SETTING_BOLD_M) {
+    hourFont = FONT_SETTING_DEFAULT;
+    minuteFont = FONT_SETTING_BOLD;
+  }
+
+  // use the blank image for the leading hour digit if needed
+  if(globalSettings.showLeadingZero || hour / 10 != 0) {
+    digits[0] = hour / 10;
+  } else {
+    digits[0] = -1;
+  }
+
+  digits[1] = hour % 10;
+  digits[2] = timeInfo->tm_min / 10;
+  digits[3] = timeInfo->tm_min % 10;
+
+  digitFonts[0] = hourFont;
+  digitFonts[1] = hourFont;
+  digitFonts[2] = minuteFont;
+  digitFonts[3] = minuteFont;
+}
+
+void DisplayState_compute(DisplayState* state, struct tm* timeInfo) {
+  memset(state, 0, sizeof(DisplayState));
+  state->isValid = true;
+
+  // clock digits
+  DisplayState_computeDigits(state->digits, state->digitFonts, timeInfo);
+  state->clockOffset = globalSettings.sidebarOnLeft ? 30 : 0;
+
+  // colors
+  state->timeColor = globalSettings.timeColor;
+  state->timeBgColor = globalSettings.timeBgColor;
+  state->sidebarColor = globalSettings.sidebarColor;
+  state->sidebarTextColor = globalSettings.sidebarTextColor;
+
+  // sidebar contents
+  Sidebar_getDisplayWidgets(state->widgets);
+  SidebarWidgets_computeData(&state->widgetData, timeInfo);
+
+  BatteryChargeState chargeState = battery_state_service_peek();
+  state->batteryLevel = chargeState.charge_percent / 10;
+  state->isCharging = chargeState.is_charging;
+
+  state->isPhoneConnected = bluetooth_connection_service_peek();
+
+  state->currentTemp = Weather_weatherInfo.currentTemp;
+  state->highTemp = Weather_weatherForecast.highTemp;
+  state->lowTemp = Weather_weatherForecast.lowTemp;
+  state->currentIconResourceID = Weather_weatherInfo.currentIconResourceID;
+  state->forecastIconResourceID = Weather_weatherForecast.forecastIconResourceID;
+
+  state->hourlyRevision = Weather_hourlyRevision;
+  state->hourlyIndex = Weather_getHourlyIndex(time(NULL));
+}
+
+// returns true if anything the given widget displays differs between the states
+bool widgetContentChanged(SidebarWidgetType type, const DisplayState* a, const DisplayState* b) {
+  const SidebarWidgetsData* x = &a->widgetData;
+  const SidebarWidgetsData* y = &b->widgetData;
+
+  switch(type) {
+    case BATTERY_METER:
+      return a->batteryLevel != b->batteryLevel || a->isCharging != b->isCharging;
+    case BLUETOOTH_DISCONNECT:
+      return a->isPhoneConnected != b->isPhoneConnected;
+    case DATE:
+      return x->calendarDay != y->calendarDay;
+    case ALT_TIME_ZONE:
+      return strcmp(x->altClock, y->altClock) != 0;
+    case TIME:
+      return strcmp(x->hours, y->hours) != 0 || strcmp(x->minutes, y->minutes) != 0;
+    case SECONDS:
+      return strcmp(x->secondsNum, y->secondsNum) != 0;
+    case WEEK_NUMBER:
+    case DAY_NUMBER:
+      return x->calendarDay != y->calendarDay;
+    case WEATHER_CURRENT:
+      return a->currentTemp != b->currentTemp ||
+             a->currentIconResourceID != b->currentIconResourceID;
+    case WEATHER_FORECAST_TODAY:
+      return a->highTemp != b->highTemp || a->lowTemp != b->lowTemp ||
+             a->forecastIconResourceID != b->forecastIconResourceID;
+    case HOURLY_FORECAST:
+      return a->hourlyRevision != b->hourlyRevision || a->hourlyIndex != b->hourlyIndex;
+    case HEALTH:
+      return x->healthSleepMode != y->healthSleepMode || x->healthValue != y->healthValue;
+    case HEALTH_HISTORY:
+      return x->healthHistoryHour != y->healthHistoryHour ||
+             x->healthHistoryRevision != y->healthHistoryRevision;
+    default:
+      return false;
+  }
+}
+
+uint32_t DisplayState_diff(const DisplayState* oldState, const DisplayState* newState) {
+  if(!oldState->isValid) {
+    uint32_t changes = DISPLAY_CHANGED_CLOCK_COLORS | DISPLAY_CHANGED_CLOCK_POSITION |
+                       DISPLAY_CHANGED_SIDEBAR_LAYOUT | DISPLAY_CHANGED_ALL_SLOTS;
+
+    for(int i = 0; i < 4; i++) {
+      changes |= DISPLAY_CHANGED_DIGIT(i);
+    }
+
+    return changes;
+  }
+
+  uint32_t changes = 0;
+
+  // clock
+  for(int i = 0; i < 4; i++) {
+    if(oldState->digits[i] != newState->digits[i] || oldState->digitFonts[i] != newState->digitFonts[i]) {
+      changes |= DISPLAY_CHANGED_DIGIT(i);
+    }
+  }
+
+  if(!gcolor_equal(oldState->timeColor, newState->timeColor) ||
+     !gcolor_equal(oldState->timeBgColor, newState->timeBgColor)) {
+    changes |= DISPLAY_CHANGED_CLOCK_COLORS;
+  }
+
+  if(oldState->clockOffset != newState->clockOffset) {
+    changes |= DISPLAY_CHANGED_CLOCK_POSITION;
+  }
+
+  // sidebar
+  bool sidebarColorsChanged = !gcolor_equal(oldState->sidebarColor, newState->sidebarColor) ||
+                              !gcolor_equal(oldState->sidebarTextColor, newState->sidebarTextColor) ||
+                              !gcolor_equal(oldState->timeBgColor, newState->timeBgColor);
+
+  for(int i = 0; i < DISPLAY_STATE_SIDEBAR_SLOTS; i++) {
+    if(sidebarColorsChanged ||
+       oldState->widgets[i] != newState->widgets[i] ||
+       widgetContentChanged(newState->widgets[i], oldState, newState)) {
+      changes |= DISPLAY_CHANGED_SLOT(i);
+    }
+  }
+
+  // the battery meter is shorter while charging, and the health widget is
+  // taller while showing sleep, so the widgets have to be laid out again
+  if(oldState->isCharging != newState->isCharging ||
+     oldState->widgetData.healthSleepMode != newState->widgetData.healthSleepMode) {
+    changes |= DISPLAY_CHANGED_SIDEBAR_LAYOUT;
+  }
+
+  return changes;
+}
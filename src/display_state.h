@@ -0,0 +1,73 @@
+#pragma once
+#include <pebble.h>
+#include "sidebar_widgets/sidebar_widgets.h"
+
+#define DISPLAY_STATE_SIDEBAR_SLOTS 3
+
+/*
+ * A snapshot of everything visible on the screen, computed from the current
+ * time, settings and service states. Comparing it with the previously
+ * rendered snapshot tells us exactly which parts of the screen need redrawing.
+ */
+typedef struct {
+  bool isValid;
+
+  // clock digits (-1 means the digit is blank) and their fonts
+  int digits[4];
+  int digitFonts[4];
+
+  // how far the digits are moved right, to make room for a sidebar on the left
+  int clockOffset;
+
+  // colors
+  GColor timeColor;
+  GColor timeBgColor;
+  GColor sidebarColor;
+  GColor sidebarTextColor;
+
+  // the widgets actually shown, after auto battery/disconnect replacement
+  SidebarWidgetType widgets[DISPLAY_STATE_SIDEBAR_SLOTS];
+
+  // sidebar strings and health values
+  SidebarWidgetsData widgetData;
+
+  // battery level, in the 10% steps the battery service reports
+  int batteryLevel;
+  bool isCharging;
+
+  bool isPhoneConnected;
+
+  // weather values
+  int currentTemp;
+  int highTemp;
+  int lowTemp;
+  uint32_t currentIconResourceID;
+  uint32_t forecastIconResourceID;
+
+  // which forecast the hourly widget shows, and the hour it starts from
+  uint32_t hourlyRevision;
+  int hourlyIndex;
+} DisplayState;
+
+// flags returned by DisplayState_diff
+#define DISPLAY_CHANGED_DIGIT(i)        (1 << (i))
+#define DISPLAY_CHANGED_CLOCK_COLORS    (1 << 4)
+#define DISPLAY_CHANGED_SIDEBAR_LAYOUT  (1 << 5)
+#define DISPLAY_CHANGED_CLOCK_POSITION  (1 << 6)
+#define DISPLAY_CHANGED_SLOT(i)         (1 << (8 + (i)))
+#define DISPLAY_CHANGED_ALL_SLOTS       (((1 << DISPLAY_STATE_SIDEBAR_SLOTS) - 1) << 8)
+
+void DisplayState_compute(DisplayState* state, struct tm* timeInfo);
+
+/*
+ * Works out just the clock digits and their fonts for the given time, as
+ * DisplayState_compute does
+ */
+void DisplayState_computeDigits(int* digits, int* digitFonts, struct tm* timeInfo);
+
+/*
+ * Compares the two states field by field and returns the DISPLAY_CHANGED_*
+ * flags for every part of the screen that differs. If the old state isn't
+ * valid, everything is reported as changed.
+ */
+uint32_t DisplayState_diff(const DisplayState* oldState, const DisplayState* newState);
@@ -0,0 +1,492 @@
+#include <pebble.h>
+#include "settings.h"
+#include "night_mode.h"
+#include "event_trace.h"
+
+// the trace itself, and the state its first record starts from
+static uint8_t traceBuffer[EVENT_TRACE_SIZE];
+static int traceLength;
+static EventTraceStart traceStart;
+
+// the most recent record, so that runs of ticks can be merged into it
+static int lastRecordOffset;
+static time_t lastRecordTime;
+
+// events that happen before init (like the first bluetooth peek) aren't recorded
+static bool isRecording;
+
+// the settings as of the latest SESSION or SETTINGS record
+static uint8_t recordedSettings[EVENT_TRACE_SETTINGS_SIZE];
+
+// where the buffer first differs from what is in storage, or
+// EVENT_TRACE_SIZE if it doesn't
+static int unsavedOffset = EVENT_TRACE_SIZE;
+
+static void markUnsaved(int offset) {
+  if(offset < unsavedOffset) {
+    unsavedOffset = offset;
+  }
+}
+
+static void writeUint16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+static void writeUint32(uint8_t* out, uint32_t value) {
+  for(int i = 0; i < 4; i++) {
+    out[i] = (value >> (i * 8)) & 0xFF;
+  }
+}
+
+static uint16_t readUint16(const uint8_t* in) {
+  return in[0] | (in[1] << 8);
+}
+
+static uint32_t readUint32(const uint8_t* in) {
+  return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static uint8_t batteryByte(BatteryChargeState chargeState) {
+  return chargeState.charge_percent | (chargeState.is_charging ? EVENT_TRACE_BATTERY_CHARGING : 0);
+}
+
+static uint8_t nightModeByte() {
+  return (NightMode_isActive ? EVENT_TRACE_NIGHT_MODE_ACTIVE : 0) |
+         (NightMode_isAsleep ? EVENT_TRACE_NIGHT_MODE_ASLEEP : 0);
+}
+
+void EventTrace_snapshotSettings(uint8_t* snapshot) {
+  uint8_t flags = 0;
+
+  if(globalSettings.useLargeFonts)         flags |= EVENT_TRACE_FLAG_LARGE_FONTS;
+  if(globalSettings.sidebarOnLeft)         flags |= EVENT_TRACE_FLAG_SIDEBAR_LEFT;
+  if(globalSettings.btVibe)                flags |= EVENT_TRACE_FLAG_BT_VIBE;
+  if(globalSettings.showLeadingZero)       flags |= EVENT_TRACE_FLAG_LEADING_ZERO;
+  if(globalSettings.showBatteryPct)        flags |= EVENT_TRACE_FLAG_BATTERY_PCT;
+  if(globalSettings.useMetric)             flags |= EVENT_TRACE_FLAG_METRIC;
+  if(globalSettings.healthUseDistance)     flags |= EVENT_TRACE_FLAG_HEALTH_DISTANCE;
+  if(globalSettings.healthUseRestfulSleep) flags |= EVENT_TRACE_FLAG_HEALTH_RESTFUL_SLEEP;
+
+  snapshot[0]  = globalSettings.widgets[0];
+  snapshot[1]  = globalSettings.widgets[1];
+  snapshot[2]  = globalSettings.widgets[2];
+  snapshot[3]  = globalSettings.clockFontId;
+  snapshot[4]  = globalSettings.languageId;
+  snapshot[5]  = globalSettings.hourlyVibe;
+  snapshot[6]  = (int8_t)globalSettings.altclockOffset;
+  snapshot[7]  = globalSettings.decimalSeparator;
+  snapshot[8]  = flags;
+  snapshot[9]  = globalSettings.timeColor.argb;
+  snapshot[10] = globalSettings.timeBgColor.argb;
+  snapshot[11] = globalSettings.sidebarColor.argb;
+  snapshot[12] = globalSettings.sidebarTextColor.argb;
+  snapshot[13] = globalSettings.chimePattern;
+  snapshot[14] = globalSettings.quietHoursStart;
+  snapshot[15] = globalSettings.quietHoursEnd;
+  snapshot[16] = globalSettings.nightModeEnabled;
+  snapshot[17] = globalSettings.nightStartHour;
+  snapshot[18] = globalSettings.nightEndHour;
+}
+
+int EventTrace_recordSize(const uint8_t* record, int available) {
+  int size = 0;
+
+  if(available < 1) {
+    return 0;
+  }
+
+  switch(record[0]) {
+    case EVENT_TRACE_SESSION:
+      size = 1 + 4 + 1 + 1 + EVENT_TRACE_SETTINGS_SIZE + 1 + 1;
+      break;
+    case EVENT_TRACE_TICKS:
+      size = 1 + 2 + 1 + 1;
+      break;
+    case EVENT_TRACE_BLUETOOTH:
+    case EVENT_TRACE_BATTERY:
+    case EVENT_TRACE_NIGHT_MODE:
+    case EVENT_TRACE_TICK_RATE:
+      size = 1 + 2 + 1;
+      break;
+    case EVENT_TRACE_TIME:
+      size = 1 + 4;
+      break;
+    case EVENT_TRACE_SETTINGS:
+      size = 1 + 2 + EVENT_TRACE_SETTINGS_SIZE;
+      break;
+    case EVENT_TRACE_MESSAGE:
+      if(available < 4) {
+        return 0;
+      }
+
+      // walk the tuples to find the end of the record
+      size = 4;
+
+      for(int i = 0; i < record[3]; i++) {
+        if(size + 3 > available) {
+          return 0;
+        }
+
+        size += 3 + record[size + 2];
+      }
+      break;
+    default:
+      return 0;
+  }
+
+  return (size <= available) ? size : 0;
+}
+
+/*
+ * Applies the first record to the start state and removes it, along with
+ * the settings that its message may have changed
+ */
+static void dropFirstRecord() {
+  int size = EventTrace_recordSize(traceBuffer, traceLength);
+
+  if(size == 0) {
+    // the buffer can't be parsed, so start over
+    traceLength = 0;
+    return;
+  }
+
+  uint8_t type = traceBuffer[0];
+
+  // everything moves down, so all of it needs saving
+  markUnsaved(0);
+
+  switch(type) {
+    case EVENT_TRACE_SESSION:
+      traceStart.time = readUint32(&traceBuffer[1]);
+      traceStart.battery = traceBuffer[5];
+      traceStart.isPhoneConnected = traceBuffer[6];
+      memcpy(traceStart.settings, &traceBuffer[7], EVENT_TRACE_SETTINGS_SIZE);
+      traceStart.nightMode = traceBuffer[7 + EVENT_TRACE_SETTINGS_SIZE];
+      traceStart.isTickingEverySecond = traceBuffer[8 + EVENT_TRACE_SETTINGS_SIZE];
+      break;
+    case EVENT_TRACE_TIME:
+      traceStart.time = readUint32(&traceBuffer[1]);
+      break;
+    default:
+      traceStart.time += readUint16(&traceBuffer[1]);
+
+      if(type == EVENT_TRACE_BLUETOOTH) {
+        traceStart.isPhoneConnected = traceBuffer[3];
+      } else if(type == EVENT_TRACE_BATTERY) {
+        traceStart.battery = traceBuffer[3];
+      } else if(type == EVENT_TRACE_SETTINGS) {
+        memcpy(traceStart.settings, &traceBuffer[3], EVENT_TRACE_SETTINGS_SIZE);
+      } else if(type == EVENT_TRACE_NIGHT_MODE) {
+        traceStart.nightMode = traceBuffer[3];
+      } else if(type == EVENT_TRACE_TICK_RATE) {
+        traceStart.isTickingEverySecond = traceBuffer[3];
+      }
+      break;
+  }
+
+  traceLength -= size;
+  memmove(traceBuffer, &traceBuffer[size], traceLength);
+  lastRecordOffset -= size;
+
+  // a message's settings belong with it
+  if(type == EVENT_TRACE_MESSAGE && traceLength > 0 && traceBuffer[0] == EVENT_TRACE_SETTINGS &&
+     readUint16(&traceBuffer[1]) == 0) {
+    dropFirstRecord();
+  }
+}
+
+/*
+ * Appends a record whose first byte is its type. Records that carry a
+ * delta get it filled in here; a TIME record is added first if the delta
+ * doesn't fit.
+ */
+static void appendRecord(uint8_t* record, int size) {
+  time_t now = time(NULL);
+
+  if(!isRecording) {
+    return;
+  }
+
+  if(record[0] != EVENT_TRACE_SESSION && record[0] != EVENT_TRACE_TIME) {
+    if(now < lastRecordTime || now - lastRecordTime > UINT16_MAX) {
+      uint8_t timeRecord[5] = {EVENT_TRACE_TIME};
+      writeUint32(&timeRecord[1], now);
+      appendRecord(timeRecord, sizeof(timeRecord));
+    }
+
+    writeUint16(&record[1], now - lastRecordTime);
+  }
+
+  if(size > EVENT_TRACE_SIZE) {
+    return;
+  }
+
+  while(traceLength + size > EVENT_TRACE_SIZE) {
+    dropFirstRecord();
+  }
+
+  memcpy(&traceBuffer[traceLength], record, size);
+  markUnsaved(traceLength);
+  lastRecordOffset = traceLength;
+  lastRecordTime = now;
+  traceLength += size;
+}
+
+void EventTrace_recordTick(TimeUnits unitsChanged) {
+  time_t now = time(NULL);
+
+  // if the last record is a run of the same ticks, extend it
+  if(traceLength > 0 && lastRecordOffset >= 0) {
+    uint8_t* last = &traceBuffer[lastRecordOffset];
+    uint32_t delta = readUint16(&last[1]) + (now - lastRecordTime);
+
+    if(last[0] == EVENT_TRACE_TICKS && last[3] == (uint8_t)unitsChanged && last[4] < UINT8_MAX &&
+       now >= lastRecordTime && delta <= UINT16_MAX) {
+      writeUint16(&last[1], delta);
+      last[4]++;
+      markUnsaved(lastRecordOffset);
+      lastRecordTime = now;
+      return;
+    }
+  }
+
+  uint8_t record[5] = {EVENT_TRACE_TICKS, 0, 0, (uint8_t)unitsChanged, 1};
+  appendRecord(record, sizeof(record));
+}
+
+void EventTrace_recordBluetooth(bool isConnected) {
+  uint8_t record[4] = {EVENT_TRACE_BLUETOOTH, 0, 0, isConnected};
+  appendRecord(record, sizeof(record));
+}
+
+void EventTrace_recordBattery(BatteryChargeState chargeState) {
+  uint8_t record[4] = {EVENT_TRACE_BATTERY, 0, 0, batteryByte(chargeState)};
+  appendRecord(record, sizeof(record));
+}
+
+void EventTrace_recordMessage(DictionaryIterator* iterator) {
+  // a message may take up to a quarter of the trace; the rest is cut off
+  uint8_t record[EVENT_TRACE_SIZE / 4] = {EVENT_TRACE_MESSAGE};
+  int size = 4;
+
+  for(Tuple* tuple = dict_read_first(iterator); tuple != NULL; tuple = dict_read_next(iterator)) {
+    int length = (tuple->length < EVENT_TRACE_MAX_TUPLE_LENGTH) ? tuple->length : EVENT_TRACE_MAX_TUPLE_LENGTH;
+
+    if(tuple->key > UINT8_MAX || size + 3 + length > (int)sizeof(record)) {
+      continue;
+    }
+
+    record[size] = tuple->key;
+    record[size + 1] = tuple->type;
+    record[size + 2] = length;
+    memcpy(&record[size + 3], tuple->value->data, length);
+
+    size += 3 + length;
+    record[3]++;
+  }
+
+  appendRecord(record, size);
+}
+
+void EventTrace_recordNightMode() {
+  uint8_t record[4] = {EVENT_TRACE_NIGHT_MODE, 0, 0, nightModeByte()};
+  appendRecord(record, sizeof(record));
+}
+
+void EventTrace_recordTickRate(bool isTickingEverySecond) {
+  uint8_t record[4] = {EVENT_TRACE_TICK_RATE, 0, 0, isTickingEverySecond};
+  appendRecord(record, sizeof(record));
+}
+
+void EventTrace_recordSettings() {
+  uint8_t record[3 + EVENT_TRACE_SETTINGS_SIZE] = {EVENT_TRACE_SETTINGS};
+  EventTrace_snapshotSettings(&record[3]);
+
+  if(memcmp(&record[3], recordedSettings, EVENT_TRACE_SETTINGS_SIZE) != 0) {
+    memcpy(recordedSettings, &record[3], EVENT_TRACE_SETTINGS_SIZE);
+    appendRecord(record, sizeof(record));
+  }
+}
+
+/*
+ * Walks the loaded trace to find its last record and when it happened.
+ * Returns false if the trace is damaged.
+ */
+static bool findLastRecord() {
+  time_t t = traceStart.time;
+  int offset = 0;
+
+  memcpy(recordedSettings, traceStart.settings, EVENT_TRACE_SETTINGS_SIZE);
+  lastRecordOffset = -1;
+
+  while(offset < traceLength) {
+    const uint8_t* record = &traceBuffer[offset];
+    int size = EventTrace_recordSize(record, traceLength - offset);
+
+    if(size == 0) {
+      return false;
+    }
+
+    if(record[0] == EVENT_TRACE_SESSION || record[0] == EVENT_TRACE_TIME) {
+      t = readUint32(&record[1]);
+    } else {
+      t += readUint16(&record[1]);
+    }
+
+    if(record[0] == EVENT_TRACE_SESSION) {
+      memcpy(recordedSettings, &record[7], EVENT_TRACE_SETTINGS_SIZE);
+    } else if(record[0] == EVENT_TRACE_SETTINGS) {
+      memcpy(recordedSettings, &record[3], EVENT_TRACE_SETTINGS_SIZE);
+    }
+
+    lastRecordOffset = offset;
+    offset += size;
+  }
+
+  lastRecordTime = t;
+  return true;
+}
+
+static void loadFromStorage() {
+  uint8_t header[EVENT_TRACE_HEADER_SIZE];
+
+  traceLength = 0;
+
+  if(persist_read_data(EVENT_TRACE_HEADER_KEY, header, sizeof(header)) != sizeof(header)) {
+    return;
+  }
+
+  int length = readUint16(&header[EVENT_TRACE_HEADER_SIZE - 2]);
+
+  // a trace from an older version of the face can't be added to
+  if(header[0] != EVENT_TRACE_VERSION || length > EVENT_TRACE_SIZE) {
+    return;
+  }
+
+  traceStart.time = readUint32(&header[1]);
+  traceStart.battery = header[5];
+  traceStart.isPhoneConnected = header[6];
+  memcpy(traceStart.settings, &header[7], EVENT_TRACE_SETTINGS_SIZE);
+  traceStart.nightMode = header[7 + EVENT_TRACE_SETTINGS_SIZE];
+  traceStart.isTickingEverySecond = header[8 + EVENT_TRACE_SETTINGS_SIZE];
+
+  for(int offset = 0; offset < length; offset += EVENT_TRACE_CHUNK_SIZE) {
+    int chunkSize = (length - offset < EVENT_TRACE_CHUNK_SIZE) ? length - offset : EVENT_TRACE_CHUNK_SIZE;
+    uint32_t key = EVENT_TRACE_DATA_KEY + offset / EVENT_TRACE_CHUNK_SIZE;
+
+    if(persist_read_data(key, &traceBuffer[offset], chunkSize) != chunkSize) {
+      return;
+    }
+  }
+
+  traceLength = length;
+
+  if(!findLastRecord()) {
+    traceLength = 0;
+  }
+}
+
+static void writeHeader(uint8_t* header) {
+  header[0] = EVENT_TRACE_VERSION;
+  writeUint32(&header[1], traceStart.time);
+  header[5] = traceStart.battery;
+  header[6] = traceStart.isPhoneConnected;
+  memcpy(&header[7], traceStart.settings, EVENT_TRACE_SETTINGS_SIZE);
+  header[7 + EVENT_TRACE_SETTINGS_SIZE] = traceStart.nightMode;
+  header[8 + EVENT_TRACE_SETTINGS_SIZE] = traceStart.isTickingEverySecond;
+  writeUint16(&header[EVENT_TRACE_HEADER_SIZE - 2], traceLength);
+}
+
+// writes the header, and the chunks of the buffer that changed since the last save
+static void saveToStorage() {
+  if(unsavedOffset >= traceLength) {
+    return;
+  }
+
+  uint8_t header[EVENT_TRACE_HEADER_SIZE];
+  writeHeader(header);
+
+  persist_write_data(EVENT_TRACE_HEADER_KEY, header, sizeof(header));
+
+  int start = unsavedOffset - unsavedOffset % EVENT_TRACE_CHUNK_SIZE;
+
+  for(int offset = start; offset < traceLength; offset += EVENT_TRACE_CHUNK_SIZE) {
+    int chunkSize = (traceLength - offset < EVENT_TRACE_CHUNK_SIZE) ? traceLength - offset : EVENT_TRACE_CHUNK_SIZE;
+    persist_write_data(EVENT_TRACE_DATA_KEY + offset / EVENT_TRACE_CHUNK_SIZE, &traceBuffer[offset], chunkSize);
+  }
+
+  unsavedOffset = EVENT_TRACE_SIZE;
+}
+
+#ifdef EVENT_TRACE_LOG
+
+/*
+ * Writes the header and the trace to the log as hex, 32 bytes to a line,
+ * in the form trace_replay.py looks for
+ */
+static void writeToLog() {
+  uint8_t header[EVENT_TRACE_HEADER_SIZE];
+  char line[2 * 32 + 1];
+
+  writeHeader(header);
+
+  APP_LOG(APP_LOG_LEVEL_INFO, "event trace: begin %d", EVENT_TRACE_HEADER_SIZE + traceLength);
+
+  int total = EVENT_TRACE_HEADER_SIZE + traceLength;
+
+  for(int offset = 0; offset < total; offset += 32) {
+    int lineLength = 0;
+
+    for(int i = offset; i < total && i < offset + 32; i++) {
+      uint8_t value = (i < EVENT_TRACE_HEADER_SIZE) ? header[i] : traceBuffer[i - EVENT_TRACE_HEADER_SIZE];
+      snprintf(&line[lineLength], sizeof(line) - lineLength, "%02x", value);
+      lineLength += 2;
+    }
+
+    APP_LOG(APP_LOG_LEVEL_INFO, "event trace: %s", line);
+  }
+
+  APP_LOG(APP_LOG_LEVEL_INFO, "event trace: end");
+}
+
+#endif
+
+void EventTrace_init(bool isTickingEverySecond) {
+  loadFromStorage();
+
+  // every launch starts a session with the state the face starts from
+  uint8_t record[1 + 4 + 1 + 1 + EVENT_TRACE_SETTINGS_SIZE + 1 + 1] = {EVENT_TRACE_SESSION};
+  writeUint32(&record[1], time(NULL));
+  record[5] = batteryByte(battery_state_service_peek());
+  record[6] = bluetooth_connection_service_peek();
+  EventTrace_snapshotSettings(&record[7]);
+  record[7 + EVENT_TRACE_SETTINGS_SIZE] = nightModeByte();
+  record[8 + EVENT_TRACE_SETTINGS_SIZE] = isTickingEverySecond;
+
+  if(traceLength == 0) {
+    // a new trace starts from here
+    traceStart.time = time(NULL);
+    traceStart.battery = record[5];
+    traceStart.isPhoneConnected = record[6];
+    memcpy(traceStart.settings, &record[7], EVENT_TRACE_SETTINGS_SIZE);
+    traceStart.nightMode = record[7 + EVENT_TRACE_SETTINGS_SIZE];
+    traceStart.isTickingEverySecond = record[8 + EVENT_TRACE_SETTINGS_SIZE];
+
+    lastRecordOffset = -1;
+    lastRecordTime = traceStart.time;
+  }
+
+  memcpy(recordedSettings, &record[7], EVENT_TRACE_SETTINGS_SIZE);
+  isRecording = true;
+  appendRecord(record, sizeof(record));
+}
+
+void EventTrace_deinit() {
+  isRecording = false;
+  saveToStorage();
+
+  #ifdef EVENT_TRACE_LOG
+    writeToLog();
+  #endif
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * A compact record of the events that drive the watchface: ticks, bluetooth
+ * and battery changes, night mode, and incoming AppMessages. It is kept in a
+ * fixed-size buffer (the oldest records are dropped first) and saved to
+ * persistent storage when the face exits. Builds with EVENT_TRACE_LOG defined also
+ * write it to the app log on exit, so it can be pulled off the watch with
+ * `pebble logs` and replayed on the host (tools/host/trace_replay.py).
+ */
+
+// uncomment to write the trace to the log every time the face exits
+// #define EVENT_TRACE_LOG
+
+#ifdef PBL_COLOR
+  #define EVENT_TRACE_SIZE 1024
+#else
+  #define EVENT_TRACE_SIZE 512
+#endif
+
+// persistent storage keys: the trace header, then the buffer in chunks
+#define EVENT_TRACE_HEADER_KEY     300
+#define EVENT_TRACE_DATA_KEY       301
+#define EVENT_TRACE_CHUNK_SIZE     PERSIST_DATA_MAX_LENGTH
+
+/*
+ * Record types. Every record starts with its type byte; all but SESSION and
+ * TIME follow it with the seconds since the previous record (uint16).
+ *
+ * SESSION:    uint32 time, uint8 battery, uint8 connected, settings snapshot,
+ *             uint8 night mode, uint8 ticking every second
+ * TICKS:      uint16 delta, uint8 smallest unit changed, uint8 tick count
+ * BLUETOOTH:  uint16 delta, uint8 connected
+ * BATTERY:    uint16 delta, uint8 battery
+ * MESSAGE:    uint16 delta, uint8 tuple count, then per tuple
+ *             uint8 key, uint8 type, uint8 length, value
+ * TIME:       uint32 time, for gaps too long for a delta
+ * SETTINGS:   uint16 delta, settings snapshot, whenever a message changed them
+ * NIGHT_MODE: uint16 delta, uint8 night mode, whenever night mode or the
+ *             sleep state it follows changed, right after the event that
+ *             brought the change to light
+ * TICK_RATE:  uint16 delta, uint8 ticking every second, whenever the face
+ *             switched between second and minute ticks
+ *
+ * Battery bytes hold the charge percent, with the top bit set when charging.
+ * Night mode bytes hold the EVENT_TRACE_NIGHT_MODE_* flags. All multi-byte
+ * values are little endian.
+ */
+typedef enum {
+  EVENT_TRACE_SESSION    = 1,
+  EVENT_TRACE_TICKS      = 2,
+  EVENT_TRACE_BLUETOOTH  = 3,
+  EVENT_TRACE_BATTERY    = 4,
+  EVENT_TRACE_MESSAGE    = 5,
+  EVENT_TRACE_TIME       = 6,
+  EVENT_TRACE_SETTINGS   = 7,
+  EVENT_TRACE_NIGHT_MODE = 8,
+  EVENT_TRACE_TICK_RATE  = 9
+} EventTraceRecordType;
+
+#define EVENT_TRACE_BATTERY_CHARGING 0x80
+
+// whether night mode is on, and whether the health service said the wearer was asleep
+#define EVENT_TRACE_NIGHT_MODE_ACTIVE (1 << 0)
+#define EVENT_TRACE_NIGHT_MODE_ASLEEP (1 << 1)
+
+// message tuples longer than this are cut short; an hourly forecast fits
+#define EVENT_TRACE_MAX_TUPLE_LENGTH 48
+
+/*
+ * The settings snapshot stored with each session, so that a replay starts
+ * with the same configuration:
+ * widgets[3], clockFontId, languageId, hourlyVibe, altclockOffset,
+ * decimalSeparator, flags, timeColor, timeBgColor, sidebarColor,
+ * sidebarTextColor, chimePattern, quietHoursStart, quietHoursEnd,
+ * nightModeEnabled, nightStartHour, nightEndHour
+ */
+#define EVENT_TRACE_SETTINGS_SIZE 19
+
+#define EVENT_TRACE_FLAG_LARGE_FONTS          (1 << 0)
+#define EVENT_TRACE_FLAG_SIDEBAR_LEFT         (1 << 1)
+#define EVENT_TRACE_FLAG_BT_VIBE              (1 << 2)
+#define EVENT_TRACE_FLAG_LEADING_ZERO         (1 << 3)
+#define EVENT_TRACE_FLAG_BATTERY_PCT          (1 << 4)
+#define EVENT_TRACE_FLAG_METRIC               (1 << 5)
+#define EVENT_TRACE_FLAG_HEALTH_DISTANCE      (1 << 6)
+#define EVENT_TRACE_FLAG_HEALTH_RESTFUL_SLEEP (1 << 7)
+
+/*
+ * The state at the start of the buffer: what the oldest remaining record is
+ * relative to. Stored under EVENT_TRACE_HEADER_KEY after the format version
+ * (uint8), in this order, followed by the buffer length (uint16)
+ */
+typedef struct {
+  uint32_t time;
+  uint8_t battery;
+  uint8_t isPhoneConnected;
+  uint8_t settings[EVENT_TRACE_SETTINGS_SIZE];
+  uint8_t nightMode;
+  uint8_t isTickingEverySecond;
+} EventTraceStart;
+
+#define EVENT_TRACE_HEADER_SIZE (1 + 4 + 1 + 1 + EVENT_TRACE_SETTINGS_SIZE + 1 + 1 + 2)
+
+// bumped whenever the layout of the trace changes; older traces are dropped
+#define EVENT_TRACE_VERSION 5
+
+/*
+ * Loads the previous trace from storage and starts a new session. Call once
+ * the settings are loaded, the services have been peeked, and the face has
+ * subscribed to ticks at the given rate.
+ */
+void EventTrace_init(bool isTickingEverySecond);
+
+// saves what changed in the trace to storage, and logs it if EVENT_TRACE_LOG is defined
+void EventTrace_deinit();
+
+void EventTrace_recordTick(TimeUnits unitsChanged);
+void EventTrace_recordBluetooth(bool isConnected);
+void EventTrace_recordBattery(BatteryChargeState chargeState);
+void EventTrace_recordMessage(DictionaryIterator* iterator);
+
+// records the current night mode and sleep state (see night_mode.h)
+void EventTrace_recordNightMode();
+void EventTrace_recordTickRate(bool isTickingEverySecond);
+
+// records the settings, if they changed since they were last recorded
+void EventTrace_recordSettings();
+
+// fills in a settings snapshot from the current settings
+void EventTrace_snapshotSettings(uint8_t* snapshot);
+
+/*
+ * Returns the size in bytes of the record starting at the given pointer, or
+ * 0 if it isn't a valid record
+ */
+int EventTrace_recordSize(const uint8_t* record, int available);
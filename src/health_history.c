@@ -0,0 +1,117 @@
+#include <pebble.h>
+#include "health_history.h"
+
+#ifdef PBL_HEALTH
+
+HealthHistory HealthHistory_history;
+int HealthHistory_revision;
+
+static HealthMinuteData minuteData[HEALTH_HISTORY_BATCH_MINUTES];
+
+static int hourSlot(time_t t) {
+  return localtime(&t)->tm_hour;
+}
+
+/*
+ * Empties the slots of the hours after the last minute read, up to and
+ * including the one containing the given time: they hold a day-old count
+ */
+static void clearHoursUntil(time_t t) {
+  time_t hour = t / SECONDS_PER_HOUR * SECONDS_PER_HOUR;
+  time_t lastHour = (HealthHistory_history.readUntil - 1) / SECONDS_PER_HOUR * SECONDS_PER_HOUR;
+  int hours = (hour - lastHour) / SECONDS_PER_HOUR;
+
+  if(HealthHistory_history.readUntil == 0 || hours > HEALTH_HISTORY_HOURS) {
+    hours = HEALTH_HISTORY_HOURS;
+    lastHour = hour - HEALTH_HISTORY_HOURS * SECONDS_PER_HOUR;
+  }
+
+  for(int i = 1; i <= hours; i++) {
+    HealthHistory_history.steps[hourSlot(lastHour + i * SECONDS_PER_HOUR)] = 0;
+  }
+
+  if(hours > 0) {
+    HealthHistory_revision++;
+  }
+}
+
+void HealthHistory_update() {
+  time_t now = time(NULL) / SECONDS_PER_MINUTE * SECONDS_PER_MINUTE;
+  time_t start = HealthHistory_history.readUntil;
+
+  if(start != 0 && now - start < HEALTH_HISTORY_UPDATE_MINUTES * SECONDS_PER_MINUTE) {
+    return;
+  }
+
+  // the first time, backfill everything the ring can hold
+  time_t earliest = now / SECONDS_PER_HOUR * SECONDS_PER_HOUR - (HEALTH_HISTORY_HOURS - 1) * SECONDS_PER_HOUR;
+
+  if(start < earliest) {
+    start = earliest;
+  }
+
+  clearHoursUntil(now);
+
+  while(start < now) {
+    time_t end = start + HEALTH_HISTORY_BATCH_MINUTES * SECONDS_PER_MINUTE;
+
+    if(end > now) {
+      end = now;
+    }
+
+    time_t batchEnd = end;
+    uint32_t count = health_service_get_minute_history(minuteData, HEALTH_HISTORY_BATCH_MINUTES, &start, &end);
+
+    if(count == 0) {
+      // the latest minutes may not have been recorded yet; try them again
+      // next time. older gaps (the watch was off) are skipped
+      if(batchEnd >= now) {
+        break;
+      }
+
+      start = batchEnd;
+      continue;
+    }
+
+    bool changed = false;
+
+    for(uint32_t i = 0; i < count; i++) {
+      if(!minuteData[i].is_invalid && minuteData[i].steps > 0) {
+        uint16_t* steps = &HealthHistory_history.steps[hourSlot(start + i * SECONDS_PER_MINUTE)];
+        *steps = (*steps + minuteData[i].steps > UINT16_MAX) ? UINT16_MAX : *steps + minuteData[i].steps;
+        changed = true;
+      }
+    }
+
+    if(changed) {
+      HealthHistory_revision++;
+    }
+
+    start = end;
+  }
+
+  HealthHistory_history.readUntil = start;
+}
+
+void HealthHistory_init() {
+  if(persist_exists(HEALTH_HISTORY_PERSIST_KEY)) {
+    persist_read_data(HEALTH_HISTORY_PERSIST_KEY, &HealthHistory_history, sizeof(HealthHistory));
+  } else {
+    memset(&HealthHistory_history, 0, sizeof(HealthHistory));
+  }
+}
+
+void HealthHistory_deinit() {
+  // nothing to save if the history was never read
+  if(HealthHistory_history.readUntil != 0) {
+    persist_write_data(HEALTH_HISTORY_PERSIST_KEY, &HealthHistory_history, sizeof(HealthHistory));
+  }
+}
+
+#else
+
+void HealthHistory_init() {}
+void HealthHistory_deinit() {}
+void HealthHistory_update() {}
+
+#endif
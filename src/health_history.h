@@ -0,0 +1,41 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * Steps taken in each hour of the last day, read from the health service's
+ * minute history. The hours are kept in a ring indexed by the hour of the
+ * day, so slot 9 holds 9:00-10:00 today if that has started, and yesterday's
+ * otherwise. Only the minutes that passed since the last read are fetched,
+ * and the ring is saved when the face exits so that it isn't rebuilt from
+ * a whole day of history on the next launch.
+ */
+
+#define HEALTH_HISTORY_PERSIST_KEY 224
+
+#define HEALTH_HISTORY_HOURS 24
+
+// minutes of history fetched per call to the health service
+#define HEALTH_HISTORY_BATCH_MINUTES 30
+
+// the history is read at most this often; it is only shown by the hour
+#define HEALTH_HISTORY_UPDATE_MINUTES 5
+
+typedef struct {
+  // the end of the last minute read
+  uint32_t readUntil;
+  uint16_t steps[HEALTH_HISTORY_HOURS];
+} HealthHistory;
+
+extern HealthHistory HealthHistory_history;
+
+// counts changes to the history, so the widget knows when to redraw
+extern int HealthHistory_revision;
+
+void HealthHistory_init();
+void HealthHistory_deinit();
+
+/*
+ * Reads the minutes that passed since the last update, if there are enough
+ * of them to be worth a read
+ */
+void HealthHistory_update();
@@ -5,176 +5,879 @@ var CONFIG_VERSION = 6;
 //var BASE_CONFIG_URL = 'http://192.168.0.106:4000/';
 var BASE_CONFIG_URL = 'http://jmarhold.github.io/TimeStylePebble/';
 
-var WEATHER_CACHE_LIFETIME = 86400; // 1 day
+// how long the location found from the phone's position is trusted; the
+// position is cheap to check again thanks to the geocode cache below
+var WEATHER_CACHE_LIFETIME = 3600; // 1 hour
+
+// positions up to this old are good enough for the weather
+var LOCATION_MAXIMUM_AGE = 1800000; // 30 minutes, in ms
+
+// the error code for a position the wearer won't share
+var PERMISSION_DENIED = 1;
+
+// reverse geocoding results are cached for positions rounded to this grid,
+// and reused for any position within the distance threshold
+var GEOCODE_GRID_DEGREES = 0.05;
+var GEOCODE_DISTANCE_THRESHOLD = 3000; // meters
+var GEOCODE_CACHE_SIZE = 16;
+
+// weather fetched less than this long ago is sent again instead of refetched
+var WEATHER_DATA_CACHE_LIFETIME = 1200; // 20 minutes
+
+// a fetch that hasn't finished after this long is assumed lost; it is
+// longer than the slowest run of retries below
+var WEATHER_FETCH_TIMEOUT = 180;
+
+// when the fetch in progress started, or 0 if there is none
+var weatherFetchStartTime = 0;
+
+// the weather service to use, from weatherProviders below; the
+// 'weather_provider' item in localStorage overrides it
+var WEATHER_PROVIDER = 'yahoo';
+
+// the yahoo weather service; point this at a local server to test against a stub
+var WEATHER_API_URL = 'https://query.yahooapis.com/v1/public/yql';
+
+// the weather icons, numbered as in WeatherIcon on the watch (weather.h)
+var WEATHER_ICONS = {
+  GENERIC: 0,
+  CLEAR_DAY: 1,
+  CLEAR_NIGHT: 2,
+  PARTLY_CLOUDY: 3,
+  PARTLY_CLOUDY_NIGHT: 4,
+  CLOUDY: 5,
+  LIGHT_RAIN: 6,
+  HEAVY_RAIN: 7,
+  THUNDERSTORM: 8,
+  RAINING_AND_SNOWING: 9,
+  LIGHT_SNOW: 10,
+  HEAVY_SNOW: 11
+};
+
+// a temperature the watch shows as unknown (WEATHER_DATA_UNKNOWN)
+var WEATHER_UNKNOWN = -128;
+
+// the most hours of forecast the watch keeps (HOURLY_FORECAST_MAX_HOURS)
+var HOURLY_FORECAST_MAX_HOURS = 24;
+
+// data too large for one message is sent in chunks of this size; the watch's
+// inbox (512 bytes) fits a chunk along with the weather
+var TRANSFER_CHUNK_SIZE = 128;
+
+// the kinds of data sent in chunks (TransferStream in src/chunked_transfer.h)
+var TRANSFER_STREAM_HOURLY_FORECAST = 0;
+
+// the transfer under way on each stream, with its id and data. Ids start
+// anywhere, so that a restarted script's first transfer isn't mistaken for
+// one the watch already has
+var transfers = {};
+var lastTransferId = Math.floor(Math.random() * 0xFFFF);
+
+// the open-meteo weather and geocoding services
+var OPEN_METEO_API_URL = 'https://api.open-meteo.com/v1/forecast';
+var OPEN_METEO_GEOCODING_URL = 'https://geocoding-api.open-meteo.com/v1/search';
+
+// requests that take longer than this are aborted
+var XHR_TIMEOUT = 15000; // ms
+
+/*
+ * How often each kind of operation is tried, and how long to wait between
+ * tries: the delay doubles every time, up to maxDelay, and is then randomly
+ * shortened by up to half so that retries don't line up with each other
+ */
+var RETRY_POLICIES = {
+  xhr:        {maxAttempts: 3, baseDelay: 2000, maxDelay: 30000},
+  location:   {maxAttempts: 2, baseDelay: 5000, maxDelay: 30000},
+  appmessage: {maxAttempts: 3, baseDelay: 1000, maxDelay: 10000}
+};
+
+// after this many failures in a row, an operation isn't tried at all for
+// a while, rather than spending more power on something that's down
+var CIRCUIT_BREAKER_THRESHOLD = 5;
+var CIRCUIT_BREAKER_COOLDOWN = 600; // seconds
+
+// failures in a row, and when the circuit closes again, per operation
+var retryState = {
+  xhr:        {failures: 0, openUntil: 0},
+  location:   {failures: 0, openUntil: 0},
+  appmessage: {failures: 0, openUntil: 0}
+};
+
+function currentTime() {
+  return new Date().getTime() / 1000;
+}
+
+function retryDelay(policy, attempt) {
+  var delay = Math.min(policy.maxDelay, policy.baseDelay * Math.pow(2, attempt));
+  return delay / 2 + Math.random() * delay / 2;
+}
+
+function isCircuitOpen(operation) {
+  return currentTime() < retryState[operation].openUntil;
+}
+
+/*
+ * Runs attempt(succeed, fail) until it succeeds or runs out of tries. Gives
+ * up straight away while the operation's circuit breaker is open, or when
+ * attempt calls fail(reason, true) for a failure that trying again won't fix.
+ */
+function withRetries(operation, description, attempt, onGiveUp) {
+  var policy = RETRY_POLICIES[operation];
+  var state = retryState[operation];
+  var attemptNumber = 0;
+
+  function tryOnce() {
+    if(isCircuitOpen(operation)) {
+      console.log('Not trying ' + description + ': too many recent ' + operation + ' failures');
+      onGiveUp();
+      return;
+    }
+
+    var finished = false;
 
-var failureRetryAmount = 3;
-var currentFailures = 0;
+    attempt(function() {
+      if(!finished) {
+        finished = true;
+        state.failures = 0;
+      }
+    }, function(reason, isPermanent) {
+      if(finished) {
+        return;
+      }
+
+      finished = true;
+      state.failures++;
+      attemptNumber++;
+
+      console.log(description + ' failed (' + reason + '), attempt ' + attemptNumber +
+                  ' of ' + policy.maxAttempts);
 
-var xhrRequest = function (url, type, callback) {
+      if(state.failures >= CIRCUIT_BREAKER_THRESHOLD) {
+        state.openUntil = currentTime() + CIRCUIT_BREAKER_COOLDOWN;
+        state.failures = 0;
+      }
+
+      if(attemptNumber < policy.maxAttempts && !isPermanent && !isCircuitOpen(operation)) {
+        setTimeout(tryOnce, retryDelay(policy, attemptNumber - 1));
+      } else {
+        onGiveUp();
+      }
+    });
+  }
+
+  tryOnce();
+}
+
+// makes a request that gives up after XHR_TIMEOUT, and reports any error
+var xhrRequest = function (url, type, callback, errorCallback) {
   var xhr = new XMLHttpRequest();
+  var done = false;
+
+  function finish(error) {
+    if(done) {
+      return;
+    }
+
+    done = true;
+    clearTimeout(timer);
+
+    if(error) {
+      errorCallback(error);
+    } else {
+      callback(xhr.responseText);
+    }
+  }
+
+  var timer = setTimeout(function() {
+    xhr.abort();
+    finish('timeout');
+  }, XHR_TIMEOUT);
+
   xhr.onload = function () {
-    callback(this.responseText);
+    if(xhr.status >= 200 && xhr.status < 300) {
+      finish();
+    } else {
+      finish('status ' + xhr.status);
+    }
+  };
+  xhr.onerror = function() {
+    finish('network error');
   };
   xhr.open(type, url);
   xhr.send();
 };
 
-function locationError(err) {
-  console.log('location error on the JS side! Failure #' + currentFailures);
-  //if we fail, try using the cached location
-  if(currentFailures <= failureRetryAmount) {
-    // reset cache time
-    window.localStorage.setItem('weather_loc_cache_time', (new Date().getTime() / 1000));
+/*
+ * Fetches JSON with retries, and hands it to parse. A response that isn't
+ * JSON counts as a failed attempt.
+ */
+function requestJson(url, description, parse, onGiveUp) {
+  withRetries('xhr', description, function(succeed, fail) {
+    xhrRequest(url, 'GET', function(responseText) {
+      var json;
+
+      try {
+        json = JSON.parse(responseText);
+      } catch(err) {
+        fail('bad response');
+        return;
+      }
 
-    getWeather();
-    currentFailures++;
+      succeed();
+      parse(json);
+    }, fail);
+  }, onGiveUp);
+}
+
+function sendWithRetries(dictionary, description, onSuccess) {
+  withRetries('appmessage', description, function(succeed, fail) {
+    Pebble.sendAppMessage(dictionary, function(e) {
+      succeed();
+      onSuccess();
+    }, function(e) {
+      fail('not delivered');
+    });
+  }, function() {
+    console.log('Gave up sending ' + description + ' to Pebble');
+  });
+}
+
+// ends the weather fetch in progress without a result
+function weatherFetchFailed() {
+  console.log('Could not get the weather');
+  weatherFetchStartTime = 0;
+}
+
+// when no position can be found, fall back on the last known location
+function locationError() {
+  var lastLocation = window.localStorage.getItem('weather_loc_cache');
+
+  if(lastLocation) {
+    setLocationCache(lastLocation);
+    fetchWeather();
   } else {
-    // until we get too many failures, at which point give up
-    currentFailures = 0;
+    weatherFetchFailed();
   }
 }
 
-function locationSuccess(pos) {
-  // Construct URL
-  // first, do a reverse geocode lookup on the coordinates
+// the distance in meters between two coordinates
+function distanceBetween(lat1, lon1, lat2, lon2) {
+  var toRadians = Math.PI / 180;
+  var dLat = (lat2 - lat1) * toRadians;
+  var dLon = (lon2 - lon1) * toRadians;
+
+  var a = Math.sin(dLat / 2) * Math.sin(dLat / 2) +
+          Math.cos(lat1 * toRadians) * Math.cos(lat2 * toRadians) *
+          Math.sin(dLon / 2) * Math.sin(dLon / 2);
+
+  return 6371000 * 2 * Math.atan2(Math.sqrt(a), Math.sqrt(1 - a));
+}
+
+function geocodeGridKey(latitude, longitude) {
+  return Math.round(latitude / GEOCODE_GRID_DEGREES) + ',' + Math.round(longitude / GEOCODE_GRID_DEGREES);
+}
+
+function getGeocodeCache() {
+  return JSON.parse(window.localStorage.getItem('geocode_cache') || '{}');
+}
+
+/*
+ * Returns the cached location id for a position, if one was looked up close
+ * enough to it. The cache is small, so every entry is checked: grid cells
+ * narrow towards the poles, and near them a match can be several cells away.
+ */
+function getCachedGeocode(latitude, longitude) {
+  var cache = getGeocodeCache();
+  var bestKey = null;
+  var bestDistance = GEOCODE_DISTANCE_THRESHOLD;
+
+  for(var key in cache) {
+    var entry = cache[key];
+    var distance = distanceBetween(latitude, longitude, entry.lat, entry.lon);
+
+    if(distance <= bestDistance) {
+      bestKey = key;
+      bestDistance = distance;
+    }
+  }
+
+  if(bestKey === null) {
+    return null;
+  }
+
+  // a place used again is kept over ones that haven't been
+  cache[bestKey].time = currentTime();
+  window.localStorage.setItem('geocode_cache', JSON.stringify(cache));
 
-  var query = 'select woeid from geo.places where text="(' +
-       pos.coords.latitude + ',' + pos.coords.longitude + ')" limit 1';
+  return cache[bestKey].woeid;
+}
 
-  var url = 'https://query.yahooapis.com/v1/public/yql?q=' +
-       encodeURIComponent(query) + '&format=json';
+function setCachedGeocode(latitude, longitude, woeid) {
+  var cache = getGeocodeCache();
+  var keys = Object.keys(cache);
 
-  console.log("Reverse geocoding url: " + url);
+  // make room by forgetting the least recently used places
+  while(keys.length >= GEOCODE_CACHE_SIZE) {
+    keys.sort(function(a, b) { return cache[a].time - cache[b].time; });
+    delete cache[keys.shift()];
+  }
 
-  xhrRequest(url, 'GET',
-    function(responseText) {
+  cache[geocodeGridKey(latitude, longitude)] = {
+    lat: latitude,
+    lon: longitude,
+    woeid: woeid,
+    time: currentTime()
+  };
 
-      // responseText contains a JSON object with weather info
-      var json = JSON.parse(responseText);
+  window.localStorage.setItem('geocode_cache', JSON.stringify(cache));
+}
 
-      var location = json.query.results.place.woeid;
+function setLocationCache(location) {
+  window.localStorage.setItem('weather_loc_cache', location);
+  window.localStorage.setItem('weather_loc_cache_time', currentTime());
+}
+
+function locationSuccess(pos) {
+  var latitude = pos.coords.latitude;
+  var longitude = pos.coords.longitude;
+
+  // if we've been here before, there's no need to look the place up again
+  var cachedLocation = getCachedGeocode(latitude, longitude);
+
+  if(cachedLocation) {
+    console.log("Location is near a cached one: " + cachedLocation);
+
+    setLocationCache(cachedLocation);
+    fetchWeather();
+    return;
+  }
 
+  getWeatherProvider().locate(latitude, longitude,
+    function(location) {
       console.log("We did it! Location was " + location);
 
-      window.localStorage.setItem('weather_loc_cache', location);
-      window.localStorage.setItem('weather_loc_cache_time', (new Date().getTime() / 1000));
+      setCachedGeocode(latitude, longitude, location);
+      setLocationCache(location);
 
-      getWeather();
-    }
+      fetchWeather();
+    },
+    locationError
   );
 }
 
 function getLocation() {
-  navigator.geolocation.getCurrentPosition(
-    locationSuccess,
-    locationError,
-    {timeout: 15000, maximumAge: 60000}
-  );
+  withRetries('location', 'finding the location', function(succeed, fail) {
+    navigator.geolocation.getCurrentPosition(
+      function(pos) {
+        succeed();
+        locationSuccess(pos);
+      },
+      function(err) {
+        // asking again won't change the wearer's mind
+        fail(err && err.message ? err.message : 'no position', err && err.code === PERMISSION_DENIED);
+      },
+      // a coarse position is plenty for the weather, and doesn't wake the GPS
+      {enableHighAccuracy: false, timeout: 15000, maximumAge: LOCATION_MAXIMUM_AGE}
+    );
+  }, locationError);
+}
+
+/*
+ * Weather services. Each one can find a location id for a position
+ * (locate), and fetch the current conditions and today's forecast for a
+ * location in a single request (fetch). A location is either {id: ...}
+ * from locate, or {name: ...} as typed in the settings.
+ *
+ * fetch hands back the same compact record whatever the service:
+ *   {temperature, icon, forecastHigh, forecastLow, forecastIcon, hourly}
+ * with temperatures in degrees celsius and icons from WEATHER_ICONS, so the
+ * rest of this file and the watch never see the service's own format.
+ * Services that forecast by the hour add
+ *   hourly: {start, temperatures: [...], icons: [...]}
+ * starting with the current hour, where start is when that hour began (in
+ * seconds since the epoch).
+ */
+var weatherProviders = {};
+
+// yahoo's condition codes, in order, as watch icons
+var YAHOO_CONDITION_ICONS = (function() {
+  var I = WEATHER_ICONS;
+
+  return [
+    I.THUNDERSTORM, I.THUNDERSTORM, I.THUNDERSTORM, I.THUNDERSTORM,   // 0-3: tornado, storms
+    I.THUNDERSTORM, I.RAINING_AND_SNOWING, I.RAINING_AND_SNOWING,     // 4-6
+    I.RAINING_AND_SNOWING, I.RAINING_AND_SNOWING, I.LIGHT_RAIN,       // 7-9: sleet, drizzle
+    I.RAINING_AND_SNOWING, I.HEAVY_RAIN, I.HEAVY_RAIN,                // 10-12: freezing rain, showers
+    I.LIGHT_SNOW, I.LIGHT_SNOW, I.LIGHT_SNOW, I.HEAVY_SNOW,           // 13-16: flurries, snow
+    I.LIGHT_SNOW, I.HEAVY_SNOW, I.CLOUDY, I.CLOUDY, I.CLOUDY,         // 17-21: hail, sleet, dust, fog, haze
+    I.CLOUDY, I.CLEAR_DAY, I.CLEAR_DAY, I.CLEAR_DAY, I.CLOUDY,        // 22-26: smoky, windy, cold, cloudy
+    I.PARTLY_CLOUDY_NIGHT, I.PARTLY_CLOUDY, I.PARTLY_CLOUDY_NIGHT,    // 27-29: mostly/partly cloudy
+    I.PARTLY_CLOUDY, I.CLEAR_NIGHT, I.CLEAR_DAY, I.CLEAR_NIGHT,       // 30-33: clear, sunny, fair
+    I.CLEAR_DAY, I.RAINING_AND_SNOWING, I.CLEAR_DAY,                  // 34-36: fair, rain and hail, hot
+    I.THUNDERSTORM, I.THUNDERSTORM, I.THUNDERSTORM, I.LIGHT_RAIN,     // 37-40: thunderstorms, showers
+    I.HEAVY_SNOW, I.LIGHT_SNOW, I.HEAVY_SNOW, I.PARTLY_CLOUDY,        // 41-44: snow, partly cloudy
+    I.THUNDERSTORM, I.HEAVY_SNOW, I.THUNDERSTORM                      // 45-47: thundershowers, snow showers
+  ];
+})();
+
+function yahooIcon(code) {
+  var icon = YAHOO_CONDITION_ICONS[parseInt(code, 10)];
+  return (icon === undefined) ? WEATHER_ICONS.GENERIC : icon;
+}
+
+function yahooQueryUrl(query) {
+  return WEATHER_API_URL + '?q=' + encodeURIComponent(query) + '&format=json';
+}
+
+weatherProviders.yahoo = {
+  locate: function(latitude, longitude, onSuccess, onFailure) {
+    var url = yahooQueryUrl('select woeid from geo.places where text="(' +
+                            latitude + ',' + longitude + ')" limit 1');
+
+    console.log("Reverse geocoding url: " + url);
+
+    requestJson(url, 'reverse geocoding', function(json) {
+      if(json.query && json.query.results) {
+        onSuccess(json.query.results.place.woeid);
+      } else {
+        onFailure();
+      }
+    }, onFailure);
+  },
+
+  fetch: function(location, onSuccess, onFailure) {
+    var where = location.id ? 'woeid="' + location.id + '"' :
+        'woeid in (select woeid from geo.places(1) where text="' + location.name + '")';
+
+    // only ask for the fields we use
+    var url = yahooQueryUrl('select item.condition.temp, item.condition.code, item.forecast.code, ' +
+                            'item.forecast.high, item.forecast.low from weather.forecast where ' +
+                            where + ' and u="c" limit 1');
+
+    console.log(url);
+
+    requestJson(url, 'weather request', function(json) {
+      if(!json.query || json.query.count != 1 || !json.query.results.channel) {
+        onFailure();
+        return;
+      }
+
+      var condition = json.query.results.channel.item.condition;
+      var forecast = json.query.results.channel.item.forecast;
+
+      // yahoo doesn't say whether it's night, so its day icons are used
+      onSuccess({
+        temperature: Math.round(condition.temp),
+        icon: yahooIcon(condition.code),
+        forecastHigh: Math.round(forecast.high),
+        forecastLow: Math.round(forecast.low),
+        forecastIcon: yahooIcon(forecast.code)
+      });
+    }, onFailure);
+  }
+};
+
+// the weather codes open-meteo uses (WMO 4677), as watch icons for the
+// day; clear and partly cloudy skies get their night icons after dark
+var OPEN_METEO_CODE_ICONS = (function() {
+  var I = WEATHER_ICONS;
+
+  return {
+    0: I.CLEAR_DAY, 1: I.PARTLY_CLOUDY, 2: I.PARTLY_CLOUDY, 3: I.CLOUDY,
+    45: I.CLOUDY, 48: I.CLOUDY,                                         // fog
+    51: I.LIGHT_RAIN, 53: I.LIGHT_RAIN, 55: I.LIGHT_RAIN,               // drizzle
+    56: I.RAINING_AND_SNOWING, 57: I.RAINING_AND_SNOWING,               // freezing drizzle
+    61: I.LIGHT_RAIN, 63: I.HEAVY_RAIN, 65: I.HEAVY_RAIN,               // rain
+    66: I.RAINING_AND_SNOWING, 67: I.RAINING_AND_SNOWING,               // freezing rain
+    71: I.LIGHT_SNOW, 73: I.HEAVY_SNOW, 75: I.HEAVY_SNOW, 77: I.LIGHT_SNOW,
+    80: I.LIGHT_RAIN, 81: I.HEAVY_RAIN, 82: I.HEAVY_RAIN,               // rain showers
+    85: I.LIGHT_SNOW, 86: I.HEAVY_SNOW,                                 // snow showers
+    95: I.THUNDERSTORM, 96: I.THUNDERSTORM, 99: I.THUNDERSTORM
+  };
+})();
+
+function openMeteoIcon(code, isDay) {
+  var icon = OPEN_METEO_CODE_ICONS[code];
+
+  if(icon === undefined) {
+    return WEATHER_ICONS.GENERIC;
+  }
+
+  if(isDay === 0 && icon === WEATHER_ICONS.CLEAR_DAY) {
+    return WEATHER_ICONS.CLEAR_NIGHT;
+  } else if(isDay === 0 && icon === WEATHER_ICONS.PARTLY_CLOUDY) {
+    return WEATHER_ICONS.PARTLY_CLOUDY_NIGHT;
+  }
+
+  return icon;
+}
+
+function openMeteoForecast(latitude, longitude, onSuccess, onFailure) {
+  var url = OPEN_METEO_API_URL + '?latitude=' + latitude + '&longitude=' + longitude +
+            '&current_weather=true&hourly=temperature_2m,weathercode,is_day' +
+            '&daily=temperature_2m_max,temperature_2m_min,weathercode' +
+            '&timeformat=unixtime&timezone=auto&forecast_days=2';
+
+  console.log(url);
+
+  requestJson(url, 'weather request', function(json) {
+    if(!json.current_weather || !json.hourly || !json.daily) {
+      onFailure();
+      return;
+    }
+
+    var current = json.current_weather;
+    var hourly = json.hourly;
+
+    // the hourly forecast starts at midnight; skip to the current hour
+    var first = 0;
+
+    while(first + 1 < hourly.time.length && hourly.time[first + 1] <= currentTime()) {
+      first++;
+    }
+
+    var last = Math.min(hourly.time.length, first + HOURLY_FORECAST_MAX_HOURS);
+
+    onSuccess({
+      temperature: Math.round(current.temperature),
+      icon: openMeteoIcon(current.weathercode, current.is_day),
+      forecastHigh: Math.round(json.daily.temperature_2m_max[0]),
+      forecastLow: Math.round(json.daily.temperature_2m_min[0]),
+      forecastIcon: openMeteoIcon(json.daily.weathercode[0], 1),
+      hourly: {
+        start: hourly.time[first],
+        temperatures: hourly.temperature_2m.slice(first, last).map(Math.round),
+        icons: hourly.weathercode.slice(first, last).map(function(code, i) {
+          return openMeteoIcon(code, hourly.is_day[first + i]);
+        })
+      }
+    });
+  }, onFailure);
 }
 
+// open-meteo takes positions directly, so a location id is just a rounded
+// position, and a typed location is looked up first
+weatherProviders.openmeteo = {
+  locate: function(latitude, longitude, onSuccess, onFailure) {
+    setTimeout(function() {
+      onSuccess(latitude.toFixed(2) + ',' + longitude.toFixed(2));
+    }, 0);
+  },
+
+  fetch: function(location, onSuccess, onFailure) {
+    if(location.id) {
+      var position = location.id.split(',');
+      openMeteoForecast(position[0], position[1], onSuccess, onFailure);
+      return;
+    }
+
+    var url = OPEN_METEO_GEOCODING_URL + '?name=' + encodeURIComponent(location.name) + '&count=1';
+
+    requestJson(url, 'geocoding', function(json) {
+      if(json.results && json.results.length > 0) {
+        openMeteoForecast(json.results[0].latitude, json.results[0].longitude, onSuccess, onFailure);
+      } else {
+        onFailure();
+      }
+    }, onFailure);
+  }
+};
+
+// made-up weather for testing without a network: it changes every hour,
+// going through every icon in turn
+weatherProviders.mock = {
+  locate: function(latitude, longitude, onSuccess, onFailure) {
+    setTimeout(function() {
+      onSuccess('mock:' + geocodeGridKey(latitude, longitude));
+    }, 0);
+  },
+
+  fetch: function(location, onSuccess, onFailure) {
+    var hour = Math.floor(currentTime() / 3600);
+    var temperatures = [];
+    var icons = [];
+
+    for(var i = 0; i < HOURLY_FORECAST_MAX_HOURS; i++) {
+      temperatures.push(((hour + i) % 40) - 10);
+      icons.push((hour + i) % 12);
+    }
+
+    setTimeout(function() {
+      onSuccess({
+        temperature: (hour % 40) - 10,
+        icon: hour % 12,
+        forecastHigh: 25,
+        forecastLow: -5,
+        forecastIcon: (hour + 1) % 12,
+        hourly: {start: hour * 3600, temperatures: temperatures, icons: icons}
+      });
+    }, 0);
+  }
+};
+
+function getWeatherProviderName() {
+  var name = window.localStorage.getItem('weather_provider');
+  return weatherProviders[name] ? name : WEATHER_PROVIDER;
+}
+
+function getWeatherProvider() {
+  return weatherProviders[getWeatherProviderName()];
+}
+
+// location ids mean nothing to another service, so forget them on a switch
+function checkWeatherProvider() {
+  var name = getWeatherProviderName();
+
+  if(window.localStorage.getItem('weather_loc_provider') !== name) {
+    window.localStorage.removeItem('weather_loc_cache');
+    window.localStorage.removeItem('weather_loc_cache_time');
+    window.localStorage.removeItem('geocode_cache');
+    window.localStorage.setItem('weather_loc_provider', name);
+  }
+}
+
+// the weather cache is only good for the location and service it came from
+function weatherCacheLocation() {
+  return getWeatherProviderName() + ':' + (window.localStorage.getItem('weather_loc') || '');
+}
+
+// returns the last weather sent to the watch, if it's still recent enough
+function getCachedWeather() {
+  var cache = JSON.parse(window.localStorage.getItem('weather_data_cache') || 'null');
+
+  if(cache && cache.record && cache.location === weatherCacheLocation() &&
+     currentTime() - cache.time < WEATHER_DATA_CACHE_LIFETIME) {
+    return cache.record;
+  }
+
+  return null;
+}
+
+function setCachedWeather(record) {
+  window.localStorage.setItem('weather_data_cache', JSON.stringify({
+    time: currentTime(),
+    location: weatherCacheLocation(),
+    record: record
+  }));
+}
+
+/*
+ * Sends the watch the current weather. Recent weather is answered from the
+ * cache; otherwise a fetch is started, unless one is already under way, in
+ * which case its result will serve this request too
+ */
 function getWeather() {
   var weatherDisabled = window.localStorage.getItem('disable_weather');
   console.log("Get weather function called! DisableWeather is '" + weatherDisabled + "'");
   if(weatherDisabled !== "yes") {
     window.localStorage.setItem('disable_weather', 'no');
 
-    var weatherLoc = window.localStorage.getItem('weather_loc');
-    var weatherLocCache = window.localStorage.getItem('weather_loc_cache');
-    var weatherLocCacheTime = window.localStorage.getItem('weather_loc_cache_time');
-    var cacheAge = (new Date().getTime() / 1000) - weatherLocCacheTime;
-
-    var location = false;
-    var is_woeid = false;
-
-    if(weatherLoc) {
-      location = weatherLoc;
-      console.log("it thinks we have a location");
-    } else if ((new Date().getTime() / 1000) - weatherLocCacheTime < WEATHER_CACHE_LIFETIME ) {
-      location = weatherLocCache;
-      is_woeid = true; //cached locations are woeids
-      console.log("it thinks we have a cache! Loc:" + weatherLocCache + ", Age: " + cacheAge);
-    }
-
-    if(location !== false) {
-      var url = "";
-      if(is_woeid === true) {
-        var url = 'https://query.yahooapis.com/v1/public/yql?q=' +
-            encodeURIComponent('select item.condition, item.forecast from weather.forecast where woeid="' +
-            location + '" and u="c" limit 1') + '&format=json';
+    checkWeatherProvider();
+
+    var cachedWeather = getCachedWeather();
+
+    if(cachedWeather) {
+      console.log('Sending cached weather');
+      sendWeatherToPebble(cachedWeather);
+      return;
+    }
+
+    if(weatherFetchStartTime !== 0 && currentTime() - weatherFetchStartTime < WEATHER_FETCH_TIMEOUT) {
+      console.log('Weather fetch already in progress');
+      return;
+    }
+
+    weatherFetchStartTime = currentTime();
+    fetchWeather();
+  }
+}
+
+// looks up the weather for the configured or current location
+function fetchWeather() {
+  var weatherLoc = window.localStorage.getItem('weather_loc');
+  var weatherLocCache = window.localStorage.getItem('weather_loc_cache');
+  var weatherLocCacheTime = window.localStorage.getItem('weather_loc_cache_time');
+  var cacheAge = currentTime() - weatherLocCacheTime;
+
+  var location = false;
+
+  if(weatherLoc) {
+    location = {name: weatherLoc};
+    console.log("it thinks we have a location");
+  } else if (weatherLocCache && cacheAge < WEATHER_CACHE_LIFETIME ) {
+    location = {id: weatherLocCache};
+    console.log("it thinks we have a cache! Loc:" + weatherLocCache + ", Age: " + cacheAge);
+  }
+
+  if(location !== false) {
+    getWeatherProvider().fetch(location,
+      function(record) {
+        weatherFetchStartTime = 0;
+
+        console.log(JSON.stringify(record));
+
+        setCachedWeather(record);
+        sendWeatherToPebble(record);
+      },
+      weatherFetchFailed
+    );
+  } else {
+    getLocation();
+  }
+}
+
+// a temperature as a signed byte
+function temperatureByte(temperature) {
+  if(typeof temperature !== 'number' || isNaN(temperature)) {
+    temperature = WEATHER_UNKNOWN;
+  }
+
+  return Math.max(WEATHER_UNKNOWN, Math.min(127, temperature)) & 0xFF;
+}
+
+/*
+ * Packs an hourly forecast the way Weather_setHourlyFromData() reads it:
+ * the start time, the hour count, a byte per temperature, then the icons
+ * two to a byte
+ */
+function hourlyForecastBytes(hourly) {
+  var count = Math.min(hourly.temperatures.length, hourly.icons.length, HOURLY_FORECAST_MAX_HOURS);
+  var bytes = [
+    hourly.start & 0xFF, (hourly.start >>> 8) & 0xFF, (hourly.start >>> 16) & 0xFF, (hourly.start >>> 24) & 0xFF,
+    count
+  ];
+
+  for(var i = 0; i < count; i++) {
+    bytes.push(temperatureByte(hourly.temperatures[i]));
+  }
+
+  for(i = 0; i < count; i += 2) {
+    bytes.push((hourly.icons[i] & 0x0F) | (i + 1 < count ? (hourly.icons[i + 1] & 0x0F) << 4 : 0));
+  }
+
+  return bytes;
+}
+
+// packs a weather record the way Weather_setFromData() reads it
+function weatherDictionary(record) {
+  return {
+    'KEY_WEATHER_DATA': [
+      temperatureByte(record.temperature),
+      record.icon,
+      temperatureByte(record.forecastHigh),
+      temperatureByte(record.forecastLow),
+      record.forecastIcon
+    ]
+  };
+}
+
+/*
+ * Starts a transfer of data that may not fit in one message (see
+ * src/chunked_transfer.h), replacing any still going on the same stream
+ */
+function startTransfer(stream, bytes) {
+  lastTransferId = lastTransferId % 0xFFFF + 1;
+  transfers[stream] = {id: lastTransferId, bytes: bytes};
+
+  return transfers[stream];
+}
+
+/*
+ * Sends a transfer's chunks from the given offset on, each once the watch
+ * acknowledged the one before. The first chunk goes out along with whatever
+ * else is in dict. Stops if the transfer is replaced or resumed elsewhere
+ */
+function sendChunks(stream, transfer, offset, dict, description, onSuccess) {
+  var run = transfer.run = {};
+
+  function sendFrom(offset, dict) {
+    var chunk = transfer.bytes.slice(offset, offset + TRANSFER_CHUNK_SIZE);
+
+    dict.KEY_CHUNK_STREAM = stream;
+    dict.KEY_CHUNK_ID = transfer.id;
+    dict.KEY_CHUNK_OFFSET = offset;
+    dict.KEY_CHUNK_LENGTH = transfer.bytes.length;
+    dict.KEY_CHUNK_DATA = chunk;
+
+    sendWithRetries(dict, description + ' (' + offset + ' of ' + transfer.bytes.length + ' bytes)', function() {
+      if(transfers[stream] !== transfer || transfer.run !== run) {
+        return;
+      }
+
+      if(offset + chunk.length < transfer.bytes.length) {
+        sendFrom(offset + chunk.length, {});
       } else {
-        var url = 'https://query.yahooapis.com/v1/public/yql?q=' +
-            encodeURIComponent('select item.condition, item.forecast from weather.forecast where woeid in (select woeid from geo.places(1) where text="' +
-            location + '") and u="c" limit 1') + '&format=json';
+        delete transfers[stream];
+        onSuccess();
       }
-      console.log(url);
+    });
+  }
 
-      getAndSendWeatherData(url);
-    } else {
-      getLocation();
-    }
+  sendFrom(offset, dict);
+}
+
+/*
+ * Carries on with a transfer from where the watch says it broke off.
+ * Returns false if that transfer is no longer around
+ */
+function resumeTransfer(stream, id, offset) {
+  var transfer = transfers[stream];
+
+  if(!transfer || transfer.id !== id || offset >= transfer.bytes.length) {
+    return false;
+  }
+
+  console.log('Resuming transfer ' + id + ' from byte ' + offset);
+  sendChunks(stream, transfer, offset, {}, 'resumed transfer', function() {
+    console.log('Resumed transfer ' + id + ' finished');
+  });
+
+  return true;
+}
+
+// the hourly forecast follows the weather in chunks, the first sent with it
+function sendWeatherToPebble(record) {
+  var dict = weatherDictionary(record);
+
+  function onSuccess() {
+    console.log('Weather info sent to Pebble successfully!');
+  }
+
+  if(record.hourly && record.hourly.temperatures.length > 0) {
+    var transfer = startTransfer(TRANSFER_STREAM_HOURLY_FORECAST, hourlyForecastBytes(record.hourly));
+    sendChunks(TRANSFER_STREAM_HOURLY_FORECAST, transfer, 0, dict, 'weather info', onSuccess);
+  } else {
+    sendWithRetries(dict, 'weather info', onSuccess);
   }
 }
 
-// accepts an openweathermap url, gets weather data from it, and sends it to the watch
-function getAndSendWeatherData(url) {
-  xhrRequest(url, 'GET',
-    function(responseText) {
-      // responseText contains a JSON object with weather info
-      var json = JSON.parse(responseText);
-      var condition = json.query.results.channel.item.condition;
-      var forecast = json.query.results.channel.item.forecast;
+// the settings the watch has acknowledged, by message key
+function getSentSettings() {
+  return JSON.parse(window.localStorage.getItem('settings_sent') || '{}');
+}
+
+function setSentSettings(changes) {
+  var sent = getSentSettings();
+
+  for(var key in changes) {
+    sent[key] = changes[key];
+  }
+
+  window.localStorage.setItem('settings_sent', JSON.stringify(sent));
+}
 
-      if(json.query.count == "1") {
-        // Temperature in Kelvin requires adjustment
-        var temperature = Math.round(condition.temp);
-        // console.log('Temperature is ' + temperature);
-
-        // Conditions
-        var conditionCode = parseInt(condition.code, 10);
-        // console.log('Condition code is ' + conditionCode);
-
-        // forecast conditions
-        var forecastCondition = parseInt(forecast.code, 10);
-        var forecastHighTemp = Math.round(forecast.high);
-        var forecastLowTemp = Math.round(forecast.low);
-
-
-        // night state is not used with yahoo weather
-        var isNight = false;
-
-        // Assemble dictionary using our keys
-        var dictionary = {
-          'KEY_TEMPERATURE': temperature,
-          'KEY_CONDITION_CODE': conditionCode,
-          'KEY_USE_NIGHT_ICON': isNight,
-          'KEY_FORECAST_CONDITION': forecastCondition,
-          'KEY_FORECAST_TEMP_HIGH': forecastHighTemp,
-          'KEY_FORECAST_TEMP_LOW': forecastLowTemp
-        };
-
-        console.log(JSON.stringify(dictionary));
-
-        // Send to Pebble
-        Pebble.sendAppMessage(dictionary,
-          function(e) {
-            console.log('Weather info sent to Pebble successfully!');
-          },
-          function(e) {
-            // if we fail, wait a couple seconds, then try again
-            if(currentFailures < failureRetryAmount) {
-              getWeather();
-              currentFailures++;
-            } else {
-              currentFailures = 0;
-            }
-
-            console.log('Error sending weather info to Pebble! Count: #' + currentFailures);
-          }
-        );
-        }
+// returns the part of a settings dictionary that differs from what the watch has
+function settingsChanges(dict) {
+  var sent = getSentSettings();
+  var changes = {};
 
+  for(var key in dict) {
+    if(dict[key] !== undefined && sent[key] !== dict[key]) {
+      changes[key] = dict[key];
     }
-  );
+  }
+
+  return changes;
 }
 
 // Listen for when the watchface is opened
@@ -190,14 +893,30 @@ Pebble.addEventListener('ready',
   }
 );
 
-// Listen for incoming messages
-// When we get one, just assume that the watch wants new weather
-// data because OF COURSE it wants some weather data!
+// Listen for incoming messages: requests for weather, and requests to resume
+// a transfer (see the message shapes in src/messaging.h)
 Pebble.addEventListener('appmessage',
   function(msg) {
-    console.log('Recieved message: ' + JSON.stringify(msg.payload));
+    var payload = msg.payload || {};
+    var resumed = false;
+
+    console.log('Recieved message: ' + JSON.stringify(payload));
+
+    // a watch that lost its settings (say, a new install) needs all of them
+    if(payload.KEY_SETTINGS_NEEDED) {
+      window.localStorage.removeItem('settings_sent');
+    }
+
+    // a watch that missed part of a transfer says where to pick it up
+    if(payload.KEY_CHUNK_STREAM !== undefined && payload.KEY_CHUNK_ID !== undefined &&
+       payload.KEY_CHUNK_OFFSET !== undefined) {
+      resumed = resumeTransfer(payload.KEY_CHUNK_STREAM, payload.KEY_CHUNK_ID, payload.KEY_CHUNK_OFFSET);
+    }
 
-    getWeather();
+    // the rest of the weather the watch was getting answers its request, too
+    if(payload.KEY_REQUEST_WEATHER && !resumed) {
+      getWeather();
+    }
   }
 );
 
@@ -283,6 +1002,8 @@ Pebble.addEventListener('webviewclosed', function(e) {
         dict.KEY_SETTING_CLOCK_FONT_ID = 3;
       } else if(configData.clock_font_setting == 'bold-m') {
         dict.KEY_SETTING_CLOCK_FONT_ID = 4;
+      } else if(configData.clock_font_setting == 'vector') {
+        dict.KEY_SETTING_CLOCK_FONT_ID = 5;
       }
     }
 
@@ -305,6 +1026,38 @@ Pebble.addEventListener('webviewclosed', function(e) {
       }
     }
 
+    if(configData.chime_pattern) {
+      if(configData.chime_pattern == 'short') {
+        dict.KEY_SETTING_CHIME_PATTERN = 1;
+      } else if(configData.chime_pattern == 'long') {
+        dict.KEY_SETTING_CHIME_PATTERN = 2;
+      } else if(configData.chime_pattern == 'count') {
+        dict.KEY_SETTING_CHIME_PATTERN = 3;
+      } else {
+        dict.KEY_SETTING_CHIME_PATTERN = 0;
+      }
+    }
+
+    // quiet hours are whole hours; the same start and end turns them off
+    if(configData.quiet_hours_start !== undefined && configData.quiet_hours_end !== undefined) {
+      dict.KEY_SETTING_QUIET_HOURS_START = parseInt(configData.quiet_hours_start, 10) || 0;
+      dict.KEY_SETTING_QUIET_HOURS_END = parseInt(configData.quiet_hours_end, 10) || 0;
+    }
+
+    // night mode settings
+    if(configData.night_mode_setting) {
+      if(configData.night_mode_setting == 'yes') {
+        dict.KEY_SETTING_NIGHT_MODE = 1;
+      } else {
+        dict.KEY_SETTING_NIGHT_MODE = 0;
+      }
+    }
+
+    if(configData.night_start !== undefined && configData.night_end !== undefined) {
+      dict.KEY_SETTING_NIGHT_START_HOUR = parseInt(configData.night_start, 10) || 0;
+      dict.KEY_SETTING_NIGHT_END_HOUR = parseInt(configData.night_end, 10) || 0;
+    }
+
     // sidebar settings
     dict.KEY_WIDGET_0_ID = configData.widget_0_id;
     dict.KEY_WIDGET_1_ID = configData.widget_1_id;
@@ -335,6 +1088,8 @@ Pebble.addEventListener('webviewclosed', function(e) {
       }
     }
 
+    var previousWeatherLoc = window.localStorage.getItem('weather_loc');
+
     if(configData.weather_loc !== undefined) {
       // weather location can be placed into window.localStorage
       window.localStorage.setItem('weather_loc', configData.weather_loc);
@@ -383,8 +1138,8 @@ Pebble.addEventListener('webviewclosed', function(e) {
 
     var widgetIDs = [configData.widget_0_id, configData.widget_1_id, configData.widget_2_id];
 
-    // if there is either a current conditions or a today's forecast widget, enable the weather
-    if(widgetIDs.indexOf(7) != -1 || widgetIDs.indexOf(8) != -1) {
+    // if there is a current conditions, today's forecast or hourly forecast widget, enable the weather
+    if(widgetIDs.indexOf(7) != -1 || widgetIDs.indexOf(8) != -1 || widgetIDs.indexOf(13) != -1) {
         disableWeather = 'no';
     } else {
         disableWeather = 'yes';
@@ -392,16 +1147,29 @@ Pebble.addEventListener('webviewclosed', function(e) {
 
     window.localStorage.setItem('disable_weather', disableWeather);
 
-    console.log('Preparing message: ', JSON.stringify(dict));
+    // only send what the watch doesn't have yet
+    var changes = settingsChanges(dict);
+
+    if(Object.keys(changes).length === 0) {
+      console.log('Settings are unchanged, nothing to send');
+
+      // the weather location may still have changed
+      if(window.localStorage.getItem('weather_loc') !== previousWeatherLoc) {
+        getWeather();
+      }
+      return;
+    }
+
+    console.log('Preparing message: ', JSON.stringify(changes));
 
     // Send settings to Pebble watchapp
-    Pebble.sendAppMessage(dict, function(){
+    sendWithRetries(changes, 'config data', function() {
       console.log('Sent config data to Pebble, now trying to get weather');
 
+      setSentSettings(changes);
+
       // after sending config data, force a weather refresh in case that changed
       getWeather();
-    }, function() {
-        console.log('Failed to send config data!');
     });
   } else {
     console.log("No settings changed!");
@@ -1,9 +1,16 @@
 #include <pebble.h>
 #include "clock_digit.h"
+#include "clock_glyphs.h"
 #include "messaging.h"
 #include "settings.h"
 #include "weather.h"
+#include "health_history.h"
+#include "chime.h"
+#include "night_mode.h"
+#include "power_policy.h"
 #include "sidebar.h"
+#include "display_state.h"
+#include "event_trace.h"
 
 // windows and layers
 static Window* mainWindow;
@@ -17,8 +24,15 @@ static bool updatingEverySecond;
 // the four digits on the clock, ordered h1 h2, m1 m2
 static ClockDigit clockDigits[4];
 
+// draws all four digits
+static Layer* clockLayer;
+
+// what is currently on screen, so that we only redraw what changed
+static DisplayState renderedState;
+
 void update_clock();
 void redrawScreen();
+bool ticksEverySecond();
 void tick_handler(struct tm *tick_time, TimeUnits units_changed);
 void bluetoothStateChanged(bool newConnectionState);
 
@@ -35,88 +49,155 @@ void update_clock() {
   // timeInfo->tm_min = 23;
 
   // debug: set fake condition for screenshots
-  // Weather_setConditions(44, false, 44);
+  // Weather_setConditions(WEATHER_ICON_PARTLY_CLOUDY, WEATHER_ICON_PARTLY_CLOUDY);
   // Weather_weatherInfo.currentTemp = 21;
   // Weather_weatherForecast.highTemp = 22;
   // Weather_weatherForecast.lowTemp = 16;
 
-  int hour = timeInfo->tm_hour;
+  DisplayState newState;
+  DisplayState_compute(&newState, timeInfo);
+
+  uint32_t changes = DisplayState_diff(&renderedState, &newState);
 
-  if (!clock_is_24h_style()) {
-    if(hour > 12) {
-      hour %= 12;
-    } else if(timeInfo->tm_hour == 0) {
-      hour = 12;
+  // maybe the colors changed!
+  if(changes & DISPLAY_CHANGED_CLOCK_COLORS) {
+    for(int i = 0; i < 4; i++) {
+      ClockDigit_setColor(&clockDigits[i], newState.timeColor, newState.timeBgColor);
     }
+
+    window_set_background_color(mainWindow, newState.timeBgColor);
   }
 
-  uint8_t current_font = globalSettings.clockFontId;
+  // or maybe the sidebar moved to the other side
+  if(changes & DISPLAY_CHANGED_CLOCK_POSITION) {
+    for(int i = 0; i < 4; i++) {
+      ClockDigit_offsetPosition(&clockDigits[i], newState.clockOffset);
+    }
+  }
 
-  if(globalSettings.clockFontId == FONT_SETTING_BOLD_H) {
-    current_font = FONT_SETTING_BOLD;
-  } else if(globalSettings.clockFontId == FONT_SETTING_BOLD_M) {
-    current_font = FONT_SETTING_DEFAULT;
+  for(int i = 0; i < 4; i++) {
+    if(changes & DISPLAY_CHANGED_DIGIT(i)) {
+      if(newState.digits[i] < 0) {
+        ClockDigit_setBlank(&clockDigits[i]);
+      } else {
+        ClockDigit_setNumber(&clockDigits[i], newState.digits[i], newState.digitFonts[i]);
+      }
+    }
   }
 
-  // use the blank image for the leading hour digit if needed
-  if(globalSettings.showLeadingZero || hour / 10 != 0) {
-    ClockDigit_setNumber(&clockDigits[0], hour / 10, current_font);
-  } else {
-    ClockDigit_setBlank(&clockDigits[0]);
+  SidebarWidgets_setData(&newState.widgetData);
+
+  if(changes & DISPLAY_CHANGED_SIDEBAR_LAYOUT) {
+    Sidebar_invalidateLayout();
   }
 
-  ClockDigit_setNumber(&clockDigits[1], hour % 10, current_font);
+  Sidebar_redrawWidgets((changes & DISPLAY_CHANGED_ALL_SLOTS) >> 8);
+
+  renderedState = newState;
+}
+
+/*
+ * Checks whether night mode started or ended, and when it ends catches up on
+ * the weather that wasn't polled for in the night. Returns true if night
+ * mode changed
+ */
+static bool updateNightMode() {
+  bool wasAsleep = NightMode_isAsleep;
+  bool changed = NightMode_update(time(NULL));
+
+  // replays need every change of sleep, even one that doesn't end the night
+  if(changed || NightMode_isAsleep != wasAsleep) {
+    EventTrace_recordNightMode();
+  }
 
-  if(globalSettings.clockFontId == FONT_SETTING_BOLD_H) {
-    current_font = FONT_SETTING_DEFAULT;
-  } else if(globalSettings.clockFontId == FONT_SETTING_BOLD_M) {
-    current_font = FONT_SETTING_BOLD;
+  if(!changed) {
+    return false;
   }
 
-  ClockDigit_setNumber(&clockDigits[2], timeInfo->tm_min  / 10, current_font);
-  ClockDigit_setNumber(&clockDigits[3], timeInfo->tm_min  % 10, current_font);
+  if(!NightMode_isActive && !globalSettings.disableWeather && isPhoneConnected) {
+    messaging_requestNewWeatherData();
+  }
 
-  Sidebar_updateTime(timeInfo);
+  return true;
 }
 
-/* forces everything on screen to be redrawn -- perfect for keeping track of settings! */
-void redrawScreen() {
+// the seconds widget needs second ticks, but nobody is watching it at night,
+// and they aren't worth a low battery
+bool ticksEverySecond() {
+  return globalSettings.updateScreenEverySecond && !NightMode_isActive &&
+         PowerPolicy_current->allowSecondTicks;
+}
 
-  // check if the tick handler frequency should be changed
-  if(globalSettings.updateScreenEverySecond != updatingEverySecond) {
+// checks if the tick handler frequency should be changed
+static void updateTickSubscription() {
+  if(ticksEverySecond() != updatingEverySecond) {
     tick_timer_service_unsubscribe();
 
-    if(globalSettings.updateScreenEverySecond) {
+    if(ticksEverySecond()) {
       tick_timer_service_subscribe(SECOND_UNIT, tick_handler);
       updatingEverySecond = true;
     } else {
       tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
       updatingEverySecond = false;
     }
-  }
 
-  // maybe the colors changed!
-  for(int i = 0; i < 4; i++) {
-    ClockDigit_setColor(&clockDigits[i], globalSettings.timeColor, globalSettings.timeBgColor);
-    // ClockDigit_setColor(&clockDigits[i], globalSettings.timeColor, GColorWhite);
+    EventTrace_recordTickRate(updatingEverySecond);
   }
+}
 
-  window_set_background_color(mainWindow, globalSettings.timeBgColor);
+/* forces everything on screen to be redrawn -- perfect for keeping track of settings! */
+void redrawScreen() {
 
-  // or maybe the sidebar position changed!
-  int digitOffset = (globalSettings.sidebarOnLeft) ? 30 : 0;
+  // the night mode settings may have changed
+  updateNightMode();
+  updateTickSubscription();
 
-  for(int i = 0; i < 4; i++) {
-    ClockDigit_offsetPosition(&clockDigits[i], digitOffset);
-  }
+  // the chime settings may have changed too
+  Chime_schedule();
 
-  // maybe the language changed!
+  // maybe the colors or language changed! forget what was drawn before,
+  // so that everything is updated
+  renderedState.isValid = false;
   update_clock();
 
-  // update the sidebar
+  // update the sidebar, whose widgets may have changed size
+  Sidebar_invalidateLayout();
   Sidebar_redraw();
 }
 
+/*
+ * Re-applies only what a message from the phone changed. New weather just
+ * goes through update_clock, which repaints the widgets showing it
+ */
+static void messageProcessed(uint32_t changes) {
+  // the seconds widget and night mode decide how often the face ticks
+  if(changes & (SETTINGS_CHANGED_WIDGETS | SETTINGS_CHANGED_NIGHT_MODE)) {
+    updateNightMode();
+    updateTickSubscription();
+  }
+
+  if(changes & SETTINGS_CHANGED_ALERTS) {
+    Chime_schedule();
+  }
+
+  // these change what the widgets draw in ways the display state doesn't
+  // record, and may change their sizes
+  if(changes & (SETTINGS_CHANGED_COLORS | SETTINGS_CHANGED_FONTS | SETTINGS_CHANGED_LAYOUT |
+                SETTINGS_CHANGED_WIDGETS | SETTINGS_CHANGED_LANGUAGE)) {
+    renderedState.isValid = false;
+    Sidebar_invalidateLayout();
+    Sidebar_redraw();
+  }
+
+  update_clock();
+}
+
+static void clockLayerUpdate(Layer* layer, GContext* ctx) {
+  for(int i = 0; i < 4; i++) {
+    ClockDigit_draw(&clockDigits[i], ctx);
+  }
+}
+
 static void main_window_load(Window *window) {
 
   #ifdef PBL_ROUND
@@ -125,14 +206,18 @@ static void main_window_load(Window *window) {
     GPoint digitPoints[4] = {GPoint(7, 7), GPoint(60, 7), GPoint(7, 90), GPoint(60, 90)};
   #endif
 
-  ClockDigit_construct(&clockDigits[0], digitPoints[0]);
-  ClockDigit_construct(&clockDigits[1], digitPoints[1]);
-  ClockDigit_construct(&clockDigits[2], digitPoints[2]);
-  ClockDigit_construct(&clockDigits[3], digitPoints[3]);
+  // one layer, covering the window, draws all the digits
+  clockLayer = layer_create(layer_get_bounds(window_get_root_layer(window)));
+  layer_set_update_proc(clockLayer, clockLayerUpdate);
+  layer_add_child(window_get_root_layer(window), clockLayer);
+
+  ClockDigit_construct(&clockDigits[0], digitPoints[0], clockLayer);
+  ClockDigit_construct(&clockDigits[1], digitPoints[1], clockLayer);
+  ClockDigit_construct(&clockDigits[2], digitPoints[2], clockLayer);
+  ClockDigit_construct(&clockDigits[3], digitPoints[3], clockLayer);
 
   for(int i = 0; i < 4; i++) {
     ClockDigit_setColor(&clockDigits[i], globalSettings.timeColor, globalSettings.timeBgColor);
-    layer_add_child(window_get_root_layer(window), bitmap_layer_get_layer(clockDigits[i].imageLayer));
   }
 
   window_set_background_color(window, globalSettings.timeBgColor);
@@ -150,40 +235,60 @@ static void main_window_unload(Window *window) {
     ClockDigit_destruct(&clockDigits[i]);
   }
 
+  layer_destroy(clockLayer);
+  ClockGlyphs_deinit();
+
   Sidebar_deinit();
 }
 
 void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
+  EventTrace_recordTick(units_changed);
 
-  // every 30 minutes, request new weather data
+  // check for the start and end of the night once a minute
+  bool nightModeChanged = (units_changed & MINUTE_UNIT) && updateNightMode();
+
+  // every 30 minutes (or however often the battery allows), request new
+  // weather data, unless the hourly forecast still has plenty of hours left
+  // and the battery tier doesn't call for fresher weather. a new day needs a
+  // new high and low, though (there is no polling at night: waking up brings
+  // the weather up to date)
   if(!globalSettings.disableWeather) {
-    if(tick_time->tm_min % 30 == 0 && tick_time->tm_sec == 0) {
-      messaging_requestNewWeatherData();
-    }
-  }
+    int minuteOfDay = tick_time->tm_hour * 60 + tick_time->tm_min;
 
-  // every hour, if requested, vibrate
-  if(tick_time->tm_sec == 0) {
-    if(globalSettings.hourlyVibe == 1) { // hourly vibes only
-      if(tick_time->tm_min % 60 == 0) {
-        vibes_short_pulse();
-      }
-    } else if(globalSettings.hourlyVibe == 2) {  // hourly and half-hourly
-      if(tick_time->tm_min % 60 == 0) {
-        vibes_double_pulse();
-      } else if(tick_time->tm_min % 30 == 0) {
-        vibes_short_pulse();
+    if(minuteOfDay % PowerPolicy_current->weatherMinutes == 0 && tick_time->tm_sec == 0 &&
+       !NightMode_isActive && !nightModeChanged) {
+      bool isNewDay = tick_time->tm_hour == 0 && tick_time->tm_min == 0;
+
+      if(isNewDay || PowerPolicy_current->alwaysRefreshWeather ||
+         Weather_getHoursAhead(time(NULL)) < WEATHER_HOURLY_REFRESH_HOURS) {
+        messaging_requestNewWeatherData();
       }
     }
+
+    // at the start of every hour, show that hour's forecast as the current weather
+    if(tick_time->tm_min == 0 && tick_time->tm_sec == 0) {
+      Weather_updateFromHourly(time(NULL));
+    }
   }
 
-  update_clock();
+  // every hour (or half hour), if requested, vibrate
+  Chime_update(time(NULL));
+
+  // a change of night mode switches between second and minute ticks
+  if(nightModeChanged) {
+    redrawScreen();
+  } else {
+    update_clock();
+  }
 }
 
 void bluetoothStateChanged(bool newConnectionState) {
+  EventTrace_recordBluetooth(newConnectionState);
+
   // if the phone was connected but isn't anymore and the user has opted in,
   // trigger a vibration
-  if(isPhoneConnected && !newConnectionState && globalSettings.btVibe) {
+  if(isPhoneConnected && !newConnectionState && globalSettings.btVibe &&
+     PowerPolicy_current->allowBluetoothVibe) {
     static uint32_t const segments[] = { 200, 100, 100, 100, 500 };
     VibePattern pat = {
       .durations = segments,
@@ -193,18 +298,26 @@ void bluetoothStateChanged(bool newConnectionState) {
   }
 
   // if the phone was disconnected and isn't anymore, update the data
-  if(!isPhoneConnected && newConnectionState) {
+  if(!isPhoneConnected && newConnectionState && !NightMode_isActive) {
     messaging_requestNewWeatherData();
   }
 
   isPhoneConnected = newConnectionState;
 
-  Sidebar_redraw();
+  // the disconnection widget may need to be shown or hidden
+  update_clock();
 }
 
-// force the sidebar to redraw any time the battery state changes
+// update the sidebar any time the battery state changes, and everything
+// else too if that calls for a different power policy
 void batteryStateChanged(BatteryChargeState charge_state) {
-  Sidebar_redraw();
+  EventTrace_recordBattery(charge_state);
+
+  if(PowerPolicy_update(charge_state)) {
+    redrawScreen();
+  } else {
+    update_clock();
+  }
 }
 
 static void init() {
@@ -216,8 +329,14 @@ static void init() {
   // init weather system
   Weather_init();
 
+  // load the step history saved last time, before the first tick reads more
+  HealthHistory_init();
+
   // init the messaging thing
-  messaging_init(redrawScreen);
+  messaging_init(messageProcessed);
+
+  // pick how much work to do for the current battery level
+  PowerPolicy_update(battery_state_service_peek());
 
   // Create main Window element and assign to pointer
   mainWindow = window_create();
@@ -232,7 +351,7 @@ static void init() {
   window_stack_push(mainWindow, true);
 
   // Register with TickTimerService
-  if(globalSettings.updateScreenEverySecond) {
+  if(ticksEverySecond()) {
     tick_timer_service_subscribe(SECOND_UNIT, tick_handler);
     updatingEverySecond = true;
   } else {
@@ -246,14 +365,21 @@ static void init() {
 
   // register with battery service
   battery_state_service_subscribe(batteryStateChanged);
+
+  // start recording events; the session records the state we started in
+  EventTrace_init(updatingEverySecond);
 }
 
 static void deinit() {
+  messaging_deinit();
+  EventTrace_deinit();
+
   // Destroy Window
   window_destroy(mainWindow);
 
   // unload weather stuff
   Weather_deinit();
+  HealthHistory_deinit();
   Settings_deinit();
 
   bluetooth_connection_service_unsubscribe();
@@ -264,4 +390,6 @@ int main(void) {
   init();
   app_event_loop();
   deinit();
+
+  return 0;
 }
@@ -2,18 +2,65 @@
 #include "weather.h"
 #include "settings.h"
 #include "messaging.h"
+#include "event_trace.h"
+#include "chunked_transfer.h"
 
-void (*message_processed_callback)(void);
+void (*message_processed_callback)(uint32_t changes);
+
+// the largest message is a full set of settings, a little over 300 bytes;
+// anything larger comes in chunks (see chunked_transfer.h)
+#define INBOX_SIZE 512
+
+// a weather request, with where to resume a transfer that broke off
+#define OUTBOX_SIZE 64
+
+// settings wait this long for the rest of a burst before they are applied
+#define SETTINGS_SETTLE_MS 500
+
+static AppTimer* settleTimer;
+
+// what the messages received since the last flush changed
+static uint32_t pendingChanges;
+
+// saves whatever settings changed, and has the face re-apply them
+static void flushPendingChanges(void* context) {
+  settleTimer = NULL;
+
+  uint32_t changes = pendingChanges;
+  pendingChanges = 0;
+
+  if(changes & ~MESSAGE_CHANGED_WEATHER) {
+    Settings_saveToStorage();
+    EventTrace_recordSettings();
+  }
+
+  // notify the main screen of what changed
+  message_processed_callback(changes);
+}
 
 void messaging_requestNewWeatherData() {
-  // just send an empty message for now
   DictionaryIterator *iter;
-  app_message_outbox_begin(&iter);
-  dict_write_uint32(iter, 0, 0);
+
+  // a message is already on its way; its answer will do
+  if(app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    return;
+  }
+
+  dict_write_uint8(iter, KEY_REQUEST_WEATHER, 1);
+
+  // the phone only sends settings that changed, so if we have none saved
+  // (a new install), ask it to send all of them next time
+  if(!persist_exists(SETTINGS_VERSION_KEY)) {
+    dict_write_uint8(iter, KEY_SETTINGS_NEEDED, 1);
+  }
+
+  // if the last forecast stopped coming halfway, the phone can finish it
+  ChunkedTransfer_writeResume(iter);
+
   app_message_outbox_send();
 }
 
-void messaging_init(void (*processed_callback)(void)) {
+void messaging_init(void (*processed_callback)(uint32_t changes)) {
   // register my custom callback
   message_processed_callback = processed_callback;
 
@@ -24,37 +71,44 @@ void messaging_init(void (*processed_callback)(void)) {
   app_message_register_outbox_sent(outbox_sent_callback);
 
   // Open AppMessage
-  app_message_open(1024, 8);
+  app_message_open(INBOX_SIZE, OUTBOX_SIZE);
 
   APP_LOG(APP_LOG_LEVEL_DEBUG, "Watch messaging is started!");
   app_message_register_inbox_received(inbox_received_callback);
 }
 
 void inbox_received_callback(DictionaryIterator *iterator, void *context) {
-  // does this message contain weather information?
-  Tuple *weatherTemp_tuple = dict_find(iterator, KEY_TEMPERATURE);
-  Tuple *weatherConditions_tuple = dict_find(iterator, KEY_CONDITION_CODE);
-  Tuple *weatherIsNight_tuple = dict_find(iterator, KEY_USE_NIGHT_ICON);
+  EventTrace_recordMessage(iterator);
 
-  // forecast info
-  Tuple *weatherForecastCondition_tuple = dict_find(iterator, KEY_FORECAST_CONDITION);
-  Tuple *weatherForecastHigh_tuple = dict_find(iterator, KEY_FORECAST_TEMP_HIGH);
-  Tuple *weatherForecastLow_tuple = dict_find(iterator, KEY_FORECAST_TEMP_LOW);
+  uint32_t changes = 0;
 
-  if(weatherTemp_tuple != NULL && weatherConditions_tuple != NULL && weatherIsNight_tuple != NULL) {
-    bool isNight = (bool)weatherIsNight_tuple->value->int32;
+  // does this message contain weather information?
+  Tuple *weatherData_tuple = dict_find(iterator, KEY_WEATHER_DATA);
 
-    // now set the weather conditions properly
-    Weather_weatherInfo.currentTemp = (int)weatherTemp_tuple->value->int32;
-    Weather_weatherForecast.highTemp = (int)weatherForecastHigh_tuple->value->int32;
-    Weather_weatherForecast.lowTemp = (int)weatherForecastLow_tuple->value->int32;
+  if(weatherData_tuple != NULL) {
+    if(Weather_setFromData(weatherData_tuple->value->data, weatherData_tuple->length)) {
+      Weather_saveData();
+      changes |= MESSAGE_CHANGED_WEATHER;
+    }
+  }
 
-    Weather_setConditions(weatherConditions_tuple->value->int32, isNight,
-                          weatherForecastCondition_tuple->value->int32);
+  // the forecast for the coming hours in a single tuple, as earlier
+  // versions of the phone script sent it (and older traces replay it)
+  Tuple *hourlyForecast_tuple = dict_find(iterator, KEY_HOURLY_FORECAST);
 
-    Weather_saveData();
+  if(hourlyForecast_tuple != NULL) {
+    if(Weather_setHourlyFromData(hourlyForecast_tuple->value->data, hourlyForecast_tuple->length)) {
+      Weather_saveHourlyData();
+      changes |= MESSAGE_CHANGED_WEATHER;
+    }
   }
 
+  // the forecast itself now comes in chunks, the first with the weather
+  changes |= ChunkedTransfer_receive(iterator);
+
+  // keep the settings as they were, to see what the message changed
+  Settings oldSettings = globalSettings;
+
   // does this message contain new config information?
   Tuple *timeColor_tuple = dict_find(iterator, KEY_SETTING_COLOR_TIME);
   Tuple *bgColor_tuple = dict_find(iterator, KEY_SETTING_COLOR_BG);
@@ -69,6 +123,12 @@ void inbox_received_callback(DictionaryIterator *iterator, void *context) {
   Tuple *disableWeather_tuple = dict_find(iterator, KEY_SETTING_DISABLE_WEATHER);
   Tuple *clockFont_tuple = dict_find(iterator, KEY_SETTING_CLOCK_FONT_ID);
   Tuple *hourlyVibe_tuple = dict_find(iterator, KEY_SETTING_HOURLY_VIBE);
+  Tuple *chimePattern_tuple = dict_find(iterator, KEY_SETTING_CHIME_PATTERN);
+  Tuple *quietHoursStart_tuple = dict_find(iterator, KEY_SETTING_QUIET_HOURS_START);
+  Tuple *quietHoursEnd_tuple = dict_find(iterator, KEY_SETTING_QUIET_HOURS_END);
+  Tuple *nightMode_tuple = dict_find(iterator, KEY_SETTING_NIGHT_MODE);
+  Tuple *nightStartHour_tuple = dict_find(iterator, KEY_SETTING_NIGHT_START_HOUR);
+  Tuple *nightEndHour_tuple = dict_find(iterator, KEY_SETTING_NIGHT_END_HOUR);
   Tuple *useLargeFonts_tuple = dict_find(iterator, KEY_SETTING_USE_LARGE_FONTS);
 
   Tuple *widget0Id_tuple = dict_find(iterator, KEY_WIDGET_0_ID);
@@ -135,8 +195,28 @@ void inbox_received_callback(DictionaryIterator *iterator, void *context) {
     globalSettings.hourlyVibe = hourlyVibe_tuple->value->int8;
   }
 
-  if(language_tuple != NULL) {
-    globalSettings.languageId = language_tuple->value->int8;
+  if(chimePattern_tuple != NULL) {
+    globalSettings.chimePattern = chimePattern_tuple->value->int8;
+  }
+
+  if(quietHoursStart_tuple != NULL) {
+    globalSettings.quietHoursStart = quietHoursStart_tuple->value->int8;
+  }
+
+  if(quietHoursEnd_tuple != NULL) {
+    globalSettings.quietHoursEnd = quietHoursEnd_tuple->value->int8;
+  }
+
+  if(nightMode_tuple != NULL) {
+    globalSettings.nightModeEnabled = (bool)nightMode_tuple->value->int8;
+  }
+
+  if(nightStartHour_tuple != NULL) {
+    globalSettings.nightStartHour = nightStartHour_tuple->value->int8;
+  }
+
+  if(nightEndHour_tuple != NULL) {
+    globalSettings.nightEndHour = nightEndHour_tuple->value->int8;
   }
 
   if(language_tuple != NULL) {
@@ -156,7 +236,7 @@ void inbox_received_callback(DictionaryIterator *iterator, void *context) {
   }
 
   if(altclockName_tuple != NULL) {
-    strncpy(globalSettings.altclockName, altclockName_tuple->value->cstring, sizeof(globalSettings.altclockName));
+    snprintf(globalSettings.altclockName, sizeof(globalSettings.altclockName), "%s", altclockName_tuple->value->cstring);
   }
 
   if(altclockOffset_tuple != NULL) {
@@ -175,11 +255,34 @@ void inbox_received_callback(DictionaryIterator *iterator, void *context) {
     globalSettings.healthUseRestfulSleep = (bool)healthUseRestfulSleep_tuple->value->int8;
   }
 
-  // save the new settings to persistent storage
-  Settings_saveToStorage();
+  // the dynamic settings follow from the others, whatever the phone sent
+  Settings_updateDynamicSettings();
+  pendingChanges |= changes | Settings_diff(&oldSettings, &globalSettings);
+
+  // settings come in bursts while the user tries things out, so saving
+  // them and redrawing waits until the burst is over. Weather on its own
+  // is shown straight away
+  if(pendingChanges & ~MESSAGE_CHANGED_WEATHER) {
+    if(!settleTimer || !app_timer_reschedule(settleTimer, SETTINGS_SETTLE_MS)) {
+      settleTimer = app_timer_register(SETTINGS_SETTLE_MS, flushPendingChanges, NULL);
+    }
+  } else if(pendingChanges) {
+    flushPendingChanges(NULL);
+  }
+}
+
+void messaging_deinit() {
+  if(settleTimer) {
+    app_timer_cancel(settleTimer);
+    settleTimer = NULL;
+  }
+
+  // the settings themselves are saved by Settings_deinit
+  if(pendingChanges & ~MESSAGE_CHANGED_WEATHER) {
+    EventTrace_recordSettings();
+  }
 
-  // notify the main screen, in case something changed
-  message_processed_callback();
+  pendingChanges = 0;
 }
 
 void inbox_dropped_callback(AppMessageResult reason, void *context) {
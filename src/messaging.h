@@ -1,9 +1,26 @@
 #pragma once
 #include <pebble.h>
 
-#define KEY_TEMPERATURE                 3
-#define KEY_CONDITION_CODE              4
-#define KEY_USE_NIGHT_ICON              5
+/*
+ * The messages between the watch and the phone, by the keys they carry:
+ *
+ * phone to watch
+ *   settings:  any of the KEY_SETTING_* and KEY_WIDGET_* keys, only those
+ *              that changed unless the watch asked for all of them
+ *   weather:   KEY_WEATHER_DATA, usually with the first chunk of the hourly
+ *              forecast
+ *   chunk:     KEY_CHUNK_STREAM, _ID, _OFFSET, _LENGTH and _DATA, a piece of
+ *              a transfer too large for one message (see chunked_transfer.h)
+ *
+ * watch to phone
+ *   weather request:  KEY_REQUEST_WEATHER, plus KEY_SETTINGS_NEEDED when the
+ *                     watch has no saved settings, and the resume keys below
+ *                     when a transfer broke off
+ *   resume:           KEY_CHUNK_STREAM, KEY_CHUNK_ID and KEY_CHUNK_OFFSET, the
+ *                     next chunk the watch needs; sent alone when chunks go
+ *                     missing
+ */
+
 #define KEY_SETTING_COLOR_TIME          6
 #define KEY_SETTING_COLOR_BG            7
 #define KEY_SETTING_COLOR_SIDEBAR       8
@@ -21,18 +38,40 @@
 #define KEY_WIDGET_0_ID                 22
 #define KEY_WIDGET_1_ID                 23
 #define KEY_WIDGET_2_ID                 24
-#define KEY_FORECAST_CONDITION          25
-#define KEY_FORECAST_TEMP_HIGH          26
-#define KEY_FORECAST_TEMP_LOW           27
 #define KEY_SETTING_ALTCLOCK_NAME       28
 #define KEY_SETTING_ALTCLOCK_OFFSET     29
 #define KEY_SETTING_DECIMAL_SEPARATOR   30
 #define KEY_SETTING_HEALTH_USE_DISTANCE 31
 #define KEY_SETTING_HEALTH_USE_RESTFUL_SLEEP 32
+#define KEY_WEATHER_DATA                33
+#define KEY_SETTINGS_NEEDED             34
+#define KEY_HOURLY_FORECAST             35
+#define KEY_SETTING_CHIME_PATTERN       36
+#define KEY_SETTING_QUIET_HOURS_START   37
+#define KEY_SETTING_QUIET_HOURS_END     38
+#define KEY_SETTING_NIGHT_MODE          39
+#define KEY_SETTING_NIGHT_START_HOUR    40
+#define KEY_SETTING_NIGHT_END_HOUR      41
+#define KEY_CHUNK_STREAM                42
+#define KEY_CHUNK_ID                    43
+#define KEY_CHUNK_OFFSET                44
+#define KEY_CHUNK_LENGTH                45
+#define KEY_CHUNK_DATA                  46
+#define KEY_REQUEST_WEATHER             47
+
+/*
+ * Once a message is processed, the callback is passed what it changed: the
+ * SETTINGS_CHANGED_* flags of settings.h, and this one for new weather
+ */
+#define MESSAGE_CHANGED_WEATHER         (1 << 16)
 
 void messaging_requestNewWeatherData();
 
-void messaging_init(void (*message_processed_callback)(void));
+void messaging_init(void (*message_processed_callback)(uint32_t changes));
+
+// stops waiting for the rest of a settings burst; call before exiting, ahead
+// of Settings_deinit, which saves the settings
+void messaging_deinit();
 void inbox_received_callback(DictionaryIterator *iterator, void *context);
 void inbox_dropped_callback(AppMessageResult reason, void *context);
 void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context);
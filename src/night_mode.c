@@ -0,0 +1,48 @@
+#include <pebble.h>
+#include "settings.h"
+#include "night_mode.h"
+
+bool NightMode_isActive;
+bool NightMode_isAsleep;
+
+static bool isScheduledNight(time_t t) {
+  int start = globalSettings.nightStartHour;
+  int end = globalSettings.nightEndHour;
+
+  // the same start and end hour means there is no schedule
+  if(start == end) {
+    return false;
+  }
+
+  int hour = localtime(&t)->tm_hour;
+
+  // the night usually runs past midnight
+  if(start < end) {
+    return hour >= start && hour < end;
+  } else {
+    return hour >= start || hour < end;
+  }
+}
+
+static bool isAsleep() {
+  #ifdef PBL_HEALTH
+    HealthActivityMask activities = health_service_peek_current_activities();
+
+    return activities & (HealthActivitySleep | HealthActivityRestfulSleep);
+  #else
+    return false;
+  #endif
+}
+
+bool NightMode_update(time_t now) {
+  NightMode_isAsleep = globalSettings.nightModeEnabled && isAsleep();
+
+  bool isNight = globalSettings.nightModeEnabled && (NightMode_isAsleep || isScheduledNight(now));
+
+  if(isNight == NightMode_isActive) {
+    return false;
+  }
+
+  NightMode_isActive = isNight;
+  return true;
+}
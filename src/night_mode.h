@@ -0,0 +1,22 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * While the wearer sleeps, the face sheds the work nobody is looking at: it
+ * ticks once a minute, doesn't poll for weather or chime, and leaves the
+ * health widget on its sleep view. Night mode follows the health service's
+ * sleep tracking, and also covers the scheduled night hours in the settings,
+ * for watches without health or nights it doesn't notice.
+ */
+
+extern bool NightMode_isActive;
+
+// whether the health service said the wearer was asleep, the last time night
+// mode was updated; it isn't asked while night mode is off in the settings
+extern bool NightMode_isAsleep;
+
+/*
+ * Works out whether it is night for the given time. Returns true if that
+ * changed, in which case the caller should bring the face up to date
+ */
+bool NightMode_update(time_t now);
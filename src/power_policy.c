@@ -0,0 +1,46 @@
+#include <pebble.h>
+#include "power_policy.h"
+
+// indexed by PowerTier
+static const PowerPolicy policies[] = {
+  // charging: power is free, so the weather can be fresher
+  { .allowSecondTicks = true,  .weatherMinutes = 15,  .alwaysRefreshWeather = true,
+    .healthMinutes = 1,  .allowChimes = true,  .allowBluetoothVibe = true },
+
+  // normal
+  { .allowSecondTicks = true,  .weatherMinutes = 30,  .alwaysRefreshWeather = false,
+    .healthMinutes = 1,  .allowChimes = true,  .allowBluetoothVibe = true },
+
+  // low
+  { .allowSecondTicks = false, .weatherMinutes = 60,  .alwaysRefreshWeather = false,
+    .healthMinutes = 5,  .allowChimes = true,  .allowBluetoothVibe = true },
+
+  // critical: only what keeps the face useful as a clock
+  { .allowSecondTicks = false, .weatherMinutes = 180, .alwaysRefreshWeather = false,
+    .healthMinutes = 15, .allowChimes = false, .allowBluetoothVibe = false }
+};
+
+PowerTier PowerPolicy_tier = POWER_TIER_NORMAL;
+const PowerPolicy* PowerPolicy_current = &policies[POWER_TIER_NORMAL];
+
+bool PowerPolicy_update(BatteryChargeState chargeState) {
+  PowerTier tier;
+
+  if(chargeState.is_charging) {
+    tier = POWER_TIER_CHARGING;
+  } else if(chargeState.charge_percent <= POWER_POLICY_CRITICAL_PERCENT) {
+    tier = POWER_TIER_CRITICAL;
+  } else if(chargeState.charge_percent <= POWER_POLICY_LOW_PERCENT) {
+    tier = POWER_TIER_LOW;
+  } else {
+    tier = POWER_TIER_NORMAL;
+  }
+
+  if(tier == PowerPolicy_tier) {
+    return false;
+  }
+
+  PowerPolicy_tier = tier;
+  PowerPolicy_current = &policies[tier];
+  return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * How much background work the face does, depending on the battery. Each
+ * tier sets how often things are refreshed, and which optional extras are
+ * allowed; the face applies a change of tier through redrawScreen, like a
+ * change of settings.
+ */
+
+// at or below these charge percentages the battery is low or critical
+#define POWER_POLICY_LOW_PERCENT      20
+#define POWER_POLICY_CRITICAL_PERCENT 10
+
+typedef enum {
+  POWER_TIER_CHARGING = 0,
+  POWER_TIER_NORMAL   = 1,
+  POWER_TIER_LOW      = 2,
+  POWER_TIER_CRITICAL = 3
+} PowerTier;
+
+typedef struct {
+  // whether the seconds widget may tick every second
+  bool allowSecondTicks;
+
+  // minutes between weather requests (a multiple of 30 fits the clock best).
+  // While the hourly forecast has WEATHER_HOURLY_REFRESH_HOURS left, the
+  // weather isn't requested at all, unless the tier always refreshes it
+  uint8_t weatherMinutes;
+  bool alwaysRefreshWeather;
+
+  // minutes between health service queries for the health widget
+  uint8_t healthMinutes;
+
+  // whether the hourly chimes and the bluetooth disconnection vibration may vibrate
+  bool allowChimes;
+  bool allowBluetoothVibe;
+} PowerPolicy;
+
+extern PowerTier PowerPolicy_tier;
+
+// the policy for the current tier
+extern const PowerPolicy* PowerPolicy_current;
+
+/*
+ * Picks the tier for the given battery state. Returns true if it changed, in
+ * which case the caller should apply the new policy
+ */
+bool PowerPolicy_update(BatteryChargeState chargeState);
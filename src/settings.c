@@ -4,8 +4,10 @@
 Settings globalSettings;
 
 void Settings_init() {
-  // first, check if we have any saved settings
-  int settingsVersion = persist_read_int(SETTINGS_VERSION_KEY);
+  #ifndef PBL_COLOR
+    // first, check if we have any saved settings
+    int settingsVersion = persist_read_int(SETTINGS_VERSION_KEY);
+  #endif
 
   // load all settings
   Settings_loadFromStorage();
@@ -82,6 +84,12 @@ void Settings_loadFromStorage() {
   globalSettings.disableWeather         = persist_read_bool(SETTING_DISABLE_WEATHER_KEY);
   globalSettings.clockFontId            = persist_read_int(SETTING_CLOCK_FONT_ID_KEY);
   globalSettings.hourlyVibe             = persist_read_int(SETTING_HOURLY_VIBE_KEY);
+  globalSettings.chimePattern           = persist_read_int(SETTING_CHIME_PATTERN_KEY);
+  globalSettings.quietHoursStart        = persist_read_int(SETTING_QUIET_HOURS_START_KEY);
+  globalSettings.quietHoursEnd          = persist_read_int(SETTING_QUIET_HOURS_END_KEY);
+  globalSettings.nightModeEnabled       = persist_read_bool(SETTING_NIGHT_MODE_KEY);
+  globalSettings.nightStartHour         = persist_read_int(SETTING_NIGHT_START_HOUR_KEY);
+  globalSettings.nightEndHour           = persist_read_int(SETTING_NIGHT_END_HOUR_KEY);
   globalSettings.useLargeFonts          = persist_read_bool(SETTING_USE_LARGE_FONTS_KEY);
   globalSettings.altclockOffset         = persist_read_int(SETTING_ALTCLOCK_OFFSET_KEY);
   globalSettings.healthUseDistance      = persist_read_bool(SETTING_HEALTH_USE_DISTANCE);
@@ -114,6 +122,12 @@ void Settings_saveToStorage() {
   persist_write_bool(SETTING_DISABLE_WEATHER_KEY,       globalSettings.disableWeather);
   persist_write_int(SETTING_CLOCK_FONT_ID_KEY,          globalSettings.clockFontId);
   persist_write_int( SETTING_HOURLY_VIBE_KEY,           globalSettings.hourlyVibe);
+  persist_write_int( SETTING_CHIME_PATTERN_KEY,         globalSettings.chimePattern);
+  persist_write_int( SETTING_QUIET_HOURS_START_KEY,     globalSettings.quietHoursStart);
+  persist_write_int( SETTING_QUIET_HOURS_END_KEY,       globalSettings.quietHoursEnd);
+  persist_write_bool(SETTING_NIGHT_MODE_KEY,            globalSettings.nightModeEnabled);
+  persist_write_int( SETTING_NIGHT_START_HOUR_KEY,      globalSettings.nightStartHour);
+  persist_write_int( SETTING_NIGHT_END_HOUR_KEY,        globalSettings.nightEndHour);
   persist_write_bool(SETTING_USE_LARGE_FONTS_KEY,       globalSettings.useLargeFonts);
   persist_write_int(SETTING_SIDEBAR_WIDGET0_KEY,        globalSettings.widgets[0]);
   persist_write_int(SETTING_SIDEBAR_WIDGET1_KEY,        globalSettings.widgets[1]);
@@ -127,6 +141,60 @@ void Settings_saveToStorage() {
   persist_write_int(SETTINGS_VERSION_KEY,               CURRENT_SETTINGS_VERSION);
 }
 
+uint32_t Settings_diff(const Settings* oldSettings, const Settings* newSettings) {
+  uint32_t changes = 0;
+
+  if(!gcolor_equal(oldSettings->timeColor, newSettings->timeColor) ||
+     !gcolor_equal(oldSettings->timeBgColor, newSettings->timeBgColor) ||
+     !gcolor_equal(oldSettings->sidebarColor, newSettings->sidebarColor) ||
+     !gcolor_equal(oldSettings->sidebarTextColor, newSettings->sidebarTextColor)) {
+    changes |= SETTINGS_CHANGED_COLORS;
+  }
+
+  // how the clock digits and the sidebar text look
+  if(oldSettings->clockFontId != newSettings->clockFontId ||
+     oldSettings->showLeadingZero != newSettings->showLeadingZero ||
+     oldSettings->useLargeFonts != newSettings->useLargeFonts) {
+    changes |= SETTINGS_CHANGED_FONTS;
+  }
+
+  if(oldSettings->sidebarOnLeft != newSettings->sidebarOnLeft) {
+    changes |= SETTINGS_CHANGED_LAYOUT;
+  }
+
+  // which widgets are shown, and the options that change what they show
+  if(memcmp(oldSettings->widgets, newSettings->widgets, sizeof(newSettings->widgets)) != 0 ||
+     oldSettings->useMetric != newSettings->useMetric ||
+     oldSettings->showBatteryPct != newSettings->showBatteryPct ||
+     strncmp(oldSettings->altclockName, newSettings->altclockName, sizeof(newSettings->altclockName)) != 0 ||
+     oldSettings->altclockOffset != newSettings->altclockOffset ||
+     oldSettings->healthUseDistance != newSettings->healthUseDistance ||
+     oldSettings->healthUseRestfulSleep != newSettings->healthUseRestfulSleep ||
+     oldSettings->decimalSeparator != newSettings->decimalSeparator) {
+    changes |= SETTINGS_CHANGED_WIDGETS;
+  }
+
+  if(oldSettings->languageId != newSettings->languageId) {
+    changes |= SETTINGS_CHANGED_LANGUAGE;
+  }
+
+  if(oldSettings->btVibe != newSettings->btVibe ||
+     oldSettings->hourlyVibe != newSettings->hourlyVibe ||
+     oldSettings->chimePattern != newSettings->chimePattern ||
+     oldSettings->quietHoursStart != newSettings->quietHoursStart ||
+     oldSettings->quietHoursEnd != newSettings->quietHoursEnd) {
+    changes |= SETTINGS_CHANGED_ALERTS;
+  }
+
+  if(oldSettings->nightModeEnabled != newSettings->nightModeEnabled ||
+     oldSettings->nightStartHour != newSettings->nightStartHour ||
+     oldSettings->nightEndHour != newSettings->nightEndHour) {
+    changes |= SETTINGS_CHANGED_NIGHT_MODE;
+  }
+
+  return changes;
+}
+
 void Settings_updateDynamicSettings() {
   globalSettings.disableWeather = true;
   globalSettings.updateScreenEverySecond = false;
@@ -135,7 +203,8 @@ void Settings_updateDynamicSettings() {
   for(int i = 0; i < 3; i++) {
     // if there are any weather widgets, enable weather checking
     if(globalSettings.widgets[i] == WEATHER_CURRENT ||
-       globalSettings.widgets[i] == WEATHER_FORECAST_TODAY) {
+       globalSettings.widgets[i] == WEATHER_FORECAST_TODAY ||
+       globalSettings.widgets[i] == HOURLY_FORECAST) {
 
       globalSettings.disableWeather = false;
     }
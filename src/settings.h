@@ -21,7 +21,15 @@ typedef struct {
 
   // vibration settings
   bool btVibe;
-  bool hourlyVibe;
+  uint8_t hourlyVibe;
+  uint8_t chimePattern;
+  uint8_t quietHoursStart;
+  uint8_t quietHoursEnd;
+
+  // night mode settings
+  bool nightModeEnabled;
+  uint8_t nightStartHour;
+  uint8_t nightEndHour;
 
   // sidebar settings
   SidebarWidgetType widgets[3];
@@ -71,6 +79,14 @@ extern Settings globalSettings;
 // vibration settings
 #define SETTING_BT_VIBE_KEY               23
 #define SETTING_HOURLY_VIBE_KEY           14
+#define SETTING_CHIME_PATTERN_KEY         36
+#define SETTING_QUIET_HOURS_START_KEY     37
+#define SETTING_QUIET_HOURS_END_KEY       38
+
+// night mode settings
+#define SETTING_NIGHT_MODE_KEY            39
+#define SETTING_NIGHT_START_HOUR_KEY      40
+#define SETTING_NIGHT_END_HOUR_KEY        41
 
 // sidebar settings
 #define SETTING_SIDEBAR_WIDGET0_KEY       26
@@ -96,8 +112,24 @@ extern Settings globalSettings;
 #define SETTING_HEALTH_USE_METRIC         35
 #define SETTING_DECIMAL_SEPARATOR_KEY     34
 
+// flags returned by Settings_diff, grouped by what has to be re-applied
+#define SETTINGS_CHANGED_COLORS     (1 << 0)
+#define SETTINGS_CHANGED_FONTS      (1 << 1)
+#define SETTINGS_CHANGED_LAYOUT     (1 << 2)
+#define SETTINGS_CHANGED_WIDGETS    (1 << 3)
+#define SETTINGS_CHANGED_LANGUAGE   (1 << 4)
+#define SETTINGS_CHANGED_ALERTS     (1 << 5)
+#define SETTINGS_CHANGED_NIGHT_MODE (1 << 6)
+
 void Settings_init();
 void Settings_deinit();
 void Settings_loadFromStorage();
 void Settings_saveToStorage();
+
+/*
+ * Compares two sets of settings and returns the SETTINGS_CHANGED_* flags for
+ * every group that differs. The dynamic settings are left out, since they
+ * follow from the others.
+ */
+uint32_t Settings_diff(const Settings* oldSettings, const Settings* newSettings);
 void Settings_updateDynamicSettings();
@@ -5,11 +5,10 @@
 #include "weather.h"
 #include "languages.h"
 #include "sidebar.h"
+#include "sidebar_layout.h"
+#include "power_policy.h"
 #include "sidebar_widgets/sidebar_widgets.h"
 
-#define V_PADDING 8
-#define SCREEN_HEIGHT 168
-
 // "private" functions
 // layer update callbacks
 void updateRectSidebar(Layer *l, GContext* ctx);
@@ -18,21 +17,45 @@ void updateRectSidebar(Layer *l, GContext* ctx);
   void updateRoundSidebarLeft(Layer *l, GContext* ctx);
   void updateRoundSidebarRight(Layer *l, GContext* ctx);
 
+  /*
+   * The round sidebar's arc background, cached as a bitmap so the expensive
+   * radial fill only runs again when the colors change
+   */
+  typedef struct {
+    GBitmap* bitmap;
+    GColor sidebarColor;
+    GColor bgColor;
+  } RoundSidebarBackground;
+
   // shared drawing stuff between all layers
-  void drawRoundSidebar(GContext* ctx, GRect bgBounds, SidebarWidgetType widgetType, int widgetXOffset);
+  void drawRoundSidebar(GContext* ctx, Layer* l, GRect bgBounds, RoundSidebarBackground* background,
+                        SidebarWidgetType widgetType, int widgetXOffset);
 #endif
 
 Layer* sidebarLayer;
 
+// the solved widget positions, reused until the widget set or fonts change
+static SidebarLayout rectLayout;
+static int screenHeight;
+
 #ifdef PBL_ROUND
   Layer* sidebarLayer2;
+
+  // the cached backgrounds: [0] is the left sidebar, [1] the right one
+  static RoundSidebarBackground roundBackgrounds[2];
 #endif
 
+int getReplacableWidget();
+bool isAutoBatteryShown();
+
 void Sidebar_init(Window* window) {
   // init the sidebar layer
   GRect screenRect = layer_get_bounds(window_get_root_layer(window));
   GRect bounds;
 
+  screenHeight = screenRect.size.h;
+  SidebarLayout_invalidate(&rectLayout);
+
   #ifdef PBL_ROUND
     GRect bounds2;
     bounds = GRect(0, 0, 40, screenRect.size.h);
@@ -47,6 +70,7 @@ void Sidebar_init(Window* window) {
 
   // init the widgets
   SidebarWidgets_init();
+  SidebarWidgets_updateFonts();
 
   sidebarLayer = layer_create(bounds);
   layer_add_child(window_get_root_layer(window), sidebarLayer);
@@ -67,19 +91,33 @@ void Sidebar_init(Window* window) {
 void Sidebar_deinit() {
   layer_destroy(sidebarLayer);
 
+  #ifdef PBL_ROUND
+    layer_destroy(sidebarLayer2);
+
+    for(int i = 0; i < 2; i++) {
+      gbitmap_destroy(roundBackgrounds[i].bitmap);
+      roundBackgrounds[i].bitmap = NULL;
+    }
+  #endif
+
   SidebarWidgets_deinit();
 }
 
 void Sidebar_redraw() {
   #ifndef PBL_ROUND
-    // reposition the sidebar if needed
-    if(globalSettings.sidebarOnLeft) {
-      layer_set_frame(sidebarLayer, GRect(0, 0, 30, SCREEN_HEIGHT));
-    } else {
-      layer_set_frame(sidebarLayer, GRect(114, 0, 30, SCREEN_HEIGHT));
+    // reposition the sidebar if needed; moving it marks it dirty, so only
+    // do that when it actually changed sides
+    GRect frame = GRect(globalSettings.sidebarOnLeft ? 0 : 114, 0, 30, screenHeight);
+    GRect currentFrame = layer_get_frame(sidebarLayer);
+
+    if(!grect_equal(&frame, &currentFrame)) {
+      layer_set_frame(sidebarLayer, frame);
     }
   #endif
 
+  // the font size may have been changed
+  SidebarWidgets_updateFonts();
+
   // redraw the layer
   layer_mark_dirty(sidebarLayer);
 
@@ -88,18 +126,54 @@ void Sidebar_redraw() {
   #endif
 }
 
-void Sidebar_updateTime(struct tm* timeInfo) {
-  SidebarWidgets_updateTime(timeInfo);
+void Sidebar_invalidateLayout() {
+  SidebarLayout_invalidate(&rectLayout);
+}
 
-  // redraw the sidebar in case it changed in any way
-  Sidebar_redraw();
+void Sidebar_redrawWidgets(uint8_t slotMask) {
+  #ifdef PBL_ROUND
+    // the left side shows the first widget, the right side the last one
+    if(slotMask & (1 << 0)) {
+      layer_mark_dirty(sidebarLayer);
+    }
+
+    if(slotMask & (1 << 2)) {
+      layer_mark_dirty(sidebarLayer2);
+    }
+  #else
+    if(slotMask) {
+      layer_mark_dirty(sidebarLayer);
+    }
+  #endif
+}
+
+void Sidebar_getDisplayWidgets(SidebarWidgetType* widgets) {
+  // if the pebble is disconnected, show the disconnect icon
+  bool showDisconnectIcon = !bluetooth_connection_service_peek();
+  bool showAutoBattery = isAutoBatteryShown();
+
+  for(int i = 0; i < (int)ARRAY_LENGTH(globalSettings.widgets); i++) {
+    widgets[i] = globalSettings.widgets[i];
+  }
+
+  // do we need to replace a widget?
+  // if so, determine which widget should be replaced
+  if(showAutoBattery || showDisconnectIcon) {
+    int widget_to_replace = getReplacableWidget();
+
+    if(showAutoBattery) {
+      widgets[widget_to_replace] = BATTERY_METER;
+    } else if(showDisconnectIcon) {
+      widgets[widget_to_replace] = BLUETOOTH_DISCONNECT;
+    }
+  }
 }
 
 bool isAutoBatteryShown() {
   BatteryChargeState chargeState = battery_state_service_peek();
 
   if(globalSettings.enableAutoBatteryWidget) {
-    if(chargeState.charge_percent <= 20 || chargeState.is_charging) {
+    if(chargeState.charge_percent <= POWER_POLICY_LOW_PERCENT || chargeState.is_charging) {
       return true;
     }
   }
@@ -118,9 +192,11 @@ int getReplacableWidget() {
     return 2;
   }
 
-  if(globalSettings.widgets[0] == WEATHER_CURRENT || globalSettings.widgets[0] == WEATHER_FORECAST_TODAY) {
+  if(globalSettings.widgets[0] == WEATHER_CURRENT || globalSettings.widgets[0] == WEATHER_FORECAST_TODAY ||
+     globalSettings.widgets[0] == HOURLY_FORECAST) {
     return 0;
-  } else if(globalSettings.widgets[2] == WEATHER_CURRENT || globalSettings.widgets[2] == WEATHER_FORECAST_TODAY) {
+  } else if(globalSettings.widgets[2] == WEATHER_CURRENT || globalSettings.widgets[2] == WEATHER_FORECAST_TODAY ||
+            globalSettings.widgets[2] == HOURLY_FORECAST) {
     return 2;
   }
 
@@ -134,7 +210,7 @@ int getReplacableWidget() {
 // or the disconnection icon
 int getReplacableWidget() {
   // if any widgets are empty, it's an obvious choice
-  for(int i = 0; i < 3; i++) {
+  for(int i = 0; i < (int)ARRAY_LENGTH(globalSettings.widgets); i++) {
     if(globalSettings.widgets[i] == EMPTY) {
       return i;
     }
@@ -142,8 +218,9 @@ int getReplacableWidget() {
 
   // are there any bluetooth-enabled widgets? if so, they're the second-best
   // candidates
-  for(int i = 0; i < 3; i++) {
-    if(globalSettings.widgets[i] == WEATHER_CURRENT || globalSettings.widgets[i] == WEATHER_FORECAST_TODAY) {
+  for(int i = 0; i < (int)ARRAY_LENGTH(globalSettings.widgets); i++) {
+    if(globalSettings.widgets[i] == WEATHER_CURRENT || globalSettings.widgets[i] == WEATHER_FORECAST_TODAY ||
+       globalSettings.widgets[i] == HOURLY_FORECAST) {
       return i;
     }
   }
@@ -160,52 +237,89 @@ void updateRoundSidebarRight(Layer *l, GContext* ctx) {
   GRect bounds = layer_get_bounds(l);
   GRect bgBounds = GRect(bounds.origin.x, bounds.origin.y, bounds.size.h, bounds.size.h);
 
-  bool showDisconnectIcon = !bluetooth_connection_service_peek();
-  bool showAutoBattery = isAutoBatteryShown();
-
-  SidebarWidgetType displayWidget = globalSettings.widgets[2];
-
-  if((showAutoBattery || showDisconnectIcon) && getReplacableWidget() == 2) {
-    if(showAutoBattery) {
-      displayWidget = BATTERY_METER;
-    } else if(showDisconnectIcon) {
-      displayWidget = BLUETOOTH_DISCONNECT;
-    }
-  }
+  SidebarWidgetType displayWidgets[ARRAY_LENGTH(globalSettings.widgets)];
+  Sidebar_getDisplayWidgets(displayWidgets);
 
-  drawRoundSidebar(ctx, bgBounds, displayWidget, 3);
+  drawRoundSidebar(ctx, l, bgBounds, &roundBackgrounds[1], displayWidgets[2], 3);
 }
 
 void updateRoundSidebarLeft(Layer *l, GContext* ctx) {
   GRect bounds = layer_get_bounds(l);
   GRect bgBounds = GRect(bounds.origin.x - bounds.size.h + bounds.size.w, bounds.origin.y, bounds.size.h, bounds.size.h);
 
-  bool showDisconnectIcon = !bluetooth_connection_service_peek();
-  bool showAutoBattery = isAutoBatteryShown();
-  SidebarWidgetType displayWidget = globalSettings.widgets[0];
+  SidebarWidgetType displayWidgets[ARRAY_LENGTH(globalSettings.widgets)];
+  Sidebar_getDisplayWidgets(displayWidgets);
 
-  if((showAutoBattery || showDisconnectIcon) && getReplacableWidget() == 0) {
-    if(showAutoBattery) {
-      displayWidget = BATTERY_METER;
-    } else if(showDisconnectIcon) {
-      displayWidget = BLUETOOTH_DISCONNECT;
+  drawRoundSidebar(ctx, l, bgBounds, &roundBackgrounds[0], displayWidgets[0], 7);
+}
+
+// copies the layer's area of the framebuffer into the background cache
+void cacheRoundSidebarBackground(GContext* ctx, Layer* l, RoundSidebarBackground* background) {
+  GRect bounds = layer_get_bounds(l);
+
+  if(!background->bitmap) {
+    background->bitmap = gbitmap_create_blank(bounds.size, GBitmapFormat8Bit);
+
+    // if we're out of memory, we'll just keep drawing the arc each time
+    if(!background->bitmap) {
+      return;
     }
   }
 
-  drawRoundSidebar(ctx, bgBounds, displayWidget, 7);
-}
+  GBitmap* frameBuffer = graphics_capture_frame_buffer(ctx);
 
-void drawRoundSidebar(GContext* ctx, GRect bgBounds, SidebarWidgetType widgetType, int widgetXOffset) {
-  SidebarWidgets_updateFonts();
+  if(!frameBuffer) {
+    return;
+  }
 
-  graphics_context_set_fill_color(ctx, globalSettings.sidebarColor);
+  // the sidebar layers are direct children of the window, so their frame
+  // origin is also their position in the framebuffer
+  GPoint origin = layer_get_frame(l).origin;
+  uint8_t* cacheData = gbitmap_get_data(background->bitmap);
+  uint16_t cacheBytesPerRow = gbitmap_get_bytes_per_row(background->bitmap);
+
+  for(int y = 0; y < bounds.size.h; y++) {
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(frameBuffer, origin.y + y);
+    uint8_t* cacheRow = cacheData + y * cacheBytesPerRow;
+
+    for(int x = 0; x < bounds.size.w; x++) {
+      int frameBufferX = origin.x + x;
+
+      // pixels outside the round display's visible area don't exist
+      if(frameBufferX >= row.min_x && frameBufferX <= row.max_x) {
+        cacheRow[x] = row.data[frameBufferX];
+      } else {
+        cacheRow[x] = globalSettings.timeBgColor.argb;
+      }
+    }
+  }
 
-  graphics_fill_radial(ctx,
-                       bgBounds,
-                       GOvalScaleModeFillCircle,
-                       100,
-                       DEG_TO_TRIGANGLE(0),
-                       TRIG_MAX_ANGLE);
+  graphics_release_frame_buffer(ctx, frameBuffer);
+
+  background->sidebarColor = globalSettings.sidebarColor;
+  background->bgColor = globalSettings.timeBgColor;
+}
+
+void drawRoundSidebar(GContext* ctx, Layer* l, GRect bgBounds, RoundSidebarBackground* background,
+                      SidebarWidgetType widgetType, int widgetXOffset) {
+  bool backgroundIsCached = background->bitmap != NULL &&
+                            gcolor_equal(background->sidebarColor, globalSettings.sidebarColor) &&
+                            gcolor_equal(background->bgColor, globalSettings.timeBgColor);
+
+  if(backgroundIsCached) {
+    graphics_draw_bitmap_in_rect(ctx, background->bitmap, layer_get_bounds(l));
+  } else {
+    graphics_context_set_fill_color(ctx, globalSettings.sidebarColor);
+
+    graphics_fill_radial(ctx,
+                         bgBounds,
+                         GOvalScaleModeFillCircle,
+                         100,
+                         DEG_TO_TRIGANGLE(0),
+                         TRIG_MAX_ANGLE);
+
+    cacheRoundSidebarBackground(ctx, l, background);
+  }
 
   SidebarWidgets_xOffset = widgetXOffset;
   SidebarWidget widget = getSidebarWidgetByType(widgetType);
@@ -221,50 +335,21 @@ void drawRoundSidebar(GContext* ctx, GRect bgBounds, SidebarWidgetType widgetTyp
 
 
 void updateRectSidebar(Layer *l, GContext* ctx) {
-  SidebarWidgets_updateFonts();
-
   graphics_context_set_fill_color(ctx, globalSettings.sidebarColor);
   graphics_fill_rect(ctx, layer_get_bounds(l), 0, GCornerNone);
 
   graphics_context_set_text_color(ctx, globalSettings.sidebarTextColor);
 
-  // if the pebble is disconnected, show the disconnect icon
-  bool showDisconnectIcon = !bluetooth_connection_service_peek();
-  bool showAutoBattery = isAutoBatteryShown();
-
-  SidebarWidget displayWidgets[3];
+  int widgetCount = ARRAY_LENGTH(globalSettings.widgets);
+  SidebarWidgetType displayWidgets[ARRAY_LENGTH(globalSettings.widgets)];
+  Sidebar_getDisplayWidgets(displayWidgets);
 
-  displayWidgets[0] = getSidebarWidgetByType(globalSettings.widgets[0]);
-  displayWidgets[1] = getSidebarWidgetByType(globalSettings.widgets[1]);
-  displayWidgets[2] = getSidebarWidgetByType(globalSettings.widgets[2]);
+  // only measure the widgets again if the set of widgets or fonts changed
+  int sidebarHeight = layer_get_bounds(l).size.h;
 
-  // do we need to replace a widget?
-  // if so, determine which widget should be replaced
-  if(showAutoBattery || showDisconnectIcon) {
-    int widget_to_replace = getReplacableWidget();
-
-    if(showAutoBattery) {
-      displayWidgets[widget_to_replace] = getSidebarWidgetByType(BATTERY_METER);
-    } else if(showDisconnectIcon) {
-      displayWidgets[widget_to_replace] = getSidebarWidgetByType(BLUETOOTH_DISCONNECT);
-    }
+  if(!SidebarLayout_matches(&rectLayout, displayWidgets, widgetCount, sidebarHeight)) {
+    SidebarLayout_solve(&rectLayout, displayWidgets, widgetCount, sidebarHeight);
   }
 
-  // if the widgets are too tall, enable "compact mode"
-  SidebarWidgets_useCompactMode = false; // ensure that we compare the non-compacted heights
-  int totalHeight = displayWidgets[0].getHeight() + displayWidgets[1].getHeight() + displayWidgets[2].getHeight();
-  SidebarWidgets_useCompactMode = (totalHeight > 142) ? true : false;
-
-  // calculate the three widget positions
-  int topWidgetPos = V_PADDING;
-  int lowerWidgetPos = SCREEN_HEIGHT - V_PADDING - displayWidgets[2].getHeight();
-
-  // vertically center the middle widget using MATH
-  int middleWidgetPos = ((lowerWidgetPos - displayWidgets[1].getHeight()) + (topWidgetPos + displayWidgets[0].getHeight())) / 2;
-
-  // draw the widgets
-  displayWidgets[0].draw(ctx, topWidgetPos);
-  displayWidgets[1].draw(ctx, middleWidgetPos);
-  displayWidgets[2].draw(ctx, lowerWidgetPos);
-
+  SidebarLayout_draw(&rectLayout, ctx);
 }
@@ -1,8 +1,20 @@
 #pragma once
 #include <pebble.h>
+#include "sidebar_widgets/sidebar_widgets.h"
 
 // "public" functions
 void Sidebar_init(Window* window);
 void Sidebar_deinit();
 void Sidebar_redraw();
-void Sidebar_updateTime(struct tm* timeInfo);
+void Sidebar_invalidateLayout();
+
+/*
+ * Redraws only the widget slots whose bits are set in the mask
+ */
+void Sidebar_redrawWidgets(uint8_t slotMask);
+
+/*
+ * Gets the widgets currently shown in each slot, which may differ from the
+ * configured ones when the battery or disconnection widgets take a slot
+ */
+void Sidebar_getDisplayWidgets(SidebarWidgetType* widgets);
@@ -0,0 +1,107 @@
+#include <pebble.h>
+#include "settings.h"
+#include "sidebar_layout.h"
+
+void SidebarLayout_solve(SidebarLayout* layout, const SidebarWidgetType* types, int count, int availableHeight) {
+  int compactHeights[SIDEBAR_LAYOUT_MAX_WIDGETS];
+  int totalHeight = 0;
+
+  if(count > SIDEBAR_LAYOUT_MAX_WIDGETS) {
+    count = SIDEBAR_LAYOUT_MAX_WIDGETS;
+  }
+
+  layout->count = count;
+  layout->availableHeight = availableHeight;
+  layout->useLargeFonts = globalSettings.useLargeFonts;
+
+  // measure each widget once in both modes, starting out non-compacted
+  for(int i = 0; i < count; i++) {
+    SidebarWidget widget = getSidebarWidgetByType(types[i]);
+
+    layout->types[i] = types[i];
+    layout->compact[i] = false;
+
+    SidebarWidgets_useCompactMode = true;
+    compactHeights[i] = widget.getHeight();
+
+    SidebarWidgets_useCompactMode = false;
+    layout->heights[i] = widget.getHeight();
+
+    totalHeight += layout->heights[i];
+  }
+
+  int gapCount = (count > 1) ? count - 1 : 0;
+  int heightBudget = availableHeight - 2 * SIDEBAR_LAYOUT_V_PADDING - gapCount * SIDEBAR_LAYOUT_MIN_GAP;
+
+  // while the widgets are too tall, compact whichever one saves the most space
+  while(totalHeight > heightBudget) {
+    int bestWidget = -1;
+    int bestSavings = 0;
+
+    for(int i = 0; i < count; i++) {
+      int savings = layout->heights[i] - compactHeights[i];
+
+      if(!layout->compact[i] && savings > bestSavings) {
+        bestWidget = i;
+        bestSavings = savings;
+      }
+    }
+
+    // nothing left to compact, so we'll just have to overlap a bit
+    if(bestWidget < 0) {
+      break;
+    }
+
+    layout->compact[bestWidget] = true;
+    layout->heights[bestWidget] = compactHeights[bestWidget];
+    totalHeight -= bestSavings;
+  }
+
+  // the first widget sits at the top, the last at the bottom, and the
+  // leftover space is split evenly between all the gaps in between
+  int leftoverSpace = availableHeight - 2 * SIDEBAR_LAYOUT_V_PADDING - totalHeight;
+  int position = SIDEBAR_LAYOUT_V_PADDING;
+
+  for(int i = 0; i < count; i++) {
+    if(i > 0) {
+      position += layout->heights[i - 1];
+      position += leftoverSpace * i / gapCount - leftoverSpace * (i - 1) / gapCount;
+    }
+
+    layout->positions[i] = position;
+  }
+
+  layout->isValid = true;
+}
+
+bool SidebarLayout_matches(const SidebarLayout* layout, const SidebarWidgetType* types, int count, int availableHeight) {
+  if(!layout->isValid ||
+     layout->count != count ||
+     layout->availableHeight != availableHeight ||
+     layout->useLargeFonts != globalSettings.useLargeFonts) {
+    return false;
+  }
+
+  for(int i = 0; i < count; i++) {
+    if(layout->types[i] != types[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void SidebarLayout_invalidate(SidebarLayout* layout) {
+  layout->isValid = false;
+}
+
+void SidebarLayout_draw(const SidebarLayout* layout, GContext* ctx) {
+  for(int i = 0; i < layout->count; i++) {
+    SidebarWidget widget = getSidebarWidgetByType(layout->types[i]);
+
+    SidebarWidgets_useCompactMode = layout->compact[i];
+    widget.draw(ctx, layout->positions[i]);
+  }
+
+  SidebarWidgets_useCompactMode = false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <pebble.h>
+#include "sidebar_widgets/sidebar_widgets.h"
+
+// the most widgets the layout solver can stack in a single sidebar
+#define SIDEBAR_LAYOUT_MAX_WIDGETS 5
+
+// padding above the first widget and below the last one
+#define SIDEBAR_LAYOUT_V_PADDING 8
+
+// the smallest gap we'll accept between two widgets before compacting them
+#define SIDEBAR_LAYOUT_MIN_GAP 5
+
+/*
+ * The solved vertical layout of a stack of sidebar widgets. Computed once
+ * whenever the widget set or the font size changes, then reused on every
+ * draw so that we don't have to measure the widgets each frame.
+ */
+typedef struct {
+  bool isValid;
+  int count;
+  int availableHeight;
+  bool useLargeFonts;
+  SidebarWidgetType types[SIDEBAR_LAYOUT_MAX_WIDGETS];
+  bool compact[SIDEBAR_LAYOUT_MAX_WIDGETS];
+  int heights[SIDEBAR_LAYOUT_MAX_WIDGETS];
+  int positions[SIDEBAR_LAYOUT_MAX_WIDGETS];
+} SidebarLayout;
+
+/*
+ * Measures the given widgets and picks a compact mode for each of them so
+ * that the whole stack fits into the available height, then distributes the
+ * leftover space evenly between them.
+ */
+void SidebarLayout_solve(SidebarLayout* layout, const SidebarWidgetType* types, int count, int availableHeight);
+
+/*
+ * Returns true if the layout was solved for exactly these widgets, with the
+ * current font settings, and hasn't been invalidated since
+ */
+bool SidebarLayout_matches(const SidebarLayout* layout, const SidebarWidgetType* types, int count, int availableHeight);
+
+void SidebarLayout_invalidate(SidebarLayout* layout);
+
+/*
+ * Draws every widget of the layout at its solved position and compact mode
+ */
+void SidebarLayout_draw(const SidebarLayout* layout, GContext* ctx);
@@ -2,6 +2,9 @@
 #include <math.h>
 #include "settings.h"
 #include "weather.h"
+#include "health_history.h"
+#include "night_mode.h"
+#include "power_policy.h"
 #include "languages.h"
 #include "util.h"
 #include "sidebar_widgets.h"
@@ -22,16 +25,11 @@ GFont lgSidebarFont;
 GFont currentSidebarFont;
 GFont batteryFont;
 
-// the date, time and weather strings
-char currentDayName[8];
-char currentDayNum[8];
-char currentMonth[8];
-char currentWeekNum[8];
-char currentSecondsNum[8];
-char altClock[8];
-char currentHours[8];
-char currentMinutes[8];
-char currentDayOfYearNum[8];
+// the date, time and health data currently shown by the widgets
+SidebarWidgetsData widgetData;
+
+// the date strings for the current day
+SidebarWidgetsCalendar calendar = { .day = -1 };
 
 // the widgets
 SidebarWidget batteryMeterWidget;
@@ -78,15 +76,25 @@ SidebarWidget dayNumberWidget;
 int DayNumber_getHeight();
 void DayNumber_draw(GContext* ctx, int yPosition);
 
+SidebarWidget hourlyForecastWidget;
+int HourlyForecast_getHeight();
+void HourlyForecast_draw(GContext* ctx, int yPosition);
+
 #ifdef PBL_HEALTH
   GDrawCommandImage* sleepImage;
   GDrawCommandImage* stepsImage;
 
   SidebarWidget healthWidget;
+  bool Health_use_sleep_mode();
+  int Health_getValue(bool sleepMode);
   int Health_getHeight();
   void Health_draw(GContext* ctx, int yPosition);
   void Sleep_draw(GContext* ctx, int yPosition);
   void Steps_draw(GContext* ctx, int yPosition);
+
+  SidebarWidget healthHistoryWidget;
+  int HealthHistory_getHeight();
+  void HealthHistory_draw(GContext* ctx, int yPosition);
 #endif
 
 void SidebarWidgets_init() {
@@ -140,9 +148,15 @@ void SidebarWidgets_init() {
   dayNumberWidget.getHeight = DayNumber_getHeight;
   dayNumberWidget.draw      = DayNumber_draw;
 
+  hourlyForecastWidget.getHeight = HourlyForecast_getHeight;
+  hourlyForecastWidget.draw      = HourlyForecast_draw;
+
   #ifdef PBL_HEALTH
     healthWidget.getHeight = Health_getHeight;
     healthWidget.draw = Health_draw;
+
+    healthHistoryWidget.getHeight = HealthHistory_getHeight;
+    healthHistoryWidget.draw      = HealthHistory_draw;
   #endif
 
 }
@@ -176,28 +190,47 @@ int mod(int a, int b) {
     return r < 0 ? r + b : r;
 }
 
-void SidebarWidgets_updateTime(struct tm* timeInfo) {
-  // set all the date strings
-  strftime(currentDayNum,  3, "%e", timeInfo);
-  strftime(currentWeekNum, 3, "%V", timeInfo);
+// fills in the calendar strings, if the day or the language has changed
+void updateCalendar(struct tm* timeInfo) {
+  int year = timeInfo->tm_year + 1900;
+  int day = year * 1000 + timeInfo->tm_yday;
+
+  if(day == calendar.day && globalSettings.languageId == calendar.languageId) {
+    return;
+  }
+
+  calendar.day = day;
+  calendar.languageId = globalSettings.languageId;
+
+  snprintf(calendar.dayName, sizeof(calendar.dayName), "%s", dayNames[globalSettings.languageId][timeInfo->tm_wday]);
+  snprintf(calendar.month, sizeof(calendar.month), "%s", monthNames[globalSettings.languageId][timeInfo->tm_mon]);
+
+  snprintf(calendar.dayNum, sizeof(calendar.dayNum), "%d", timeInfo->tm_mday);
+  snprintf(calendar.weekNum, sizeof(calendar.weekNum), "%02d",
+           iso_week_number(year, timeInfo->tm_yday, timeInfo->tm_wday));
+  snprintf(calendar.dayOfYearNum, sizeof(calendar.dayOfYearNum), "%d", (uint16_t)(timeInfo->tm_yday + 1));
+}
+
+void SidebarWidgets_computeData(SidebarWidgetsData* data, struct tm* timeInfo) {
+  memset(data, 0, sizeof(SidebarWidgetsData));
+
+  // the date strings only change once a day
+  updateCalendar(timeInfo);
+  data->calendarDay = calendar.day;
 
-  strftime(currentDayOfYearNum, 8, "%j", timeInfo);
-  int today = atoi(currentDayOfYearNum);
-  snprintf(currentDayOfYearNum, sizeof(currentDayOfYearNum), "%d", today);
-    
   // set the seconds string
-  strftime(currentSecondsNum, 4, ":%S", timeInfo);
+  strftime(data->secondsNum, 4, ":%S", timeInfo);
 
   // set the current time strings
   if(clock_is_24h_style()) {
-    strftime(currentHours, 3, "%H", timeInfo);
+    strftime(data->hours, 3, "%H", timeInfo);
   } else {
-    strftime(currentHours, 3, "%I", timeInfo);
+    strftime(data->hours, 3, "%I", timeInfo);
   }
-  if(!globalSettings.showLeadingZero && currentHours[0] == '0') {
-    currentHours[0] = ' ';
+  if(!globalSettings.showLeadingZero && data->hours[0] == '0') {
+    data->hours[0] = ' ';
   }
-  strftime(currentMinutes, 3, "%M", timeInfo);
+  strftime(data->minutes, 3, "%M", timeInfo);
 
   // set the alternate time zone string
   int hour = timeInfo->tm_hour;
@@ -217,19 +250,82 @@ void SidebarWidgets_updateTime(struct tm* timeInfo) {
   }
 
   if(globalSettings.showLeadingZero && hour < 10) {
-    snprintf(altClock, sizeof(altClock), "0%i", hour);
+    snprintf(data->altClock, sizeof(data->altClock), "0%i", hour);
   } else {
-    snprintf(altClock, sizeof(altClock), "%i", hour);
+    snprintf(data->altClock, sizeof(data->altClock), "%i", hour);
   }
 
-  strncpy(currentDayName, dayNames[globalSettings.languageId][timeInfo->tm_wday], sizeof(currentDayName));
-  strncpy(currentMonth, monthNames[globalSettings.languageId][timeInfo->tm_mon], sizeof(currentMonth));
+  #ifdef PBL_HEALTH
+    // query the health service once here rather than on every draw, and
+    // only if there is a health widget to show the result
+    bool showsHealth = false;
+    bool showsHealthHistory = false;
+
+    for(int i = 0; i < (int)ARRAY_LENGTH(globalSettings.widgets); i++) {
+      if(globalSettings.widgets[i] == HEALTH) {
+        showsHealth = true;
+      } else if(globalSettings.widgets[i] == HEALTH_HISTORY) {
+        showsHealthHistory = true;
+      }
+    }
+
+    // at night, the health widget stays on the sleep it showed when night
+    // mode started, rather than querying the health service every minute
+    static int nightSleepValue = -1;
 
-  // remove padding on date num, if needed
-  if(currentDayNum[0] == ' ') {
-    currentDayNum[0] = currentDayNum[1];
-    currentDayNum[1] = '\0';
-  }
+    if(showsHealth && NightMode_isActive) {
+      if(nightSleepValue < 0) {
+        nightSleepValue = Health_getValue(true);
+      }
+
+      data->healthSleepMode = true;
+      data->healthValue = nightSleepValue;
+    } else if(showsHealth) {
+      nightSleepValue = -1;
+
+      // the health service is only queried as often as the power policy
+      // allows, and whenever the health settings change
+      static struct {
+        time_t queriedAt;
+        bool useDistance;
+        bool useRestfulSleep;
+        bool sleepMode;
+        int value;
+      } healthCache;
+
+      time_t now = time(NULL);
+
+      if(healthCache.queriedAt == 0 ||
+         now - healthCache.queriedAt >= PowerPolicy_current->healthMinutes * SECONDS_PER_MINUTE ||
+         now < healthCache.queriedAt ||
+         healthCache.useDistance != globalSettings.healthUseDistance ||
+         healthCache.useRestfulSleep != globalSettings.healthUseRestfulSleep) {
+
+        healthCache.queriedAt = now;
+        healthCache.useDistance = globalSettings.healthUseDistance;
+        healthCache.useRestfulSleep = globalSettings.healthUseRestfulSleep;
+        healthCache.sleepMode = Health_use_sleep_mode();
+        healthCache.value = Health_getValue(healthCache.sleepMode);
+      }
+
+      data->healthSleepMode = healthCache.sleepMode;
+      data->healthValue = healthCache.value;
+    }
+
+    if(showsHealthHistory) {
+      // the history catches up on the whole night in one read when it ends
+      if(!NightMode_isActive) {
+        HealthHistory_update();
+      }
+
+      data->healthHistoryHour = timeInfo->tm_hour;
+      data->healthHistoryRevision = HealthHistory_revision;
+    }
+  #endif
+}
+
+void SidebarWidgets_setData(const SidebarWidgetsData* data) {
+  widgetData = *data;
 }
 
 /* Sidebar Widget Selection */
@@ -266,10 +362,16 @@ SidebarWidget getSidebarWidgetByType(SidebarWidgetType type) {
       case HEALTH:
         return healthWidget;
         break;
+      case HEALTH_HISTORY:
+        return healthHistoryWidget;
+        break;
     #endif
     case DAY_NUMBER:
       return dayNumberWidget;
       break;
+    case HOURLY_FORECAST:
+      return hourlyForecastWidget;
+      break;
     default:
       return emptyWidget;
       break;
@@ -375,7 +477,7 @@ void DateWidget_draw(GContext* ctx, int yPosition) {
 
   // first draw the day name
   graphics_draw_text(ctx,
-                     currentDayName,
+                     calendar.dayName,
                      currentSidebarFont,
                      GRect(-5 + SidebarWidgets_xOffset, yPosition, 40, 20),
                      GTextOverflowModeFill,
@@ -404,7 +506,7 @@ void DateWidget_draw(GContext* ctx, int yPosition) {
   yOffset = globalSettings.useLargeFonts ? 24 : 26;
 
   graphics_draw_text(ctx,
-                     currentDayNum,
+                     calendar.dayNum,
                      currentSidebarFont,
                      GRect(0 + SidebarWidgets_xOffset, yPosition + yOffset, 30, 20),
                      GTextOverflowModeFill,
@@ -420,7 +522,7 @@ void DateWidget_draw(GContext* ctx, int yPosition) {
     yOffset = globalSettings.useLargeFonts ? 48 : 47;
 
     graphics_draw_text(ctx,
-                       currentMonth,
+                       calendar.month,
                        currentSidebarFont,
                        GRect(0 + SidebarWidgets_xOffset, yPosition + yOffset, 30, 20),
                        GTextOverflowModeFill,
@@ -531,7 +633,7 @@ void WeekNumber_draw(GContext* ctx, int yPosition) {
 
   if(!globalSettings.useLargeFonts) {
     graphics_draw_text(ctx,
-                       currentWeekNum,
+                       calendar.weekNum,
                        mdSidebarFont,
                        GRect(0 + SidebarWidgets_xOffset, yPosition + 9, 30, 20),
                        GTextOverflowModeFill,
@@ -539,7 +641,7 @@ void WeekNumber_draw(GContext* ctx, int yPosition) {
                        NULL);
   } else {
     graphics_draw_text(ctx,
-                       currentWeekNum,
+                       calendar.weekNum,
                        lgSidebarFont,
                        GRect(0 + SidebarWidgets_xOffset, yPosition + 6, 30, 20),
                        GTextOverflowModeFill,
@@ -558,7 +660,7 @@ void Seconds_draw(GContext* ctx, int yPosition) {
   graphics_context_set_text_color(ctx, globalSettings.sidebarTextColor);
 
   graphics_draw_text(ctx,
-                     currentSecondsNum,
+                     widgetData.secondsNum,
                      lgSidebarFont,
                      GRect(0 + SidebarWidgets_xOffset, yPosition - 10, 30, 20),
                      GTextOverflowModeFill,
@@ -576,7 +678,7 @@ void Time_draw(GContext* ctx, int yPosition) {
   graphics_context_set_text_color(ctx, globalSettings.sidebarTextColor);
 
   graphics_draw_text(ctx,
-                     currentHours,
+                     widgetData.hours,
                      lgSidebarFont,
                      GRect(0 + SidebarWidgets_xOffset, yPosition - 10, 25, 14),
                      GTextOverflowModeFill,
@@ -584,7 +686,7 @@ void Time_draw(GContext* ctx, int yPosition) {
                      NULL);
 
   graphics_draw_text(ctx,
-                     currentMinutes,
+                     widgetData.minutes,
                      lgSidebarFont,
                      GRect(0 + SidebarWidgets_xOffset, yPosition + 7, 25, 14),
                      GTextOverflowModeFill,
@@ -704,7 +806,7 @@ void AltTime_draw(GContext* ctx, int yPosition) {
   int yMod = (globalSettings.useLargeFonts) ? 5 : 8;
 
   graphics_draw_text(ctx,
-                     altClock,
+                     widgetData.altClock,
                      currentSidebarFont,
                      GRect(-1 + SidebarWidgets_xOffset, yPosition + yMod, 30, 20),
                      GTextOverflowModeFill,
@@ -737,8 +839,24 @@ bool Health_use_sleep_mode() {
   return sleeping;
 }
 
+// returns the number the health widget displays: sleep seconds in sleep
+// mode, otherwise meters walked or steps taken
+int Health_getValue(bool sleepMode) {
+  if(sleepMode) {
+    if(globalSettings.healthUseRestfulSleep) {
+      return (int)health_service_sum_today(HealthMetricSleepSeconds);
+    } else {
+      return (int)health_service_sum_today(HealthMetricSleepRestfulSeconds);
+    }
+  } else if(globalSettings.healthUseDistance) {
+    return (int)health_service_sum_today(HealthMetricWalkedDistanceMeters);
+  } else {
+    return (int)health_service_sum_today(HealthMetricStepCount);
+  }
+}
+
 int Health_getHeight() {
-  if(Health_use_sleep_mode()) {
+  if(widgetData.healthSleepMode) {
     return 44;
   } else {
     return 32;
@@ -749,9 +867,7 @@ void Health_draw(GContext* ctx, int yPosition) {
   // check if we're showing the sleep data or step data
 
   // is the user asleep?
-  bool sleep_mode = Health_use_sleep_mode();
-
-  if(sleep_mode) {
+  if(widgetData.healthSleepMode) {
     Sleep_draw(ctx, yPosition);
   } else {
     Steps_draw(ctx, yPosition);
@@ -765,13 +881,7 @@ void Sleep_draw(GContext* ctx, int yPosition) {
   }
 
   // get sleep in seconds
-  int sleep_seconds;
-
-  if(globalSettings.healthUseRestfulSleep) {
-    sleep_seconds = (int)health_service_sum_today(HealthMetricSleepSeconds);
-  } else {
-    sleep_seconds = (int)health_service_sum_today(HealthMetricSleepRestfulSeconds);
-  }
+  int sleep_seconds = widgetData.healthValue;
 
   // convert to hours/minutes
   int sleep_minutes = sleep_seconds / 60;
@@ -780,7 +890,8 @@ void Sleep_draw(GContext* ctx, int yPosition) {
   // find minutes remainder
   sleep_minutes %= 60;
 
-  char sleep_text[4];
+  // room for any number, though it never takes more than two digits
+  char sleep_text[16];
 
   snprintf(sleep_text, sizeof(sleep_text), "%ih", sleep_hours);
 
@@ -812,10 +923,11 @@ void Steps_draw(GContext* ctx, int yPosition) {
     gdraw_command_image_draw(ctx, stepsImage, GPoint(3 + SidebarWidgets_xOffset, yPosition - 7));
   }
 
-  char steps_text[8];
+  // room for any number, though the values shown are much shorter
+  char steps_text[16];
 
   if(globalSettings.healthUseDistance) {
-    int meters = (int)health_service_sum_today(HealthMetricWalkedDistanceMeters);
+    int meters = widgetData.healthValue;
 
     // format distance string
     if(globalSettings.useMetric) {
@@ -836,7 +948,7 @@ void Steps_draw(GContext* ctx, int yPosition) {
       }
     }
   } else {
-    int steps = (int)health_service_sum_today(HealthMetricStepCount);
+    int steps = widgetData.healthValue;
 
     // format step string
     if(steps < 1000) {
@@ -865,6 +977,50 @@ void Steps_draw(GContext* ctx, int yPosition) {
                      NULL);
 }
 
+/***** Health History Widget *****/
+
+// the tallest bar, for the busiest hour of the day so far
+#define HISTORY_BAR_HEIGHT 13
+
+int HealthHistory_getHeight() {
+  return 34;
+}
+
+void HealthHistory_draw(GContext* ctx, int yPosition) {
+  if(stepsImage) {
+    gdraw_command_image_recolor(stepsImage, globalSettings.iconFillColor, globalSettings.iconStrokeColor);
+    gdraw_command_image_draw(ctx, stepsImage, GPoint(3 + SidebarWidgets_xOffset, yPosition - 7));
+  }
+
+  // a bar for the steps in each hour since midnight, under a line for the day
+  int baseline = yPosition + 30;
+  int busiest = 1;
+
+  for(int hour = 0; hour <= widgetData.healthHistoryHour; hour++) {
+    if(HealthHistory_history.steps[hour] > busiest) {
+      busiest = HealthHistory_history.steps[hour];
+    }
+  }
+
+  graphics_context_set_fill_color(ctx, globalSettings.sidebarTextColor);
+
+  for(int hour = 0; hour <= widgetData.healthHistoryHour; hour++) {
+    int steps = HealthHistory_history.steps[hour];
+    int height = steps * HISTORY_BAR_HEIGHT / busiest;
+
+    // any steps at all get a bar
+    if(steps > 0 && height == 0) {
+      height = 1;
+    }
+
+    if(height > 0) {
+      graphics_fill_rect(ctx, GRect(3 + SidebarWidgets_xOffset + hour, baseline - height, 1, height), 0, GCornerNone);
+    }
+  }
+
+  graphics_fill_rect(ctx, GRect(3 + SidebarWidgets_xOffset, baseline, HEALTH_HISTORY_HOURS, 1), 0, GCornerNone);
+}
+
 #endif
 
 /***** Day Number Widget *****/
@@ -888,10 +1044,109 @@ void DayNumber_draw(GContext* ctx, int yPosition) {
   int yOffset = 0;
   yOffset = globalSettings.useLargeFonts ? 9 : 6;
   graphics_draw_text(ctx,
-                       currentDayOfYearNum,
+                       calendar.dayOfYearNum,
                        mdSidebarFont,
                        GRect(0 + SidebarWidgets_xOffset, yPosition + yOffset, 30, 20),
                        GTextOverflowModeFill,
                        GTextAlignmentCenter,
                        NULL);
-}
\ No newline at end of file
+}
+
+/***** Hourly Forecast Widget *****/
+
+// how many hours ahead the sparkline shows, one every two pixels
+#define SPARKLINE_HOURS   12
+#define SPARKLINE_HEIGHT  16
+
+int HourlyForecast_getHeight() {
+  return (globalSettings.useLargeFonts) ? 52 : 46;
+}
+
+static void drawHourlyLabel(GContext* ctx, int temp, int yPosition) {
+  if(!globalSettings.useMetric) {
+    temp = roundf(temp * 1.8f + 32);
+  }
+
+  char tempString[8];
+  snprintf(tempString, sizeof(tempString), " %d°", temp);
+
+  graphics_draw_text(ctx,
+                     tempString,
+                     (globalSettings.useLargeFonts) ? mdSidebarFont : smSidebarFont,
+                     GRect(-5 + SidebarWidgets_xOffset, yPosition, 38, 20),
+                     GTextOverflowModeFill,
+                     GTextAlignmentCenter,
+                     NULL);
+}
+
+void HourlyForecast_draw(GContext* ctx, int yPosition) {
+  graphics_context_set_text_color(ctx, globalSettings.sidebarTextColor);
+
+  time_t now = time(NULL);
+  int first = Weather_getHourlyIndex(now);
+  int hours = Weather_getHoursAhead(now);
+
+  if(hours > SPARKLINE_HOURS) {
+    hours = SPARKLINE_HOURS;
+  }
+
+  // find the range the line has to fit in
+  int highTemp = INT32_MIN;
+  int lowTemp = INT32_MAX;
+
+  for(int i = 0; i < hours; i++) {
+    int temp = Weather_getHourlyTemperature(first + i);
+
+    if(temp != INT32_MIN) {
+      highTemp = (temp > highTemp) ? temp : highTemp;
+      lowTemp = (temp < lowTemp) ? temp : lowTemp;
+    }
+  }
+
+  // without at least two hours to draw a line between, show that we're waiting
+  if(hours < 2 || highTemp == INT32_MIN) {
+    graphics_draw_text(ctx,
+                       "...",
+                       currentSidebarFont,
+                       GRect(-5 + SidebarWidgets_xOffset, yPosition, 38, 20),
+                       GTextOverflowModeFill,
+                       GTextAlignmentCenter,
+                       NULL);
+    return;
+  }
+
+  // the high above the line, the low below it
+  int lineTop = yPosition + ((globalSettings.useLargeFonts) ? 17 : 14);
+  int range = (highTemp > lowTemp) ? highTemp - lowTemp : 1;
+
+  drawHourlyLabel(ctx, highTemp, yPosition - 4);
+  drawHourlyLabel(ctx, lowTemp, lineTop + SPARKLINE_HEIGHT - 2);
+
+  graphics_context_set_stroke_color(ctx, globalSettings.sidebarTextColor);
+
+  // center the line when there are fewer hours left
+  int left = 4 + SidebarWidgets_xOffset + (SPARKLINE_HOURS - hours);
+  GPoint previous = GPointZero;
+  bool hasPrevious = false;
+
+  for(int i = 0; i < hours; i++) {
+    int temp = Weather_getHourlyTemperature(first + i);
+
+    // leave a gap wherever the service didn't have a temperature
+    if(temp == INT32_MIN) {
+      hasPrevious = false;
+      continue;
+    }
+
+    GPoint point = GPoint(left + i * 2, lineTop + (highTemp - temp) * SPARKLINE_HEIGHT / range);
+
+    if(hasPrevious) {
+      graphics_draw_line(ctx, previous, point);
+    } else {
+      graphics_draw_pixel(ctx, point);
+    }
+
+    previous = point;
+    hasPrevious = true;
+  }
+}
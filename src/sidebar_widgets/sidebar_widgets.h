@@ -2,9 +2,10 @@
 #include <pebble.h>
 
 /*
- * "Compact Mode" is a global setting shared by all widgets, which determines
- * whether they should try to reduce their padding. Intended to allow larger
- * widgets to fit when vertical screen space is lacking
+ * "Compact Mode" determines whether a widget should try to reduce its padding.
+ * Intended to allow larger widgets to fit when vertical screen space is
+ * lacking. The sidebar layout sets it separately for each widget before
+ * measuring or drawing it.
  */
 extern bool SidebarWidgets_useCompactMode;
 
@@ -30,7 +31,9 @@ typedef enum {
   WEATHER_FORECAST_TODAY    = 8,
   TIME                      = 9,
   HEALTH                    = 10,
-  DAY_NUMBER                = 12
+  DAY_NUMBER                = 12,
+  HOURLY_FORECAST           = 13,
+  HEALTH_HISTORY            = 14
 } SidebarWidgetType;
 
 typedef struct {
@@ -46,8 +49,52 @@ typedef struct {
   void (*draw)(GContext* ctx, int yPosition);
 } SidebarWidget;
 
+/*
+ * The date strings shown by the date, week number and day number widgets.
+ * They only change at midnight (or with the language), so they are worked
+ * out once per day rather than on every tick
+ */
+typedef struct {
+  int day;
+  uint8_t languageId;
+  char dayName[8];
+  char dayNum[8];
+  char month[8];
+  char weekNum[8];
+  char dayOfYearNum[8];
+} SidebarWidgetsCalendar;
+
+/*
+ * Everything the widgets display that is derived from the current time
+ * (and the health service), computed once per tick. The date strings live in
+ * the calendar; calendarDay identifies the day they were computed for
+ */
+typedef struct {
+  int calendarDay;
+  char secondsNum[8];
+  char altClock[8];
+  char hours[8];
+  char minutes[8];
+  bool healthSleepMode;
+  int healthValue;
+  int healthHistoryHour;
+  int healthHistoryRevision;
+} SidebarWidgetsData;
+
 void SidebarWidgets_init();
 void SidebarWidgets_deinit();
 SidebarWidget getSidebarWidgetByType(SidebarWidgetType type);
+
 void SidebarWidgets_updateFonts();
-void SidebarWidgets_updateTime(struct tm* timeInfo);
+
+/*
+ * Computes the time and health data shown by the widgets for the given time.
+ * The date strings are not copied into data: they are written to the shared
+ * calendar, which is only updated when the day or the language changes
+ */
+void SidebarWidgets_computeData(SidebarWidgetsData* data, struct tm* timeInfo);
+
+/*
+ * Sets the data the widgets draw from
+ */
+void SidebarWidgets_setData(const SidebarWidgetsData* data);
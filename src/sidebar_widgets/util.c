@@ -20,6 +20,33 @@ void gdraw_command_image_recolor(GDrawCommandImage *img, GColor fill_color, GCol
                              recolor_iterator_cb, &colors);
 }
 
+// the day of the week (0 is sunday) of the last day of the given year
+static int last_weekday_of_year(int year) {
+  return (year + year / 4 - year / 100 + year / 400) % 7;
+}
+
+// a year has 53 weeks if it starts on a thursday, or is a leap year
+// starting on a wednesday
+static int iso_weeks_in_year(int year) {
+  return (last_weekday_of_year(year) == 4 || last_weekday_of_year(year - 1) == 3) ? 53 : 52;
+}
+
+int iso_week_number(int year, int yday, int wday) {
+  // iso weeks start on monday, which is day 1; sunday is day 7
+  int isoWeekday = (wday == 0) ? 7 : wday;
+  int week = (yday + 1 - isoWeekday + 10) / 7;
+
+  // the first days of january can be in the last week of the year before,
+  // and the last days of december in the first week of the next
+  if(week < 1) {
+    return iso_weeks_in_year(year - 1);
+  } else if(week > iso_weeks_in_year(year)) {
+    return 1;
+  }
+
+  return week;
+}
+
 #ifdef PBL_HEALTH
   bool activity_search_cb(HealthActivity activity, time_t time_start, time_t time_end, void *context) {
     bool *result = (bool *)context;
@@ -7,6 +7,13 @@
  */
 extern void gdraw_command_image_recolor(GDrawCommandImage *img, GColor fill_color, GColor stroke_color);
 
+/*
+ * Returns the ISO 8601 week number (1-53) of a date, given as the year, the
+ * day of the year (0-365) and the day of the week (0 is sunday), the way
+ * struct tm has them. The same as strftime's %V, without the formatting
+ */
+extern int iso_week_number(int year, int yday, int wday);
+
 #ifdef PBL_HEALTH
   /*
    * Checks if any of the specified health activites exist in the specified time range
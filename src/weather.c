@@ -3,110 +3,183 @@
 
 WeatherInfo Weather_weatherInfo;
 WeatherForecastInfo Weather_weatherForecast;
+HourlyForecast Weather_hourlyForecast;
+uint32_t Weather_hourlyRevision;
 
 GDrawCommandImage* Weather_currentWeatherIcon;
 GDrawCommandImage* Weather_forecastWeatherIcon;
 
-uint32_t getConditionIcon(int conditionCode) {
-  uint32_t iconToLoad;
-
-  switch(conditionCode) {
-    case 0: // tornado
-    case 1: // tropical storm
-    case 2: // hurricane
-    case 3: // severe thunderstorms
-    case 4: // thunderstorms
-    case 37: //isolated thunderstorms
-    case 38: //scattered thunderstorms
-    case 39: //scattered thunderstorms
-    case 45: //thundershowers
-    case 47: //isolated thundershowers
-      iconToLoad = RESOURCE_ID_WEATHER_THUNDERSTORM;
-      break;
-    case 5: //mixed rain and snow
-    case 6: //mixed rain and sleet
-    case 7: //mixed snow and sleet
-    case 8: //freezing drizzle
-    case 10: //freezing rain
-    case 35: //mixed rain and hail
-      iconToLoad = RESOURCE_ID_WEATHER_RAINING_AND_SNOWING;
-      break;
-    case 9: //drizzle
-    case 40: //scattered showers
-      iconToLoad = RESOURCE_ID_WEATHER_LIGHT_RAIN;
-      break;
-    case 11: //showers
-    case 12: //showers
-      iconToLoad = RESOURCE_ID_WEATHER_HEAVY_RAIN;
-      break;
-    case 13: //snow flurries
-    case 14: //light snow showers
-    case 15: //blowing snow
-    case 17: //hail
-    case 42: //scattered snow showers
-      iconToLoad = RESOURCE_ID_WEATHER_LIGHT_SNOW;
-      break;
-    case 16: //snow
-    case 18: //sleet
-    case 41: //heavy snow
-    case 43: //heavy snow
-    case 46: //snow showers
-      iconToLoad = RESOURCE_ID_WEATHER_HEAVY_SNOW;
-      break;
-    case 19: //dust
-    case 20: //foggy
-    case 21: //haze
-    case 22: //smoky
-    case 26: //cloudy
-      iconToLoad = RESOURCE_ID_WEATHER_CLOUDY;
-      break;
-    case 27: //mostly cloudy (night)
-    case 29: //partly cloudy (night)
-      iconToLoad = RESOURCE_ID_WEATHER_PARTLY_CLOUDY_NIGHT;
-      break;
-    case 23: //blustery
-    case 24: //windy
-    case 25: //cold
-    case 34: //fair (day)
-    case 32: //sunny
-    case 36: //hot
-      iconToLoad = RESOURCE_ID_WEATHER_CLEAR_DAY;
-      break;
-    case 31: //clear (night)
-    case 33: //fair (night)
-      iconToLoad = RESOURCE_ID_WEATHER_CLEAR_NIGHT;
-      break;
-    case 28: //mostly cloudy (day)
-    case 30: //partly cloudy (day)
-    case 44: //partly cloudy
-      iconToLoad = RESOURCE_ID_WEATHER_PARTLY_CLOUDY;
-      break;
-    default:
-      iconToLoad = RESOURCE_ID_WEATHER_GENERIC;
-      break;
+// the icon resource for each WeatherIcon
+static const uint32_t weatherIconResources[WEATHER_ICON_COUNT] = {
+  RESOURCE_ID_WEATHER_GENERIC,
+  RESOURCE_ID_WEATHER_CLEAR_DAY,
+  RESOURCE_ID_WEATHER_CLEAR_NIGHT,
+  RESOURCE_ID_WEATHER_PARTLY_CLOUDY,
+  RESOURCE_ID_WEATHER_PARTLY_CLOUDY_NIGHT,
+  RESOURCE_ID_WEATHER_CLOUDY,
+  RESOURCE_ID_WEATHER_LIGHT_RAIN,
+  RESOURCE_ID_WEATHER_HEAVY_RAIN,
+  RESOURCE_ID_WEATHER_THUNDERSTORM,
+  RESOURCE_ID_WEATHER_RAINING_AND_SNOWING,
+  RESOURCE_ID_WEATHER_LIGHT_SNOW,
+  RESOURCE_ID_WEATHER_HEAVY_SNOW
+};
+
+uint32_t getConditionIcon(WeatherIcon icon) {
+  if(icon >= WEATHER_ICON_COUNT) {
+    return RESOURCE_ID_WEATHER_GENERIC;
   }
 
-  return iconToLoad;
+  return weatherIconResources[icon];
 }
 
-void Weather_setConditions(int conditionCode, bool isNight, int forecastCondition) {
-
-  uint32_t currentWeatherIcon = getConditionIcon(conditionCode);
-  uint32_t forecastWeatherIcon = getConditionIcon(forecastCondition);
-
-  // ok, now load the new icon:
+static void setCurrentIcon(uint32_t currentWeatherIcon) {
   GDrawCommandImage* oldImage = Weather_currentWeatherIcon;
   Weather_currentWeatherIcon = gdraw_command_image_create_with_resource(currentWeatherIcon);
   gdraw_command_image_destroy(oldImage);
 
-  oldImage = Weather_forecastWeatherIcon;
+  Weather_weatherInfo.currentIconResourceID = currentWeatherIcon;
+}
+
+void Weather_setConditions(WeatherIcon currentIcon, WeatherIcon forecastIcon) {
+
+  uint32_t currentWeatherIcon = getConditionIcon(currentIcon);
+  uint32_t forecastWeatherIcon = getConditionIcon(forecastIcon);
+
+  // ok, now load the new icon:
+  setCurrentIcon(currentWeatherIcon);
+
+  GDrawCommandImage* oldImage = Weather_forecastWeatherIcon;
   Weather_forecastWeatherIcon = gdraw_command_image_create_with_resource(forecastWeatherIcon);
   gdraw_command_image_destroy(oldImage);
 
-  Weather_weatherInfo.currentIconResourceID = currentWeatherIcon;
   Weather_weatherForecast.forecastIconResourceID = forecastWeatherIcon;
 }
 
+static int dataTemperature(const uint8_t* data, int offset) {
+  int8_t value = (int8_t)data[offset];
+  return (value == WEATHER_DATA_UNKNOWN) ? INT32_MIN : value;
+}
+
+bool Weather_setFromData(const uint8_t* data, int length) {
+  if(length < WEATHER_DATA_SIZE) {
+    return false;
+  }
+
+  Weather_weatherInfo.currentTemp = dataTemperature(data, WEATHER_DATA_TEMPERATURE);
+  Weather_weatherForecast.highTemp = dataTemperature(data, WEATHER_DATA_FORECAST_HIGH);
+  Weather_weatherForecast.lowTemp = dataTemperature(data, WEATHER_DATA_FORECAST_LOW);
+
+  Weather_setConditions(data[WEATHER_DATA_ICON], data[WEATHER_DATA_FORECAST_ICON]);
+
+  return true;
+}
+
+// the forecast being received, applied once all of it has arrived
+static HourlyForecast incomingForecast;
+
+bool Weather_beginHourlyData(uint32_t length) {
+  if(length < HOURLY_DATA_TEMPERATURES) {
+    return false;
+  }
+
+  memset(&incomingForecast, 0, sizeof(HourlyForecast));
+  return true;
+}
+
+void Weather_writeHourlyData(uint32_t offset, const uint8_t* data, uint16_t length) {
+  for(int i = 0; i < length; i++) {
+    uint32_t position = offset + i;
+    uint32_t iconOffset = HOURLY_DATA_TEMPERATURES + incomingForecast.hourCount;
+
+    if(position < HOURLY_DATA_HOUR_COUNT) {
+      incomingForecast.startTime |= (uint32_t)data[i] << (8 * (position - HOURLY_DATA_START_TIME));
+    } else if(position == HOURLY_DATA_HOUR_COUNT) {
+      incomingForecast.hourCount = data[i];
+    } else if(position < iconOffset) {
+      // a count too large is refused at the end; until then, stay in bounds
+      if(position - HOURLY_DATA_TEMPERATURES < HOURLY_FORECAST_MAX_HOURS) {
+        incomingForecast.temperatures[position - HOURLY_DATA_TEMPERATURES] = data[i];
+      }
+    } else if(position - iconOffset < (incomingForecast.hourCount + 1) / 2U &&
+              position - iconOffset < HOURLY_FORECAST_MAX_HOURS / 2) {
+      incomingForecast.icons[position - iconOffset] = data[i];
+    }
+  }
+}
+
+bool Weather_finishHourlyData(uint32_t length) {
+  int hourCount = incomingForecast.hourCount;
+
+  if(hourCount > HOURLY_FORECAST_MAX_HOURS ||
+     length < HOURLY_DATA_TEMPERATURES + hourCount + (hourCount + 1) / 2U) {
+    return false;
+  }
+
+  Weather_hourlyForecast = incomingForecast;
+  Weather_hourlyRevision++;
+  return true;
+}
+
+bool Weather_setHourlyFromData(const uint8_t* data, int length) {
+  if(!Weather_beginHourlyData(length)) {
+    return false;
+  }
+
+  Weather_writeHourlyData(0, data, length);
+  return Weather_finishHourlyData(length);
+}
+
+int Weather_getHourlyIndex(time_t t) {
+  if(Weather_hourlyForecast.hourCount == 0 || t < (time_t)Weather_hourlyForecast.startTime) {
+    return -1;
+  }
+
+  int index = (t - Weather_hourlyForecast.startTime) / SECONDS_PER_HOUR;
+
+  return (index < Weather_hourlyForecast.hourCount) ? index : -1;
+}
+
+int Weather_getHoursAhead(time_t t) {
+  int index = Weather_getHourlyIndex(t);
+
+  return (index < 0) ? 0 : Weather_hourlyForecast.hourCount - index;
+}
+
+int Weather_getHourlyTemperature(int index) {
+  int8_t value = Weather_hourlyForecast.temperatures[index];
+  return (value == WEATHER_DATA_UNKNOWN) ? INT32_MIN : value;
+}
+
+WeatherIcon Weather_getHourlyIcon(int index) {
+  uint8_t icons = Weather_hourlyForecast.icons[index / 2];
+  return (index % 2 == 0) ? (icons & 0x0F) : (icons >> 4);
+}
+
+bool Weather_updateFromHourly(time_t t) {
+  int index = Weather_getHourlyIndex(t);
+
+  if(index < 0) {
+    return false;
+  }
+
+  int currentTemp = Weather_getHourlyTemperature(index);
+  uint32_t currentWeatherIcon = getConditionIcon(Weather_getHourlyIcon(index));
+  bool changed = false;
+
+  if(currentTemp != INT32_MIN && currentTemp != Weather_weatherInfo.currentTemp) {
+    Weather_weatherInfo.currentTemp = currentTemp;
+    changed = true;
+  }
+
+  if(currentWeatherIcon != Weather_weatherInfo.currentIconResourceID) {
+    setCurrentIcon(currentWeatherIcon);
+    changed = true;
+  }
+
+  return changed;
+}
+
 void Weather_init() {
   // if possible, load weather data from persistent storage
   printf("starting weather!");
@@ -143,6 +216,17 @@ void Weather_init() {
     Weather_weatherForecast.highTemp = INT32_MIN;
     Weather_weatherForecast.lowTemp = INT32_MIN;
   }
+
+  if (persist_exists(HOURLYFORECAST_PERSIST_KEY)) {
+    persist_read_data(HOURLYFORECAST_PERSIST_KEY, &Weather_hourlyForecast, sizeof(HourlyForecast));
+  } else {
+    Weather_hourlyForecast.hourCount = 0;
+  }
+
+  Weather_hourlyRevision++;
+
+  // the face may have been off for a while, so catch up with the forecast
+  Weather_updateFromHourly(time(NULL));
 }
 
 void Weather_saveData() {
@@ -151,6 +235,10 @@ void Weather_saveData() {
   persist_write_data(WEATHERFORECAST_PERSIST_KEY, &Weather_weatherForecast, sizeof(WeatherForecastInfo));
 }
 
+void Weather_saveHourlyData() {
+  persist_write_data(HOURLYFORECAST_PERSIST_KEY, &Weather_hourlyForecast, sizeof(HourlyForecast));
+}
+
 void Weather_deinit() {
   // save weather data to persistent storage
   Weather_saveData();
@@ -4,6 +4,7 @@
 // persistent storage
 #define WEATHERINFO_PERSIST_KEY 2
 #define WEATHERFORECAST_PERSIST_KEY 222
+#define HOURLYFORECAST_PERSIST_KEY 223
 
 typedef struct {
   int currentTemp;
@@ -16,14 +17,114 @@ typedef struct {
   uint32_t forecastIconResourceID;
 } WeatherForecastInfo;
 
+/*
+ * The weather icons, in the order the phone numbers them. The phone maps
+ * whatever its weather service reports onto these, so the watch doesn't need
+ * to know which service it was.
+ */
+typedef enum {
+  WEATHER_ICON_GENERIC              = 0,
+  WEATHER_ICON_CLEAR_DAY            = 1,
+  WEATHER_ICON_CLEAR_NIGHT          = 2,
+  WEATHER_ICON_PARTLY_CLOUDY        = 3,
+  WEATHER_ICON_PARTLY_CLOUDY_NIGHT  = 4,
+  WEATHER_ICON_CLOUDY               = 5,
+  WEATHER_ICON_LIGHT_RAIN           = 6,
+  WEATHER_ICON_HEAVY_RAIN           = 7,
+  WEATHER_ICON_THUNDERSTORM         = 8,
+  WEATHER_ICON_RAINING_AND_SNOWING  = 9,
+  WEATHER_ICON_LIGHT_SNOW           = 10,
+  WEATHER_ICON_HEAVY_SNOW           = 11,
+  WEATHER_ICON_COUNT
+} WeatherIcon;
+
+/*
+ * The weather as the phone sends it: one byte array with the temperatures
+ * in degrees celsius (signed) and the icons as WeatherIcon values. A
+ * temperature of WEATHER_DATA_UNKNOWN means the service didn't report it.
+ */
+#define WEATHER_DATA_TEMPERATURE    0
+#define WEATHER_DATA_ICON           1
+#define WEATHER_DATA_FORECAST_HIGH  2
+#define WEATHER_DATA_FORECAST_LOW   3
+#define WEATHER_DATA_FORECAST_ICON  4
+#define WEATHER_DATA_SIZE           5
+
+#define WEATHER_DATA_UNKNOWN INT8_MIN
+
+/*
+ * The forecast for the coming hours, as the phone sends it: the time the
+ * first hour starts (uint32, little endian), the number of hours (uint8),
+ * a temperature per hour (int8, as above), then an icon per hour as 4-bit
+ * WeatherIcon values, two to a byte with the earlier hour in the low bits.
+ */
+#define HOURLY_DATA_START_TIME    0
+#define HOURLY_DATA_HOUR_COUNT    4
+#define HOURLY_DATA_TEMPERATURES  5
+
+#define HOURLY_FORECAST_MAX_HOURS 24
+
+// with fewer hours of forecast left than this, the watch asks for new weather
+#define WEATHER_HOURLY_REFRESH_HOURS 12
+
+// the hourly forecast as it is kept in memory and in storage
+typedef struct {
+  uint32_t startTime;
+  uint8_t hourCount;
+  int8_t temperatures[HOURLY_FORECAST_MAX_HOURS];
+  uint8_t icons[HOURLY_FORECAST_MAX_HOURS / 2];
+} HourlyForecast;
+
 extern WeatherInfo Weather_weatherInfo;
 extern WeatherForecastInfo Weather_weatherForecast;
+extern HourlyForecast Weather_hourlyForecast;
+
+// goes up every time a new hourly forecast is loaded, even one that starts
+// at the same hour as the last
+extern uint32_t Weather_hourlyRevision;
 
 extern GDrawCommandImage* Weather_currentWeatherIcon;
 extern GDrawCommandImage* Weather_forecastWeatherIcon;
 
 
-void Weather_setConditions(int conditionCode, bool isNight, int forecastCondition);
+void Weather_setConditions(WeatherIcon currentIcon, WeatherIcon forecastIcon);
+
+// applies a weather record from the phone; returns false if it's malformed
+bool Weather_setFromData(const uint8_t* data, int length);
+
+// applies an hourly forecast from the phone; returns false if it's malformed
+bool Weather_setHourlyFromData(const uint8_t* data, int length);
+
+/*
+ * The same, for a forecast that arrives in chunks (see chunked_transfer.h):
+ * each chunk is decoded as it comes in, and the forecast replaces the current
+ * one once the last has arrived, unless it turns out to be malformed
+ */
+bool Weather_beginHourlyData(uint32_t length);
+void Weather_writeHourlyData(uint32_t offset, const uint8_t* data, uint16_t length);
+bool Weather_finishHourlyData(uint32_t length);
+
+/*
+ * Returns the index in the hourly forecast of the hour containing the given
+ * time, or -1 if the forecast doesn't cover it
+ */
+int Weather_getHourlyIndex(time_t t);
+
+// returns how many hours of the forecast are left, counting the current one
+int Weather_getHoursAhead(time_t t);
+
+// returns the temperature for an hour of the forecast, or INT32_MIN
+int Weather_getHourlyTemperature(int index);
+WeatherIcon Weather_getHourlyIcon(int index);
+
+/*
+ * Sets the current conditions from the hourly forecast for the given time,
+ * so they stay right between updates from the phone. Returns true if that
+ * changed them.
+ */
+bool Weather_updateFromHourly(time_t t);
+
 void Weather_saveData();
+void Weather_saveHourlyData();
 void Weather_init();
 void Weather_deinit();
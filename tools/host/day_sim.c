@@ -0,0 +1,361 @@
+/*
+ * Replays a simulated day through the watchface: a tick every minute (or
+ * second), a battery that drains and gets charged, a few bluetooth
+ * disconnections, a phone that answers weather requests, and health data
+ * that changes over the day. Prints what the face did as a JSON object of
+ * operation counts, for the energy model in energy_report.py.
+ *
+ * The event trace the face recorded can be saved for trace_replay.
+ *
+ * usage: day_sim [--widgets a,b,c] [--large-fonts] [--left] [--hourly-vibe n]
+ *                [--chime-pattern n] [--quiet-hours start,end]
+ *                [--night-mode] [--night-hours start,end]
+ *                [--bt-vibe] [--battery-pct] [--save-trace FILE]
+ */
+
+// pull in the face itself, so that its static init and deinit are reachable
+#define main face_main
+#include "main.c"
+#undef main
+
+#include "host.h"
+
+#ifdef KEY_CHUNK_STREAM
+  #include "chunked_transfer.h"
+#endif
+
+// 2016-03-14 00:00:00 UTC
+#define DAY_START 1457913600
+
+#define MINUTES_PER_DAY 1440
+
+typedef struct {
+  int start;
+  int end;
+} MinuteRange;
+
+// when the phone is out of range, in minutes since midnight
+static const MinuteRange disconnections[] = {
+  {8 * 60 + 10, 8 * 60 + 15},
+  {13 * 60, 13 * 60 + 1},
+  {18 * 60 + 45, 19 * 60 + 5}
+};
+
+// when the wearer is asleep
+static const MinuteRange sleepPeriods[] = {
+  {0, 6 * 60 + 30},
+  {23 * 60 + 30, MINUTES_PER_DAY}
+};
+
+static bool inRanges(const MinuteRange* ranges, int count, int minute) {
+  for(int i = 0; i < count; i++) {
+    if(minute >= ranges[i].start && minute < ranges[i].end) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*
+ * The battery reports in 10% steps: it loses a step every two and a half
+ * hours, and is put on the charger at 23:00
+ */
+static void updateBattery(int minute) {
+  static const int chargeStart = 23 * 60;
+  bool isCharging = minute >= chargeStart;
+  int percent;
+
+  if(isCharging) {
+    int drained = 100 - (chargeStart / 150) * 10;
+    percent = drained + ((minute - chargeStart) / 30) * 10;
+  } else {
+    percent = 100 - (minute / 150) * 10;
+  }
+
+  BatteryChargeState state = battery_state_service_peek();
+
+  if(state.charge_percent != percent || state.is_charging != isCharging) {
+    host_set_battery(percent, isCharging);
+  }
+}
+
+// the phone's answer to a weather request
+static void replyWithWeather(int minute) {
+  uint8_t buffer[256];
+  DictionaryIterator iter;
+
+  dict_write_begin(&iter, buffer, sizeof(buffer));
+
+  // older checkouts (see energy_report.py --against) take the weather as
+  // separate values, with the weather service's condition codes
+  #ifdef KEY_WEATHER_DATA
+    uint8_t weather[WEATHER_DATA_SIZE];
+    weather[WEATHER_DATA_TEMPERATURE] = 12 + (minute / 180) % 6;
+    weather[WEATHER_DATA_ICON] = (minute < 12 * 60) ? WEATHER_ICON_PARTLY_CLOUDY : WEATHER_ICON_HEAVY_RAIN;
+    weather[WEATHER_DATA_FORECAST_HIGH] = 18;
+    weather[WEATHER_DATA_FORECAST_LOW] = 9;
+    weather[WEATHER_DATA_FORECAST_ICON] = WEATHER_ICON_HEAVY_RAIN;
+
+    dict_write_data(&iter, KEY_WEATHER_DATA, weather, sizeof(weather));
+  #else
+    dict_write_int32(&iter, KEY_TEMPERATURE, 12 + (minute / 180) % 6);
+    dict_write_int32(&iter, KEY_CONDITION_CODE, (minute < 12 * 60) ? 30 : 11);
+    dict_write_int32(&iter, KEY_USE_NIGHT_ICON, minute < 7 * 60 || minute > 20 * 60);
+    dict_write_int32(&iter, KEY_FORECAST_CONDITION, 11);
+    dict_write_int32(&iter, KEY_FORECAST_TEMP_HIGH, 18);
+    dict_write_int32(&iter, KEY_FORECAST_TEMP_LOW, 9);
+  #endif
+
+  // and, from when there was one, the forecast for the next 24 hours: as
+  // the first chunk of a transfer, or in a tuple of its own before that
+  #if defined(KEY_CHUNK_STREAM) || defined(KEY_HOURLY_FORECAST)
+    uint8_t hourly[HOURLY_DATA_TEMPERATURES + HOURLY_FORECAST_MAX_HOURS + HOURLY_FORECAST_MAX_HOURS / 2];
+    uint32_t start = DAY_START + (minute / 60) * SECONDS_PER_HOUR;
+
+    memset(hourly, 0, sizeof(hourly));
+
+    for(int i = 0; i < 4; i++) {
+      hourly[HOURLY_DATA_START_TIME + i] = start >> (8 * i);
+    }
+
+    hourly[HOURLY_DATA_HOUR_COUNT] = HOURLY_FORECAST_MAX_HOURS;
+
+    for(int i = 0; i < HOURLY_FORECAST_MAX_HOURS; i++) {
+      int hourMinute = (minute / 60 + i) * 60 % MINUTES_PER_DAY;
+      uint8_t icon = (hourMinute < 12 * 60) ? WEATHER_ICON_PARTLY_CLOUDY : WEATHER_ICON_HEAVY_RAIN;
+
+      hourly[HOURLY_DATA_TEMPERATURES + i] = 12 + (hourMinute / 180) % 6;
+      hourly[HOURLY_DATA_TEMPERATURES + HOURLY_FORECAST_MAX_HOURS + i / 2] |= icon << (4 * (i % 2));
+    }
+
+    #ifdef KEY_CHUNK_STREAM
+      static uint16_t transferId;
+
+      dict_write_uint8(&iter, KEY_CHUNK_STREAM, TRANSFER_STREAM_HOURLY_FORECAST);
+      dict_write_uint16(&iter, KEY_CHUNK_ID, ++transferId);
+      dict_write_uint32(&iter, KEY_CHUNK_OFFSET, 0);
+      dict_write_uint32(&iter, KEY_CHUNK_LENGTH, sizeof(hourly));
+      dict_write_data(&iter, KEY_CHUNK_DATA, hourly, sizeof(hourly));
+    #else
+      dict_write_data(&iter, KEY_HOURLY_FORECAST, hourly, sizeof(hourly));
+    #endif
+  #endif
+
+  host_app_message_receive(&iter);
+}
+
+static bool parseWidgets(const char* list, SidebarWidgetType* widgets) {
+  int values[3];
+
+  if(sscanf(list, "%d,%d,%d", &values[0], &values[1], &values[2]) != 3) {
+    return false;
+  }
+
+  for(int i = 0; i < 3; i++) {
+    widgets[i] = values[i];
+  }
+
+  return true;
+}
+
+// checkouts from before event traces (see energy_report.py --against) have none
+#ifdef EVENT_TRACE_HEADER_KEY
+
+// writes the trace the face saved when it exited, in the form trace_replay reads
+static bool saveTrace(const char* path) {
+  uint8_t header[EVENT_TRACE_HEADER_SIZE];
+  uint8_t data[EVENT_TRACE_SIZE];
+
+  if(persist_read_data(EVENT_TRACE_HEADER_KEY, header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+
+  int length = header[EVENT_TRACE_HEADER_SIZE - 2] | (header[EVENT_TRACE_HEADER_SIZE - 1] << 8);
+
+  for(int offset = 0; offset < length; offset += EVENT_TRACE_CHUNK_SIZE) {
+    int chunkSize = (length - offset < EVENT_TRACE_CHUNK_SIZE) ? length - offset : EVENT_TRACE_CHUNK_SIZE;
+    persist_read_data(EVENT_TRACE_DATA_KEY + offset / EVENT_TRACE_CHUNK_SIZE, &data[offset], chunkSize);
+  }
+
+  FILE* file = fopen(path, "wb");
+
+  if(!file) {
+    return false;
+  }
+
+  fwrite(header, 1, sizeof(header), file);
+  fwrite(data, 1, length, file);
+  fclose(file);
+
+  return true;
+}
+
+#else
+
+static bool saveTrace(const char* path) {
+  return false;
+}
+
+#endif
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s [--widgets a,b,c] [--large-fonts] [--left] [--hourly-vibe n] "
+                  "[--chime-pattern n] [--quiet-hours start,end] [--night-mode] [--night-hours start,end] "
+                  "[--bt-vibe] [--battery-pct] [--save-trace FILE] [--verbose]\n", name);
+}
+
+int main(int argc, char** argv) {
+  SidebarWidgetType widgets[3] = {WEATHER_CURRENT, EMPTY, DATE};
+  bool useLargeFonts = false;
+  bool sidebarOnLeft = false;
+  bool btVibe = false;
+  bool showBatteryPct = false;
+  int hourlyVibe = 0;
+  int chimePattern = 0;
+  int quietHoursStart = 0;
+  int quietHoursEnd = 0;
+  bool nightMode = false;
+  int nightStartHour = 0;
+  int nightEndHour = 0;
+  const char* tracePath = NULL;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--widgets") == 0 && i + 1 < argc) {
+      if(!parseWidgets(argv[++i], widgets)) {
+        usage(argv[0]);
+        return 2;
+      }
+    } else if(strcmp(argv[i], "--large-fonts") == 0) {
+      useLargeFonts = true;
+    } else if(strcmp(argv[i], "--left") == 0) {
+      sidebarOnLeft = true;
+    } else if(strcmp(argv[i], "--hourly-vibe") == 0 && i + 1 < argc) {
+      hourlyVibe = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--chime-pattern") == 0 && i + 1 < argc) {
+      chimePattern = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--quiet-hours") == 0 && i + 1 < argc) {
+      if(sscanf(argv[++i], "%d,%d", &quietHoursStart, &quietHoursEnd) != 2) {
+        usage(argv[0]);
+        return 2;
+      }
+    } else if(strcmp(argv[i], "--night-mode") == 0) {
+      nightMode = true;
+    } else if(strcmp(argv[i], "--night-hours") == 0 && i + 1 < argc) {
+      if(sscanf(argv[++i], "%d,%d", &nightStartHour, &nightEndHour) != 2) {
+        usage(argv[0]);
+        return 2;
+      }
+    } else if(strcmp(argv[i], "--bt-vibe") == 0) {
+      btVibe = true;
+    } else if(strcmp(argv[i], "--battery-pct") == 0) {
+      showBatteryPct = true;
+    } else if(strcmp(argv[i], "--save-trace") == 0 && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if(strcmp(argv[i], "--verbose") == 0) {
+      host_set_verbose(true);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  host_reset();
+  host_set_time(DAY_START);
+  host_set_battery(100, false);
+
+  persist_write_int(SETTING_SIDEBAR_WIDGET0_KEY, widgets[0]);
+  persist_write_int(SETTING_SIDEBAR_WIDGET1_KEY, widgets[1]);
+  persist_write_int(SETTING_SIDEBAR_WIDGET2_KEY, widgets[2]);
+  persist_write_bool(SETTING_USE_LARGE_FONTS_KEY, useLargeFonts);
+  persist_write_bool(SETTING_SIDEBAR_LEFT_KEY, sidebarOnLeft);
+  persist_write_bool(SETTING_BT_VIBE_KEY, btVibe);
+  persist_write_bool(SETTING_SHOW_BATTERY_PCT_KEY, showBatteryPct);
+  persist_write_int(SETTING_HOURLY_VIBE_KEY, hourlyVibe);
+
+  // older builds (energy_report.py --against) don't have chime settings
+  #ifdef SETTING_CHIME_PATTERN_KEY
+    persist_write_int(SETTING_CHIME_PATTERN_KEY, chimePattern);
+    persist_write_int(SETTING_QUIET_HOURS_START_KEY, quietHoursStart);
+    persist_write_int(SETTING_QUIET_HOURS_END_KEY, quietHoursEnd);
+  #else
+    (void)chimePattern;
+    (void)quietHoursStart;
+    (void)quietHoursEnd;
+  #endif
+
+  #ifdef SETTING_NIGHT_MODE_KEY
+    persist_write_bool(SETTING_NIGHT_MODE_KEY, nightMode);
+    persist_write_int(SETTING_NIGHT_START_HOUR_KEY, nightStartHour);
+    persist_write_int(SETTING_NIGHT_END_HOUR_KEY, nightEndHour);
+  #else
+    (void)nightMode;
+    (void)nightStartHour;
+    (void)nightEndHour;
+  #endif
+
+  init();
+  host_render_frame();
+
+  // launching the face isn't part of the day
+  host_reset_counters();
+
+  #ifdef PBL_HEALTH
+    int steps = 0;
+  #endif
+
+  for(int minute = 0; minute < MINUTES_PER_DAY; minute++) {
+    updateBattery(minute);
+
+    bool connected = !inRanges(disconnections, ARRAY_LENGTH(disconnections), minute);
+
+    if(connected != bluetooth_connection_service_peek()) {
+      host_set_bluetooth(connected);
+    }
+
+    #ifdef PBL_HEALTH
+      bool asleep = inRanges(sleepPeriods, ARRAY_LENGTH(sleepPeriods), minute);
+      host_set_health_activities(asleep ? HealthActivitySleep : HealthActivityNone);
+
+      if(minute >= 7 * 60 && minute < 22 * 60) {
+        steps += 8;
+      }
+
+      host_set_health_metric(HealthMetricStepCount, steps);
+      host_set_health_metric(HealthMetricWalkedDistanceMeters, steps * 3 / 4);
+      host_set_health_metric(HealthMetricSleepSeconds, (minute < 6 * 60 + 30 ? minute : 6 * 60 + 30) * 60);
+      host_set_health_minute_steps(asleep ? 0 : 8);
+    #else
+      (void)sleepPeriods;
+    #endif
+
+    host_advance_time(SECONDS_PER_MINUTE * 1000);
+
+    // the phone answers any request that went out this minute
+    if(host_deliver_outbox() && connected) {
+      replyWithWeather(minute);
+    }
+  }
+
+  HostCounters day = host_counters;
+
+  deinit();
+
+  if(tracePath && !saveTrace(tracePath)) {
+    fprintf(stderr, "can't save the event trace to %s\n", tracePath);
+    return 1;
+  }
+
+  fprintf(stdout, "{\"wakeups\": %u, \"frames\": %u, \"layer_renders\": %u, \"draw_calls\": %u, "
+         "\"pixels_written\": %u, \"resource_loads\": %u, \"persist_writes\": %u, "
+         "\"persist_bytes_written\": %u, \"messages_sent\": %u, \"message_bytes_sent\": %u, "
+         "\"messages_received\": %u, \"message_bytes_received\": %u, \"vibes\": %u, "
+         "\"vibe_milliseconds\": %u, \"health_queries\": %u, \"frame_buffer_captures\": %u}\n",
+         day.wakeups, day.frames, day.layerRenders, day.drawCalls,
+         day.pixelsWritten, day.resourceLoads, day.persistWrites,
+         day.persistBytesWritten, day.messagesSent, day.messageBytesSent,
+         day.messagesReceived, day.messageBytesReceived, day.vibes,
+         day.vibeMilliseconds, day.healthQueries, day.frameBufferCaptures);
+
+  return 0;
+}
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+#
+# Estimates how much energy the watchface spends in a day, for a set of
+# configurations on each platform. A simulated day (see day_sim.c) is
+# replayed through the face, and every counted operation is weighted with
+# the coefficients in energy_coefficients.json.
+#
+#   tools/host/energy_report.py                      report for this tree
+#   tools/host/energy_report.py --save base.json     ...and keep the results
+#   tools/host/energy_report.py --compare base.json  fail on regressions
+#   tools/host/energy_report.py --against HEAD~1     build HEAD~1 and compare
+#
+# Requires gcc, libpng and zlib.
+
+import argparse
+import io
+import json
+import multiprocessing
+import os
+import subprocess
+import sys
+import tarfile
+import tempfile
+
+from host_build import BUILD_DIR, HOST_DIR, PLATFORMS, REPO_DIR, build
+
+# name -> arguments for day_sim
+CONFIGURATIONS = {
+    'default':         ['--widgets', '7,0,4'],
+    'large-fonts':     ['--widgets', '7,0,4', '--large-fonts'],
+    'seconds':         ['--widgets', '4,5,7'],
+    'battery-health':  ['--widgets', '2,10,4', '--battery-pct'],
+    'health-history':  ['--widgets', '10,14,4'],
+    'weather-forecast': ['--widgets', '7,8,4'],
+    'clock-week':      ['--widgets', '3,6,12', '--left'],
+    'vibes':           ['--widgets', '7,0,4', '--hourly-vibe', '2', '--bt-vibe'],
+    'night-mode':      ['--widgets', '10,5,7', '--hourly-vibe', '1', '--night-mode', '--night-hours', '23,7'],
+}
+
+
+def run_day(job):
+    binary, name, arguments = job
+    env = dict(os.environ, LC_ALL='C')
+    output = subprocess.check_output([binary] + arguments, env=env)
+    return name, json.loads(output)
+
+
+def energy(counters, coefficients):
+    """Returns the day's energy in millijoules, and how it splits by operation"""
+    parts = {}
+
+    for key, count in counters.items():
+        parts[key] = count * coefficients.get(key, 0) / 1000.0
+
+    return sum(parts.values()), parts
+
+
+def battery_percent(millijoules, platform, coefficients):
+    capacity_mj = coefficients['battery_capacity_mah'][platform] * 3.6 * coefficients['battery_voltage'] * 1000
+    return 100.0 * millijoules / capacity_mj
+
+
+def simulate(repo_dir, build_dir, platforms, jobs):
+    """Runs every configuration on every platform; returns {platform: {name: counters}}"""
+    results = {}
+
+    for platform in platforms:
+        binary = build(platform, 'day_sim', repo_dir=repo_dir, build_dir=build_dir)
+        work = [(binary, name, arguments) for name, arguments in CONFIGURATIONS.items()]
+
+        with multiprocessing.Pool(max(1, jobs)) as pool:
+            results[platform] = dict(pool.map(run_day, work))
+
+    return results
+
+
+def export_revision(revision, out_dir):
+    """Extracts the face sources and resources of a git revision into out_dir"""
+    archive = subprocess.check_output(['git', 'archive', revision, 'src', 'resources', 'appinfo.json'],
+                                      cwd=REPO_DIR)
+
+    with tarfile.open(fileobj=io.BytesIO(archive)) as tar:
+        tar.extractall(out_dir)
+
+
+def report(results, coefficients):
+    """Prints the energy table and returns {platform: {name: millijoules}}"""
+    totals = {}
+
+    print('%-8s %-17s %7s %7s %9s %7s %6s %8s %10s %8s' % (
+        'platform', 'configuration', 'wakeups', 'frames', 'Mpixels', 'flash', 'msgs', 'vibe ms',
+        'mJ/day', 'batt/day'))
+
+    for platform, configurations in results.items():
+        totals[platform] = {}
+
+        for name, counters in configurations.items():
+            millijoules, parts = energy(counters, coefficients)
+            totals[platform][name] = millijoules
+
+            print('%-8s %-17s %7d %7d %9.2f %7d %6d %8d %10.1f %7.2f%%' % (
+                platform, name, counters['wakeups'], counters['frames'],
+                counters['pixels_written'] / 1e6, counters['persist_writes'],
+                counters['messages_sent'] + counters['messages_received'],
+                counters['vibe_milliseconds'], millijoules,
+                battery_percent(millijoules, platform, coefficients)))
+
+    return totals
+
+
+def compare(base, current, coefficients, threshold):
+    """Prints the change per configuration; returns False if any regressed past the threshold"""
+    ok = True
+
+    print('')
+    print('%-8s %-17s %10s %10s %8s' % ('platform', 'configuration', 'base mJ', 'new mJ', 'change'))
+
+    for platform, configurations in current.items():
+        for name, counters in configurations.items():
+            if name not in base.get(platform, {}):
+                continue
+
+            base_mj, base_parts = energy(base[platform][name], coefficients)
+            new_mj, new_parts = energy(counters, coefficients)
+            change = 100.0 * (new_mj - base_mj) / base_mj if base_mj else 0.0
+            regressed = change > threshold
+
+            print('%-8s %-17s %10.1f %10.1f %+7.2f%%%s' % (
+                platform, name, base_mj, new_mj, change, '  REGRESSION' if regressed else ''))
+
+            if regressed:
+                ok = False
+
+                # say where the extra energy went
+                for key in sorted(new_parts, key=lambda k: new_parts[k] - base_parts.get(k, 0), reverse=True)[:3]:
+                    delta = new_parts[key] - base_parts.get(key, 0)
+
+                    if delta > 0:
+                        print('%28s %+10.1f mJ from %s' % ('', delta, key))
+
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Estimate the daily energy use of the watchface.')
+    parser.add_argument('--platform', action='append', choices=PLATFORMS,
+                        help='platform to simulate (default: all of them)')
+    parser.add_argument('--coefficients', default=os.path.join(HOST_DIR, 'energy_coefficients.json'),
+                        help='JSON file with the energy per operation, in microjoules')
+    parser.add_argument('--jobs', type=int, default=multiprocessing.cpu_count(),
+                        help='number of simulations to run in parallel')
+    parser.add_argument('--save', help='write the operation counts to this JSON file')
+    baseline = parser.add_mutually_exclusive_group()
+    baseline.add_argument('--compare', help='operation counts saved from another build, to compare against')
+    baseline.add_argument('--against', metavar='REVISION', help='git revision to build and compare against')
+    parser.add_argument('--threshold', type=float, default=2.0,
+                        help='fail when a configuration uses this many percent more energy (default 2)')
+    args = parser.parse_args()
+
+    with open(args.coefficients) as f:
+        coefficients = json.load(f)
+
+    platforms = args.platform or PLATFORMS
+    results = simulate(REPO_DIR, BUILD_DIR, platforms, args.jobs)
+
+    report(results, coefficients)
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+    base = None
+
+    if args.compare:
+        with open(args.compare) as f:
+            base = json.load(f)
+    elif args.against:
+        with tempfile.TemporaryDirectory() as checkout:
+            export_revision(args.against, checkout)
+            base = simulate(checkout, os.path.join(checkout, 'host-build'), platforms, args.jobs)
+
+    if base is not None and not compare(base, results, coefficients, args.threshold):
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
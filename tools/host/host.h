@@ -0,0 +1,91 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * Controls for the host-side Pebble stand-in: the simulated clock, battery,
+ * bluetooth and health state, the software framebuffer, and the counters
+ * used to cost what the watchface does.
+ */
+
+/*
+ * Everything the face did since the counters were last reset. Each of these
+ * costs power on the watch, so they are the inputs of the energy model.
+ */
+typedef struct {
+  uint32_t drawCalls;
+  uint32_t pixelsWritten;
+  uint32_t layerRenders;
+  uint32_t dirtyMarks;
+  uint32_t frames;
+  uint32_t resourceLoads;
+  uint32_t persistWrites;
+  uint32_t persistBytesWritten;
+  uint32_t messagesSent;
+  uint32_t messageBytesSent;
+  uint32_t messagesReceived;
+  uint32_t messageBytesReceived;
+  uint32_t vibes;
+  uint32_t vibeMilliseconds;
+  uint32_t healthQueries;
+  uint32_t wakeups;
+  uint32_t ticks;
+  uint32_t frameBufferCaptures;
+} HostCounters;
+
+extern HostCounters host_counters;
+
+/*
+ * Forgets all persisted data, timers, subscriptions and counters, and puts
+ * the simulated watch back in its default state: 2016-03-14 09:26:53 UTC,
+ * 60% battery, phone connected, no health data
+ */
+void host_reset();
+void host_reset_counters();
+
+// prints APP_LOG and printf output from the face to stderr
+void host_set_verbose(bool verbose);
+
+/*
+ * Simulated time. Advancing the clock fires due app timers and tick events
+ * in order, and renders a frame after each one that dirtied a layer.
+ */
+void host_set_time(time_t t);
+int64_t host_get_time_ms();
+void host_advance_time(uint32_t ms);
+void host_set_24h_style(bool is24h);
+void host_set_quiet_time(bool isActive);
+
+// these call the subscribed handlers, like the real services do
+void host_set_battery(uint8_t percent, bool isCharging);
+void host_set_bluetooth(bool isConnected);
+
+#ifdef PBL_HEALTH
+  void host_set_health_metric(HealthMetric metric, HealthValue value);
+  void host_set_health_activities(HealthActivityMask activities);
+
+  // steps reported for every minute of the minute history
+  void host_set_health_minute_steps(uint8_t steps);
+#endif
+
+/*
+ * AppMessage. A message received from the phone is built with the dict_write
+ * functions on a caller-owned buffer. Sent messages stay pending until
+ * host_deliver_outbox() reports their result to the face.
+ */
+void host_app_message_receive(DictionaryIterator* iter);
+void host_set_outbox_result(AppMessageResult result);
+bool host_deliver_outbox();
+DictionaryIterator* host_get_last_outbox();
+
+/*
+ * Renders the window if any layer was marked dirty since the last frame.
+ * Like the firmware, the whole layer tree is drawn whenever anything is dirty.
+ * Returns true if a frame was drawn.
+ */
+bool host_render_frame();
+
+GBitmap* host_get_frame_buffer();
+GColor host_get_pixel(int x, int y);
+
+// writes the current framebuffer to an RGB PNG file
+bool host_write_png(const char* path);
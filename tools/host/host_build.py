@@ -0,0 +1,73 @@
+#
+# Shared helpers for the host tools: compiles the watchface sources of a
+# checkout against the software Pebble stand-in in this directory.
+#
+
+import json
+import os
+import subprocess
+
+HOST_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.abspath(os.path.join(HOST_DIR, '..', '..'))
+BUILD_DIR = os.path.join(HOST_DIR, 'build')
+
+PLATFORMS = ['aplite', 'basalt', 'chalk']
+
+
+def generate_resource_ids(repo_dir, out_dir):
+    """Writes resource_ids.auto.h, numbering resources the way the SDK does"""
+    with open(os.path.join(repo_dir, 'appinfo.json')) as f:
+        media = json.load(f)['resources']['media']
+
+    lines = ['#pragma once', '']
+    files = ['NULL']
+
+    for index, resource in enumerate(media):
+        lines.append('#define RESOURCE_ID_%s %d' % (resource['name'], index + 1))
+        files.append(json.dumps(os.path.join(repo_dir, 'resources', resource['file'])))
+
+    lines += ['', '// the file behind each resource id, for the host build only',
+              '#define HOST_RESOURCE_FILES { \\']
+    lines += ['  %s, \\' % f for f in files]
+    lines += ['}', '']
+
+    path = os.path.join(out_dir, 'resource_ids.auto.h')
+    contents = '\n'.join(lines)
+
+    # leave the header alone if nothing changed, so it doesn't look newer
+    if not os.path.exists(path) or open(path).read() != contents:
+        with open(path, 'w') as f:
+            f.write(contents)
+
+
+def face_sources(src_dir):
+    sources = []
+
+    for root, dirs, files in os.walk(src_dir):
+        for name in sorted(files):
+            # main.c is included by the tool that drives it
+            if name.endswith('.c') and not (root == src_dir and name == 'main.c'):
+                sources.append(os.path.join(root, name))
+
+    return sorted(sources)
+
+
+def build(platform, tool, repo_dir=REPO_DIR, build_dir=BUILD_DIR):
+    """Compiles a host tool for the given platform and returns its path"""
+    src_dir = os.path.join(repo_dir, 'src')
+    out_dir = os.path.join(build_dir, platform)
+    os.makedirs(out_dir, exist_ok=True)
+    generate_resource_ids(repo_dir, out_dir)
+
+    binary = os.path.join(out_dir, tool)
+    sources = face_sources(src_dir) + [os.path.join(HOST_DIR, 'host_pebble.c'),
+                                       os.path.join(HOST_DIR, tool + '.c')]
+
+    command = ['gcc', '-std=gnu11', '-O2', '-g', '-Wall', '-Wextra', '-Wno-unused-parameter',
+               '-DPBL_PLATFORM_%s' % platform.upper(),
+               '-I', HOST_DIR, '-I', out_dir, '-I', src_dir,
+               '-o', binary] + sources + ['-lpng', '-lz', '-lm']
+
+    subprocess.check_call(command)
+
+    return binary
@@ -0,0 +1,2471 @@
+#include <pebble.h>
+#include <stdarg.h>
+#include <math.h>
+#include <png.h>
+#include <zlib.h>
+#include "host.h"
+
+// this file needs the host's own clock and printf
+#undef time
+#undef localtime
+#undef printf
+
+HostCounters host_counters;
+
+static bool verbose;
+
+/********** logging, time **********/
+
+int host_printf(const char* fmt, ...) {
+  if(!verbose) {
+    return 0;
+  }
+
+  va_list args;
+  va_start(args, fmt);
+  int written = vfprintf(stderr, fmt, args);
+  va_end(args);
+
+  return written;
+}
+
+void host_set_verbose(bool isVerbose) {
+  verbose = isVerbose;
+}
+
+// 2016-03-14 09:26:53 UTC
+#define HOST_DEFAULT_TIME 1457947613
+
+static int64_t nowMs;
+static bool is24hStyle;
+static bool quietTimeActive;
+
+time_t host_time(time_t* t) {
+  time_t now = (time_t)(nowMs / 1000);
+
+  if(t) {
+    *t = now;
+  }
+
+  return now;
+}
+
+struct tm* host_localtime(const time_t* t) {
+  static struct tm result;
+  gmtime_r(t, &result);
+  return &result;
+}
+
+time_t time_start_of_today() {
+  time_t now = host_time(NULL);
+  return now - now % SECONDS_PER_DAY;
+}
+
+uint16_t time_ms(time_t* tloc, uint16_t* out_ms) {
+  uint16_t ms = (uint16_t)(nowMs % 1000);
+
+  if(tloc) {
+    *tloc = host_time(NULL);
+  }
+
+  if(out_ms) {
+    *out_ms = ms;
+  }
+
+  return ms;
+}
+
+bool clock_is_24h_style() {
+  return is24hStyle;
+}
+
+bool quiet_time_is_active() {
+  return quietTimeActive;
+}
+
+void host_set_24h_style(bool is24h) {
+  is24hStyle = is24h;
+}
+
+void host_set_quiet_time(bool isActive) {
+  quietTimeActive = isActive;
+}
+
+int64_t host_get_time_ms() {
+  return nowMs;
+}
+
+/********** colors and geometry **********/
+
+GColor8 GColorFromRGBA(int red, int green, int blue, int alpha) {
+  return GColorARGB8(alpha >> 6, red >> 6, green >> 6, blue >> 6);
+}
+
+GColor8 GColorFromRGB(int red, int green, int blue) {
+  return GColorFromRGBA(red, green, blue, 255);
+}
+
+GColor8 GColorFromHEX(uint32_t hex) {
+  return GColorFromRGB((hex >> 16) & 0xff, (hex >> 8) & 0xff, hex & 0xff);
+}
+
+bool gcolor_equal(GColor8 x, GColor8 y) {
+  return x.argb == y.argb;
+}
+
+bool gpoint_equal(const GPoint* const point_a, const GPoint* const point_b) {
+  return point_a->x == point_b->x && point_a->y == point_b->y;
+}
+
+bool grect_equal(const GRect* const rect_a, const GRect* const rect_b) {
+  return gpoint_equal(&rect_a->origin, &rect_b->origin) &&
+         rect_a->size.w == rect_b->size.w && rect_a->size.h == rect_b->size.h;
+}
+
+bool grect_contains_point(const GRect* rect, const GPoint* point) {
+  return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w &&
+         point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+int32_t sin_lookup(int32_t angle) {
+  return (int32_t)lround(sin(angle * 2.0 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t cos_lookup(int32_t angle) {
+  return (int32_t)lround(cos(angle * 2.0 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+static GRect intersectRects(GRect a, GRect b) {
+  int x0 = (a.origin.x > b.origin.x) ? a.origin.x : b.origin.x;
+  int y0 = (a.origin.y > b.origin.y) ? a.origin.y : b.origin.y;
+  int x1 = (a.origin.x + a.size.w < b.origin.x + b.size.w) ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+  int y1 = (a.origin.y + a.size.h < b.origin.y + b.size.h) ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+
+  if(x1 < x0) {
+    x1 = x0;
+  }
+
+  if(y1 < y0) {
+    y1 = y0;
+  }
+
+  return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+/********** bitmaps **********/
+
+struct GBitmap {
+  GBitmapFormat format;
+  GRect bounds;
+  uint16_t bytesPerRow;
+  uint8_t* data;
+  GColor* palette;
+  bool freePalette;
+
+  // only used by the round framebuffer: the visible span of each row
+  int16_t* rowMinX;
+  int16_t* rowMaxX;
+};
+
+static int bitsPerPixel(GBitmapFormat format) {
+  switch(format) {
+    case GBitmapFormat1Bit:
+    case GBitmapFormat1BitPalette:
+      return 1;
+    case GBitmapFormat2BitPalette:
+      return 2;
+    case GBitmapFormat4BitPalette:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+static int paletteSize(GBitmapFormat format) {
+  switch(format) {
+    case GBitmapFormat1BitPalette:
+      return 2;
+    case GBitmapFormat2BitPalette:
+      return 4;
+    case GBitmapFormat4BitPalette:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+static GBitmap* createBitmap(GSize size, GBitmapFormat format) {
+  GBitmap* bitmap = calloc(1, sizeof(GBitmap));
+
+  bitmap->format = format;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+
+  if(format == GBitmapFormat1Bit) {
+    // native 1-bit rows are padded to a whole word
+    bitmap->bytesPerRow = ((size.w + 31) / 32) * 4;
+  } else {
+    bitmap->bytesPerRow = (size.w * bitsPerPixel(format) + 7) / 8;
+  }
+
+  bitmap->data = calloc(size.h, bitmap->bytesPerRow);
+
+  if(paletteSize(format) > 0) {
+    bitmap->palette = calloc(paletteSize(format), sizeof(GColor));
+    bitmap->freePalette = true;
+  }
+
+  return bitmap;
+}
+
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  return createBitmap(size, format);
+}
+
+GBitmap* gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor* palette, bool free_on_destroy) {
+  GBitmap* bitmap = createBitmap(size, format);
+  gbitmap_set_palette(bitmap, palette, free_on_destroy);
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap* bitmap) {
+  if(!bitmap) {
+    return;
+  }
+
+  if(bitmap->freePalette) {
+    free(bitmap->palette);
+  }
+
+  free(bitmap->rowMinX);
+  free(bitmap->rowMaxX);
+  free(bitmap->data);
+  free(bitmap);
+}
+
+GColor* gbitmap_get_palette(const GBitmap* bitmap) {
+  return bitmap->palette;
+}
+
+void gbitmap_set_palette(GBitmap* bitmap, GColor* palette, bool free_on_destroy) {
+  if(bitmap->freePalette) {
+    free(bitmap->palette);
+  }
+
+  bitmap->palette = palette;
+  bitmap->freePalette = free_on_destroy;
+}
+
+uint8_t* gbitmap_get_data(const GBitmap* bitmap) {
+  return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap) {
+  return bitmap->bytesPerRow;
+}
+
+GRect gbitmap_get_bounds(const GBitmap* bitmap) {
+  return bitmap->bounds;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap) {
+  return bitmap->format;
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap* bitmap, uint16_t y) {
+  GBitmapDataRowInfo info;
+
+  info.data = bitmap->data + y * bitmap->bytesPerRow;
+
+  if(bitmap->rowMinX) {
+    info.min_x = bitmap->rowMinX[y];
+    info.max_x = bitmap->rowMaxX[y];
+  } else {
+    info.min_x = 0;
+    info.max_x = bitmap->bounds.size.w - 1;
+  }
+
+  return info;
+}
+
+static GColor bitmapGetPixel(const GBitmap* bitmap, int x, int y) {
+  uint8_t* row = bitmap->data + y * bitmap->bytesPerRow;
+
+  switch(bitmap->format) {
+    case GBitmapFormat1Bit:
+      // least significant bit first, set bits are white
+      return ((row[x / 8] >> (x % 8)) & 1) ? GColorWhite : GColorBlack;
+    case GBitmapFormat8Bit:
+    case GBitmapFormat8BitCircular:
+      return (GColor){.argb = row[x]};
+    default: {
+      // palettized formats store the most significant bits first
+      int bpp = bitsPerPixel(bitmap->format);
+      int bit = x * bpp;
+      int shift = 8 - bpp - (bit % 8);
+      int index = (row[bit / 8] >> shift) & ((1 << bpp) - 1);
+      return bitmap->palette[index];
+    }
+  }
+}
+
+/********** resources **********/
+
+static const char* const resourceFiles[] = HOST_RESOURCE_FILES;
+
+/*
+ * A decoded image, kept so that the sweep doesn't decode the same PNG for
+ * every frame. Loading it still counts as a resource load.
+ */
+typedef struct {
+  bool isLoaded;
+  GBitmapFormat format;
+  GSize size;
+  int paletteCount;
+  GColor palette[16];
+  uint8_t* indices;
+} DecodedImage;
+
+static DecodedImage decodedImages[ARRAY_LENGTH(resourceFiles)];
+
+static uint8_t* readResource(uint32_t resource_id, size_t* size) {
+  if(resource_id == 0 || resource_id >= ARRAY_LENGTH(resourceFiles)) {
+    return NULL;
+  }
+
+  FILE* file = fopen(resourceFiles[resource_id], "rb");
+
+  if(!file) {
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  uint8_t* data = malloc(length);
+
+  if(fread(data, 1, length, file) != (size_t)length) {
+    free(data);
+    data = NULL;
+  }
+
+  fclose(file);
+  *size = length;
+
+  return data;
+}
+
+// a handle is just the resource id, since every load reads the file afresh
+ResHandle resource_get_handle(uint32_t resource_id) {
+  if(resource_id == 0 || resource_id >= ARRAY_LENGTH(resourceFiles)) {
+    return NULL;
+  }
+
+  return (ResHandle)(uintptr_t)resource_id;
+}
+
+size_t resource_size(ResHandle h) {
+  size_t size = 0;
+  uint8_t* data = readResource((uintptr_t)h, &size);
+
+  if(!data) {
+    return 0;
+  }
+
+  free(data);
+  return size;
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t* buffer, size_t num_bytes) {
+  size_t size = 0;
+  uint8_t* data = readResource((uintptr_t)h, &size);
+
+  if(!data) {
+    return 0;
+  }
+
+  size_t length = start_offset < size ? size - start_offset : 0;
+
+  if(length > num_bytes) {
+    length = num_bytes;
+  }
+
+  memcpy(buffer, data + start_offset, length);
+  free(data);
+
+  host_counters.resourceLoads++;
+  return length;
+}
+
+size_t resource_load(ResHandle h, uint8_t* buffer, size_t max_length) {
+  return resource_load_byte_range(h, 0, buffer, max_length);
+}
+
+/*
+ * Decodes a PNG the way the SDK's resource compiler would: the image is
+ * reduced to the gray levels the platform can show, and each level present
+ * becomes a palette entry, darkest first
+ */
+static bool decodeImage(uint32_t resource_id, DecodedImage* image) {
+  png_image png;
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+
+  if(!png_image_begin_read_from_file(&png, resourceFiles[resource_id])) {
+    return false;
+  }
+
+  png.format = PNG_FORMAT_GA;
+  uint8_t* pixels = malloc(PNG_IMAGE_SIZE(png));
+
+  if(!png_image_finish_read(&png, NULL, pixels, 0, NULL)) {
+    free(pixels);
+    return false;
+  }
+
+  #ifdef PBL_COLOR
+    int levels = 4;
+  #else
+    int levels = 2;
+  #endif
+
+  bool levelUsed[5] = {false};
+  int pixelCount = png.width * png.height;
+  uint8_t* quantized = malloc(pixelCount);
+
+  for(int i = 0; i < pixelCount; i++) {
+    int gray = pixels[i * 2];
+    int alpha = pixels[i * 2 + 1];
+
+    // fully transparent pixels get their own clear entry
+    quantized[i] = (alpha < 128) ? levels : (gray * (levels - 1) + 127) / 255;
+    levelUsed[quantized[i]] = true;
+  }
+
+  int levelIndex[5];
+  image->paletteCount = 0;
+
+  for(int level = 0; level <= levels; level++) {
+    if(levelUsed[level]) {
+      int shade = (level == levels) ? 0 : level * 255 / (levels - 1);
+      levelIndex[level] = image->paletteCount;
+      image->palette[image->paletteCount++] = GColorFromRGBA(shade, shade, shade, (level == levels) ? 0 : 255);
+    }
+  }
+
+  image->format = (image->paletteCount <= 2) ? GBitmapFormat1BitPalette :
+                  (image->paletteCount <= 4) ? GBitmapFormat2BitPalette : GBitmapFormat4BitPalette;
+  image->size = GSize(png.width, png.height);
+  image->indices = quantized;
+
+  for(int i = 0; i < pixelCount; i++) {
+    image->indices[i] = levelIndex[image->indices[i]];
+  }
+
+  image->isLoaded = true;
+  free(pixels);
+
+  return true;
+}
+
+GBitmap* gbitmap_create_with_resource(uint32_t resource_id) {
+  if(resource_id == 0 || resource_id >= ARRAY_LENGTH(resourceFiles)) {
+    return NULL;
+  }
+
+  DecodedImage* image = &decodedImages[resource_id];
+
+  if(!image->isLoaded && !decodeImage(resource_id, image)) {
+    return NULL;
+  }
+
+  host_counters.resourceLoads++;
+
+  GBitmap* bitmap = createBitmap(image->size, image->format);
+  memcpy(bitmap->palette, image->palette, image->paletteCount * sizeof(GColor));
+
+  int bpp = bitsPerPixel(image->format);
+
+  for(int y = 0; y < image->size.h; y++) {
+    uint8_t* row = bitmap->data + y * bitmap->bytesPerRow;
+
+    for(int x = 0; x < image->size.w; x++) {
+      int bit = x * bpp;
+      row[bit / 8] |= image->indices[y * image->size.w + x] << (8 - bpp - (bit % 8));
+    }
+  }
+
+  return bitmap;
+}
+
+/********** graphics context **********/
+
+struct GContext {
+  GBitmap* frameBuffer;
+
+  // the current layer's drawing origin and clip, in screen coordinates
+  GPoint origin;
+  GRect clip;
+
+  GColor strokeColor;
+  GColor fillColor;
+  GColor textColor;
+  GCompOp compOp;
+  uint8_t strokeWidth;
+  bool antialiased;
+};
+
+static GContext context;
+
+static void setScreenPixel(GContext* ctx, int x, int y, GColor color) {
+  GPoint point = GPoint(x, y);
+
+  if(color.a == 0 || !grect_contains_point(&ctx->clip, &point)) {
+    return;
+  }
+
+  GBitmap* frameBuffer = ctx->frameBuffer;
+
+  if(frameBuffer->rowMinX && (x < frameBuffer->rowMinX[y] || x > frameBuffer->rowMaxX[y])) {
+    return;
+  }
+
+  uint8_t* row = frameBuffer->data + y * frameBuffer->bytesPerRow;
+
+  #ifdef PBL_COLOR
+    row[x] = color.argb;
+  #else
+    // anything at least as light as light gray shows up as white
+    if(color.r + color.g + color.b >= 6) {
+      row[x / 8] |= (1 << (x % 8));
+    } else {
+      row[x / 8] &= ~(1 << (x % 8));
+    }
+  #endif
+
+  host_counters.pixelsWritten++;
+}
+
+// sets a pixel in the current layer's coordinates
+static void setPixel(GContext* ctx, int x, int y, GColor color) {
+  setScreenPixel(ctx, ctx->origin.x + x, ctx->origin.y + y, color);
+}
+
+void graphics_context_set_stroke_color(GContext* ctx, GColor color) {
+  ctx->strokeColor = color;
+}
+
+void graphics_context_set_fill_color(GContext* ctx, GColor color) {
+  ctx->fillColor = color;
+}
+
+void graphics_context_set_text_color(GContext* ctx, GColor color) {
+  ctx->textColor = color;
+}
+
+void graphics_context_set_compositing_mode(GContext* ctx, GCompOp mode) {
+  ctx->compOp = mode;
+}
+
+void graphics_context_set_antialiased(GContext* ctx, bool enable) {
+  ctx->antialiased = enable;
+}
+
+void graphics_context_set_stroke_width(GContext* ctx, uint8_t stroke_width) {
+  ctx->strokeWidth = (stroke_width > 0) ? stroke_width : 1;
+}
+
+/********** primitives **********/
+
+static void fillCircle(GContext* ctx, double cx, double cy, double radius, GColor color) {
+  int x0 = (int)floor(cx - radius);
+  int x1 = (int)ceil(cx + radius);
+  int y0 = (int)floor(cy - radius);
+  int y1 = (int)ceil(cy + radius);
+
+  for(int y = y0; y <= y1; y++) {
+    for(int x = x0; x <= x1; x++) {
+      double dx = x - cx;
+      double dy = y - cy;
+
+      if(dx * dx + dy * dy <= radius * radius) {
+        setPixel(ctx, x, y, color);
+      }
+    }
+  }
+}
+
+// draws a line with the given width, with round caps like the firmware's
+static void strokeLine(GContext* ctx, double x0, double y0, double x1, double y1, int width, GColor color) {
+  if(width <= 1) {
+    int ax = (int)lround(x0), ay = (int)lround(y0);
+    int bx = (int)lround(x1), by = (int)lround(y1);
+    int dx = abs(bx - ax), sx = (ax < bx) ? 1 : -1;
+    int dy = -abs(by - ay), sy = (ay < by) ? 1 : -1;
+    int err = dx + dy;
+
+    while(true) {
+      setPixel(ctx, ax, ay, color);
+
+      if(ax == bx && ay == by) {
+        break;
+      }
+
+      int e2 = 2 * err;
+
+      if(e2 >= dy) {
+        err += dy;
+        ax += sx;
+      }
+
+      if(e2 <= dx) {
+        err += dx;
+        ay += sy;
+      }
+    }
+
+    return;
+  }
+
+  double length = hypot(x1 - x0, y1 - y0);
+  int steps = (int)ceil(length) + 1;
+
+  for(int i = 0; i <= steps; i++) {
+    double t = (steps > 0) ? (double)i / steps : 0;
+    fillCircle(ctx, x0 + (x1 - x0) * t, y0 + (y1 - y0) * t, width / 2.0, color);
+  }
+}
+
+// even-odd scanline fill, sampling at pixel centers
+static void fillPolygon(GContext* ctx, const double* xs, const double* ys, int count, GColor color) {
+  if(count < 3) {
+    return;
+  }
+
+  double minY = ys[0], maxY = ys[0];
+
+  for(int i = 1; i < count; i++) {
+    minY = (ys[i] < minY) ? ys[i] : minY;
+    maxY = (ys[i] > maxY) ? ys[i] : maxY;
+  }
+
+  double* crossings = malloc(count * sizeof(double));
+
+  for(int y = (int)floor(minY); y <= (int)ceil(maxY); y++) {
+    double sampleY = y + 0.5;
+    int crossingCount = 0;
+
+    for(int i = 0; i < count; i++) {
+      int j = (i + 1) % count;
+
+      if((ys[i] <= sampleY && ys[j] > sampleY) || (ys[j] <= sampleY && ys[i] > sampleY)) {
+        crossings[crossingCount++] = xs[i] + (sampleY - ys[i]) * (xs[j] - xs[i]) / (ys[j] - ys[i]);
+      }
+    }
+
+    // insertion sort, there are only ever a handful
+    for(int i = 1; i < crossingCount; i++) {
+      double value = crossings[i];
+      int j = i - 1;
+
+      while(j >= 0 && crossings[j] > value) {
+        crossings[j + 1] = crossings[j];
+        j--;
+      }
+
+      crossings[j + 1] = value;
+    }
+
+    for(int i = 0; i + 1 < crossingCount; i += 2) {
+      for(int x = (int)ceil(crossings[i] - 0.5); x + 0.5 < crossings[i + 1]; x++) {
+        setPixel(ctx, x, y, color);
+      }
+    }
+  }
+
+  free(crossings);
+}
+
+void graphics_draw_pixel(GContext* ctx, GPoint point) {
+  host_counters.drawCalls++;
+  setPixel(ctx, point.x, point.y, ctx->strokeColor);
+}
+
+void graphics_draw_line(GContext* ctx, GPoint p0, GPoint p1) {
+  host_counters.drawCalls++;
+  strokeLine(ctx, p0.x, p0.y, p1.x, p1.y, ctx->strokeWidth, ctx->strokeColor);
+}
+
+void graphics_draw_rect(GContext* ctx, GRect rect) {
+  host_counters.drawCalls++;
+
+  int x0 = rect.origin.x, y0 = rect.origin.y;
+  int x1 = x0 + rect.size.w - 1, y1 = y0 + rect.size.h - 1;
+
+  strokeLine(ctx, x0, y0, x1, y0, 1, ctx->strokeColor);
+  strokeLine(ctx, x0, y1, x1, y1, 1, ctx->strokeColor);
+  strokeLine(ctx, x0, y0, x0, y1, 1, ctx->strokeColor);
+  strokeLine(ctx, x1, y0, x1, y1, 1, ctx->strokeColor);
+}
+
+void graphics_fill_rect(GContext* ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+  host_counters.drawCalls++;
+
+  int r = corner_radius;
+
+  for(int y = 0; y < rect.size.h; y++) {
+    for(int x = 0; x < rect.size.w; x++) {
+      // skip pixels outside the rounded corners
+      int cornerX = (x < r) ? r - x : (x >= rect.size.w - r) ? x - (rect.size.w - r - 1) : 0;
+      int cornerY = (y < r) ? r - y : (y >= rect.size.h - r) ? y - (rect.size.h - r - 1) : 0;
+
+      if(cornerX > 0 && cornerY > 0) {
+        GCornerMask corner = (y < r) ? ((x < r) ? GCornerTopLeft : GCornerTopRight)
+                                     : ((x < r) ? GCornerBottomLeft : GCornerBottomRight);
+
+        if((corner_mask & corner) && cornerX * cornerX + cornerY * cornerY > r * r) {
+          continue;
+        }
+      }
+
+      setPixel(ctx, rect.origin.x + x, rect.origin.y + y, ctx->fillColor);
+    }
+  }
+}
+
+void graphics_draw_circle(GContext* ctx, GPoint p, uint16_t radius) {
+  host_counters.drawCalls++;
+
+  for(int y = -radius - 1; y <= radius + 1; y++) {
+    for(int x = -radius - 1; x <= radius + 1; x++) {
+      double distance = hypot(x, y);
+
+      if(distance > radius - 0.5 && distance <= radius + 0.5) {
+        setPixel(ctx, p.x + x, p.y + y, ctx->strokeColor);
+      }
+    }
+  }
+}
+
+void graphics_fill_circle(GContext* ctx, GPoint p, uint16_t radius) {
+  host_counters.drawCalls++;
+  fillCircle(ctx, p.x, p.y, radius, ctx->fillColor);
+}
+
+void graphics_fill_radial(GContext* ctx, GRect rect, GOvalScaleMode scale_mode, uint16_t inset_thickness,
+                          int32_t angle_start, int32_t angle_end) {
+  host_counters.drawCalls++;
+
+  double cx = rect.origin.x + (rect.size.w - 1) / 2.0;
+  double cy = rect.origin.y + (rect.size.h - 1) / 2.0;
+  int shortSide = (rect.size.w < rect.size.h) ? rect.size.w : rect.size.h;
+  int longSide = (rect.size.w > rect.size.h) ? rect.size.w : rect.size.h;
+  double outer = ((scale_mode == GOvalScaleModeFitCircle) ? shortSide : longSide) / 2.0;
+  double inner = outer - inset_thickness;
+
+  for(int y = (int)floor(cy - outer); y <= (int)ceil(cy + outer); y++) {
+    for(int x = (int)floor(cx - outer); x <= (int)ceil(cx + outer); x++) {
+      double dx = x - cx;
+      double dy = y - cy;
+      double distance = hypot(dx, dy);
+
+      if(distance > outer || distance < inner) {
+        continue;
+      }
+
+      // angles start at 12 o'clock and go clockwise
+      double angle = atan2(dx, -dy);
+      int32_t trigAngle = (int32_t)((angle < 0 ? angle + 2 * M_PI : angle) * TRIG_MAX_ANGLE / (2 * M_PI));
+
+      if(trigAngle >= angle_start && trigAngle <= angle_end) {
+        setPixel(ctx, x, y, ctx->fillColor);
+      }
+    }
+  }
+}
+
+void graphics_draw_bitmap_in_rect(GContext* ctx, const GBitmap* bitmap, GRect rect) {
+  if(!bitmap) {
+    return;
+  }
+
+  host_counters.drawCalls++;
+
+  GRect bounds = bitmap->bounds;
+
+  // like the firmware, the bitmap is tiled to fill the rect
+  for(int y = 0; y < rect.size.h; y++) {
+    for(int x = 0; x < rect.size.w; x++) {
+      GColor color = bitmapGetPixel(bitmap,
+                                    bounds.origin.x + x % bounds.size.w,
+                                    bounds.origin.y + y % bounds.size.h);
+      setPixel(ctx, rect.origin.x + x, rect.origin.y + y, color);
+    }
+  }
+}
+
+// the framebuffer as it was when it was captured, to count what the face
+// wrote into it directly
+static uint8_t* capturedPixels;
+static size_t capturedSize;
+
+GBitmap* graphics_capture_frame_buffer(GContext* ctx) {
+  GBitmap* frameBuffer = ctx->frameBuffer;
+  size_t size = frameBuffer->bytesPerRow * frameBuffer->bounds.size.h;
+
+  if(size > capturedSize) {
+    capturedPixels = realloc(capturedPixels, size);
+    capturedSize = size;
+  }
+
+  memcpy(capturedPixels, frameBuffer->data, size);
+
+  host_counters.frameBufferCaptures++;
+  return frameBuffer;
+}
+
+/*
+ * Counts the pixels that changed while the framebuffer was captured. A pixel
+ * written with the color it already had can't be told apart from one that
+ * wasn't written, so this is a lower bound of what setScreenPixel would count
+ */
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer) {
+  if(buffer != ctx->frameBuffer) {
+    return false;
+  }
+
+  for(int y = 0; y < buffer->bounds.size.h; y++) {
+    const uint8_t* row = buffer->data + y * buffer->bytesPerRow;
+    const uint8_t* capturedRow = capturedPixels + y * buffer->bytesPerRow;
+
+    #ifdef PBL_COLOR
+      int minX = buffer->rowMinX ? buffer->rowMinX[y] : 0;
+      int maxX = buffer->rowMaxX ? buffer->rowMaxX[y] : buffer->bounds.size.w - 1;
+
+      for(int x = minX; x <= maxX; x++) {
+        if(row[x] != capturedRow[x]) {
+          host_counters.pixelsWritten++;
+        }
+      }
+    #else
+      for(int i = 0; i < buffer->bytesPerRow; i++) {
+        host_counters.pixelsWritten += __builtin_popcount(row[i] ^ capturedRow[i]);
+      }
+    #endif
+  }
+
+  return true;
+}
+
+/********** paths **********/
+
+struct GPath {
+  uint32_t numPoints;
+  GPoint* points;
+  GPoint offset;
+};
+
+GPath* gpath_create(const GPathInfo* init) {
+  GPath* path = calloc(1, sizeof(GPath));
+
+  path->numPoints = init->num_points;
+  path->points = malloc(init->num_points * sizeof(GPoint));
+  memcpy(path->points, init->points, init->num_points * sizeof(GPoint));
+
+  return path;
+}
+
+void gpath_destroy(GPath* gpath) {
+  if(gpath) {
+    free(gpath->points);
+    free(gpath);
+  }
+}
+
+void gpath_move_to(GPath* path, GPoint point) {
+  path->offset = point;
+}
+
+void gpath_draw_filled(GContext* ctx, GPath* path) {
+  host_counters.drawCalls++;
+
+  double* xs = malloc(path->numPoints * sizeof(double));
+  double* ys = malloc(path->numPoints * sizeof(double));
+
+  for(uint32_t i = 0; i < path->numPoints; i++) {
+    xs[i] = path->points[i].x + path->offset.x;
+    ys[i] = path->points[i].y + path->offset.y;
+  }
+
+  fillPolygon(ctx, xs, ys, path->numPoints, ctx->fillColor);
+
+  free(xs);
+  free(ys);
+}
+
+void gpath_draw_outline(GContext* ctx, GPath* path) {
+  host_counters.drawCalls++;
+
+  for(uint32_t i = 0; i < path->numPoints; i++) {
+    GPoint a = path->points[i];
+    GPoint b = path->points[(i + 1) % path->numPoints];
+
+    strokeLine(ctx, a.x + path->offset.x, a.y + path->offset.y,
+               b.x + path->offset.x, b.y + path->offset.y, ctx->strokeWidth, ctx->strokeColor);
+  }
+}
+
+/********** text **********/
+
+/*
+ * The system fonts aren't available on the host, so text is drawn with a
+ * small 3x5 pixel font scaled to roughly the cap height of the real one.
+ * Good enough to see where text goes and how much of it there is.
+ */
+struct GFontInfo {
+  int size;
+  int scale;
+};
+
+static struct GFontInfo systemFonts[] = {
+  {14, 2}, {18, 2}, {24, 3}, {28, 3}
+};
+
+GFont fonts_get_system_font(const char* font_key) {
+  int size = 14;
+  const char* digits = strpbrk(font_key, "0123456789");
+
+  if(digits) {
+    size = atoi(digits);
+  }
+
+  for(size_t i = 0; i < ARRAY_LENGTH(systemFonts); i++) {
+    if(systemFonts[i].size >= size) {
+      return &systemFonts[i];
+    }
+  }
+
+  return &systemFonts[ARRAY_LENGTH(systemFonts) - 1];
+}
+
+// each glyph is 5 rows of 3 bits, most significant bit on the left
+static uint16_t glyphBits(char c) {
+  static const uint16_t digits[10] = {
+    0x7b6f, 0x2c97, 0x73e7, 0x73cf, 0x5bc9, 0x79cf, 0x79ef, 0x7252, 0x7bef, 0x7bcf
+  };
+
+  static const uint16_t letters[26] = {
+    0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4, 0x396b, 0x5bed, 0x7497, 0x126a,
+    0x5bad, 0x4927, 0x5fed, 0x6b6d, 0x2b6a, 0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492,
+    0x5b6f, 0x5b6a, 0x5bfd, 0x5aad, 0x5a92, 0x72a7
+  };
+
+  if(c >= '0' && c <= '9') {
+    return digits[c - '0'];
+  }
+
+  if(c >= 'a' && c <= 'z') {
+    c -= 'a' - 'A';
+  }
+
+  if(c >= 'A' && c <= 'Z') {
+    return letters[c - 'A'];
+  }
+
+  switch(c) {
+    case ' ':  return 0x0000;
+    case '.':  return 0x0002;
+    case ',':  return 0x0014;
+    case ':':  return 0x0410;
+    case '-':  return 0x01c0;
+    case '+':  return 0x05d0;
+    case '/':  return 0x12a4;
+    case '%':  return 0x52a5;
+    case '\'': return 0x2400;
+    default:   return 0x7fff; // unknown characters draw as a block
+  }
+}
+
+static int glyphAdvance(GFont font) {
+  return 4 * font->scale;
+}
+
+static int measureLine(GFont font, const char* text, int length) {
+  int width = 0;
+
+  for(int i = 0; i < length; i++) {
+    // multi-byte characters only take one glyph
+    if(((uint8_t)text[i] & 0xc0) != 0x80) {
+      width += glyphAdvance(font);
+    }
+  }
+
+  return (width > 0) ? width - font->scale : 0;
+}
+
+static void drawLine(GContext* ctx, GFont font, const char* text, int length, int x, int y) {
+  for(int i = 0; i < length; i++) {
+    if(((uint8_t)text[i] & 0xc0) == 0x80) {
+      continue;
+    }
+
+    uint16_t bits = ((uint8_t)text[i] & 0x80) ? glyphBits(0) : glyphBits(text[i]);
+
+    for(int row = 0; row < 5; row++) {
+      for(int col = 0; col < 3; col++) {
+        if(bits & (1 << (14 - row * 3 - col))) {
+          for(int sy = 0; sy < font->scale; sy++) {
+            for(int sx = 0; sx < font->scale; sx++) {
+              setPixel(ctx, x + col * font->scale + sx, y + row * font->scale + sy, ctx->textColor);
+            }
+          }
+        }
+      }
+    }
+
+    x += glyphAdvance(font);
+  }
+}
+
+void graphics_draw_text(GContext* ctx, const char* text, const GFont font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        void* text_attributes) {
+  host_counters.drawCalls++;
+
+  if(!text || !font) {
+    return;
+  }
+
+  GRect oldClip = ctx->clip;
+  GRect boxOnScreen = GRect(ctx->origin.x + box.origin.x, ctx->origin.y + box.origin.y, box.size.w, box.size.h);
+  ctx->clip = intersectRects(oldClip, boxOnScreen);
+
+  // the real fonts have about a third of their size above the cap height
+  int y = box.origin.y + font->size / 3;
+  const char* lineStart = text;
+
+  while(*lineStart) {
+    // break at newlines, or at the last space that still fits
+    int length = 0;
+    int lastSpace = -1;
+
+    while(lineStart[length] && lineStart[length] != '\n') {
+      if(lineStart[length] == ' ') {
+        lastSpace = length;
+      }
+
+      if(overflow_mode == GTextOverflowModeWordWrap && lastSpace > 0 &&
+         measureLine(font, lineStart, length + 1) > box.size.w) {
+        length = lastSpace;
+        break;
+      }
+
+      length++;
+    }
+
+    int width = measureLine(font, lineStart, length);
+    int x = box.origin.x;
+
+    if(alignment == GTextAlignmentCenter) {
+      x += (box.size.w - width) / 2;
+    } else if(alignment == GTextAlignmentRight) {
+      x += box.size.w - width;
+    }
+
+    drawLine(ctx, font, lineStart, length, x, y);
+
+    lineStart += length;
+
+    if(*lineStart == '\n' || *lineStart == ' ') {
+      lineStart++;
+    }
+
+    y += font->size;
+  }
+
+  ctx->clip = oldClip;
+}
+
+/********** draw commands (PDC) **********/
+
+typedef enum {
+  GDrawCommandTypeInvalid = 0,
+  GDrawCommandTypePath,
+  GDrawCommandTypeCircle,
+  GDrawCommandTypePrecisePath,
+} GDrawCommandType;
+
+struct GDrawCommand {
+  GDrawCommandType type;
+  bool hidden;
+  GColor strokeColor;
+  uint8_t strokeWidth;
+  GColor fillColor;
+  bool pathOpen;
+  uint16_t radius;
+  uint16_t numPoints;
+  int16_t* points;
+};
+
+struct GDrawCommandList {
+  uint16_t numCommands;
+  GDrawCommand* commands;
+};
+
+struct GDrawCommandImage {
+  GSize viewBox;
+  GDrawCommandList commandList;
+};
+
+static uint16_t readU16(const uint8_t* data) {
+  return data[0] | (data[1] << 8);
+}
+
+GDrawCommandImage* gdraw_command_image_create_with_resource(uint32_t resource_id) {
+  size_t size;
+  uint8_t* data = readResource(resource_id, &size);
+
+  if(!data) {
+    return NULL;
+  }
+
+  if(size < 16 || memcmp(data, "PDCI", 4) != 0) {
+    free(data);
+    return NULL;
+  }
+
+  host_counters.resourceLoads++;
+
+  GDrawCommandImage* image = calloc(1, sizeof(GDrawCommandImage));
+  image->viewBox = GSize((int16_t)readU16(data + 10), (int16_t)readU16(data + 12));
+
+  GDrawCommandList* list = &image->commandList;
+  list->numCommands = readU16(data + 14);
+  list->commands = calloc(list->numCommands, sizeof(GDrawCommand));
+
+  const uint8_t* cursor = data + 16;
+
+  for(int i = 0; i < list->numCommands && cursor + 9 <= data + size; i++) {
+    GDrawCommand* command = &list->commands[i];
+
+    command->type = cursor[0];
+    command->hidden = cursor[1] & 1;
+    command->strokeColor.argb = cursor[2];
+    command->strokeWidth = cursor[3];
+    command->fillColor.argb = cursor[4];
+
+    if(command->type == GDrawCommandTypeCircle) {
+      command->radius = readU16(cursor + 5);
+    } else {
+      command->pathOpen = readU16(cursor + 5) & 1;
+    }
+
+    command->numPoints = readU16(cursor + 7);
+    cursor += 9;
+
+    command->points = malloc(command->numPoints * 2 * sizeof(int16_t));
+
+    for(int p = 0; p < command->numPoints * 2; p++) {
+      command->points[p] = (int16_t)readU16(cursor);
+      cursor += 2;
+    }
+  }
+
+  free(data);
+
+  return image;
+}
+
+void gdraw_command_image_destroy(GDrawCommandImage* image) {
+  if(!image) {
+    return;
+  }
+
+  for(int i = 0; i < image->commandList.numCommands; i++) {
+    free(image->commandList.commands[i].points);
+  }
+
+  free(image->commandList.commands);
+  free(image);
+}
+
+GSize gdraw_command_image_get_bounds_size(GDrawCommandImage* image) {
+  return image->viewBox;
+}
+
+GDrawCommandList* gdraw_command_image_get_command_list(GDrawCommandImage* image) {
+  return &image->commandList;
+}
+
+void gdraw_command_list_iterate(GDrawCommandList* command_list, GDrawCommandListIteratorCb handle_command, void* callback_context) {
+  for(uint32_t i = 0; i < command_list->numCommands; i++) {
+    if(!handle_command(&command_list->commands[i], i, callback_context)) {
+      break;
+    }
+  }
+}
+
+void gdraw_command_set_fill_color(GDrawCommand* command, GColor fill_color) {
+  command->fillColor = fill_color;
+}
+
+void gdraw_command_set_stroke_color(GDrawCommand* command, GColor stroke_color) {
+  command->strokeColor = stroke_color;
+}
+
+static void drawCommand(GContext* ctx, GDrawCommand* command, GPoint offset) {
+  if(command->hidden || command->numPoints == 0) {
+    return;
+  }
+
+  // precise paths use 13.3 fixed point coordinates
+  double scale = (command->type == GDrawCommandTypePrecisePath) ? 1.0 / 8 : 1.0;
+  double* xs = malloc(command->numPoints * sizeof(double));
+  double* ys = malloc(command->numPoints * sizeof(double));
+
+  for(int i = 0; i < command->numPoints; i++) {
+    xs[i] = offset.x + command->points[i * 2] * scale;
+    ys[i] = offset.y + command->points[i * 2 + 1] * scale;
+  }
+
+  if(command->type == GDrawCommandTypeCircle) {
+    for(int i = 0; i < command->numPoints; i++) {
+      fillCircle(ctx, xs[i], ys[i], command->radius, command->fillColor);
+
+      if(command->strokeWidth > 0) {
+        for(int step = 0; step < 64; step++) {
+          double a0 = step * 2 * M_PI / 64, a1 = (step + 1) * 2 * M_PI / 64;
+          strokeLine(ctx, xs[i] + cos(a0) * command->radius, ys[i] + sin(a0) * command->radius,
+                     xs[i] + cos(a1) * command->radius, ys[i] + sin(a1) * command->radius,
+                     command->strokeWidth, command->strokeColor);
+        }
+      }
+    }
+  } else {
+    if(!command->pathOpen) {
+      fillPolygon(ctx, xs, ys, command->numPoints, command->fillColor);
+    }
+
+    if(command->strokeWidth > 0) {
+      int segments = command->pathOpen ? command->numPoints - 1 : command->numPoints;
+
+      for(int i = 0; i < segments; i++) {
+        int j = (i + 1) % command->numPoints;
+        strokeLine(ctx, xs[i], ys[i], xs[j], ys[j], command->strokeWidth, command->strokeColor);
+      }
+    }
+  }
+
+  free(xs);
+  free(ys);
+}
+
+void gdraw_command_image_draw(GContext* ctx, GDrawCommandImage* image, GPoint offset) {
+  if(!image) {
+    return;
+  }
+
+  host_counters.drawCalls++;
+
+  for(int i = 0; i < image->commandList.numCommands; i++) {
+    drawCommand(ctx, &image->commandList.commands[i], offset);
+  }
+}
+
+/********** layers and windows **********/
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  bool hidden;
+  LayerUpdateProc updateProc;
+  Layer* parent;
+  Layer* firstChild;
+  Layer* nextSibling;
+  void* data;
+};
+
+struct BitmapLayer {
+  // must come first, the face casts BitmapLayer pointers to Layer pointers
+  Layer layer;
+  const GBitmap* bitmap;
+  GCompOp compOp;
+};
+
+struct Window {
+  Layer* rootLayer;
+  WindowHandlers handlers;
+  GColor backgroundColor;
+  bool isLoaded;
+};
+
+static Window* topWindow;
+static bool needsRender;
+
+static void initLayer(Layer* layer, GRect frame) {
+  memset(layer, 0, sizeof(Layer));
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+}
+
+Layer* layer_create(GRect frame) {
+  Layer* layer = malloc(sizeof(Layer));
+  initLayer(layer, frame);
+  return layer;
+}
+
+Layer* layer_create_with_data(GRect frame, size_t data_size) {
+  Layer* layer = layer_create(frame);
+  layer->data = calloc(1, data_size);
+  return layer;
+}
+
+void layer_remove_from_parent(Layer* child) {
+  if(!child->parent) {
+    return;
+  }
+
+  Layer** link = &child->parent->firstChild;
+
+  while(*link && *link != child) {
+    link = &(*link)->nextSibling;
+  }
+
+  if(*link) {
+    *link = child->nextSibling;
+  }
+
+  child->parent = NULL;
+  child->nextSibling = NULL;
+  needsRender = true;
+}
+
+static void detachLayer(Layer* layer) {
+  layer_remove_from_parent(layer);
+
+  while(layer->firstChild) {
+    layer_remove_from_parent(layer->firstChild);
+  }
+}
+
+void layer_destroy(Layer* layer) {
+  if(!layer) {
+    return;
+  }
+
+  detachLayer(layer);
+  free(layer->data);
+  free(layer);
+}
+
+void* layer_get_data(const Layer* layer) {
+  return layer->data;
+}
+
+void layer_mark_dirty(Layer* layer) {
+  host_counters.dirtyMarks++;
+  needsRender = true;
+}
+
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update_proc) {
+  layer->updateProc = update_proc;
+}
+
+void layer_set_frame(Layer* layer, GRect frame) {
+  if(!grect_equal(&layer->frame, &frame)) {
+    layer->frame = frame;
+    layer->bounds.size = frame.size;
+    needsRender = true;
+  }
+}
+
+GRect layer_get_frame(const Layer* layer) {
+  return layer->frame;
+}
+
+void layer_set_bounds(Layer* layer, GRect bounds) {
+  layer->bounds = bounds;
+  needsRender = true;
+}
+
+GRect layer_get_bounds(const Layer* layer) {
+  return layer->bounds;
+}
+
+void layer_add_child(Layer* parent, Layer* child) {
+  layer_remove_from_parent(child);
+
+  Layer** link = &parent->firstChild;
+
+  while(*link) {
+    link = &(*link)->nextSibling;
+  }
+
+  *link = child;
+  child->parent = parent;
+  needsRender = true;
+}
+
+void layer_set_hidden(Layer* layer, bool hidden) {
+  if(layer->hidden != hidden) {
+    layer->hidden = hidden;
+    needsRender = true;
+  }
+}
+
+bool layer_get_hidden(const Layer* layer) {
+  return layer->hidden;
+}
+
+Window* window_create() {
+  Window* window = calloc(1, sizeof(Window));
+  GRect screen = GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT);
+
+  window->rootLayer = layer_create(screen);
+  window->backgroundColor = GColorWhite;
+
+  return window;
+}
+
+void window_destroy(Window* window) {
+  if(!window) {
+    return;
+  }
+
+  if(window->isLoaded && window->handlers.unload) {
+    window->handlers.unload(window);
+  }
+
+  if(topWindow == window) {
+    topWindow = NULL;
+  }
+
+  layer_destroy(window->rootLayer);
+  free(window);
+}
+
+void window_set_window_handlers(Window* window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+Layer* window_get_root_layer(const Window* window) {
+  return window->rootLayer;
+}
+
+void window_set_background_color(Window* window, GColor background_color) {
+  window->backgroundColor = background_color;
+  needsRender = true;
+}
+
+void window_stack_push(Window* window, bool animated) {
+  topWindow = window;
+
+  if(!window->isLoaded) {
+    window->isLoaded = true;
+
+    if(window->handlers.load) {
+      window->handlers.load(window);
+    }
+  }
+
+  if(window->handlers.appear) {
+    window->handlers.appear(window);
+  }
+
+  needsRender = true;
+}
+
+static void bitmapLayerUpdate(Layer* layer, GContext* ctx) {
+  BitmapLayer* bitmapLayer = (BitmapLayer*)layer;
+
+  if(!bitmapLayer->bitmap) {
+    return;
+  }
+
+  // bitmaps are centered in their layer by default
+  GRect bounds = layer_get_bounds(layer);
+  GSize size = bitmapLayer->bitmap->bounds.size;
+  GRect rect = GRect((bounds.size.w - size.w) / 2, (bounds.size.h - size.h) / 2, size.w, size.h);
+
+  graphics_context_set_compositing_mode(ctx, bitmapLayer->compOp);
+  graphics_draw_bitmap_in_rect(ctx, bitmapLayer->bitmap, rect);
+}
+
+BitmapLayer* bitmap_layer_create(GRect frame) {
+  BitmapLayer* bitmapLayer = calloc(1, sizeof(BitmapLayer));
+
+  initLayer(&bitmapLayer->layer, frame);
+  bitmapLayer->layer.updateProc = bitmapLayerUpdate;
+  bitmapLayer->compOp = GCompOpAssign;
+
+  return bitmapLayer;
+}
+
+void bitmap_layer_destroy(BitmapLayer* bitmap_layer) {
+  if(bitmap_layer) {
+    detachLayer(&bitmap_layer->layer);
+    free(bitmap_layer);
+  }
+}
+
+Layer* bitmap_layer_get_layer(const BitmapLayer* bitmap_layer) {
+  return (Layer*)&bitmap_layer->layer;
+}
+
+void bitmap_layer_set_bitmap(BitmapLayer* bitmap_layer, const GBitmap* bitmap) {
+  bitmap_layer->bitmap = bitmap;
+  layer_mark_dirty(&bitmap_layer->layer);
+}
+
+void bitmap_layer_set_compositing_mode(BitmapLayer* bitmap_layer, GCompOp mode) {
+  bitmap_layer->compOp = mode;
+  layer_mark_dirty(&bitmap_layer->layer);
+}
+
+/********** rendering **********/
+
+static GBitmap* frameBuffer;
+
+static GBitmap* createFrameBuffer() {
+  #if defined(PBL_ROUND)
+    GBitmap* bitmap = createBitmap(GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), GBitmapFormat8BitCircular);
+
+    // only the pixels inside the circle exist on the round display
+    bitmap->rowMinX = malloc(PBL_DISPLAY_HEIGHT * sizeof(int16_t));
+    bitmap->rowMaxX = malloc(PBL_DISPLAY_HEIGHT * sizeof(int16_t));
+
+    double radius = PBL_DISPLAY_WIDTH / 2.0;
+
+    for(int y = 0; y < PBL_DISPLAY_HEIGHT; y++) {
+      double dy = y + 0.5 - radius;
+      double halfWidth = sqrt(radius * radius - dy * dy);
+
+      bitmap->rowMinX[y] = (int16_t)floor(radius - halfWidth + 0.5);
+      bitmap->rowMaxX[y] = (int16_t)(PBL_DISPLAY_WIDTH - 1 - bitmap->rowMinX[y]);
+    }
+
+    return bitmap;
+  #elif defined(PBL_COLOR)
+    return createBitmap(GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), GBitmapFormat8Bit);
+  #else
+    return createBitmap(GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), GBitmapFormat1Bit);
+  #endif
+}
+
+static void renderLayer(Layer* layer, GPoint parentOrigin, GRect parentClip) {
+  if(layer->hidden) {
+    return;
+  }
+
+  GPoint frameOrigin = GPoint(parentOrigin.x + layer->frame.origin.x, parentOrigin.y + layer->frame.origin.y);
+  GRect frameOnScreen = GRect(frameOrigin.x, frameOrigin.y, layer->frame.size.w, layer->frame.size.h);
+  GRect clip = intersectRects(parentClip, frameOnScreen);
+  GPoint boundsOrigin = GPoint(frameOrigin.x + layer->bounds.origin.x, frameOrigin.y + layer->bounds.origin.y);
+
+  if(layer->updateProc) {
+    context.origin = boundsOrigin;
+    context.clip = clip;
+    context.strokeColor = GColorBlack;
+    context.fillColor = GColorBlack;
+    context.textColor = GColorBlack;
+    context.compOp = GCompOpAssign;
+    context.strokeWidth = 1;
+    context.antialiased = true;
+
+    host_counters.layerRenders++;
+    layer->updateProc(layer, &context);
+  }
+
+  for(Layer* child = layer->firstChild; child; child = child->nextSibling) {
+    renderLayer(child, boundsOrigin, clip);
+  }
+}
+
+bool host_render_frame() {
+  if(!needsRender || !topWindow) {
+    return false;
+  }
+
+  needsRender = false;
+  host_counters.frames++;
+
+  if(!frameBuffer) {
+    frameBuffer = createFrameBuffer();
+  }
+
+  context.frameBuffer = frameBuffer;
+  context.origin = GPointZero;
+  context.clip = frameBuffer->bounds;
+
+  // the window's background is filled in before any layers are drawn
+  context.fillColor = topWindow->backgroundColor;
+  graphics_fill_rect(&context, frameBuffer->bounds, 0, GCornerNone);
+
+  renderLayer(topWindow->rootLayer, GPointZero, frameBuffer->bounds);
+
+  return true;
+}
+
+GBitmap* host_get_frame_buffer() {
+  if(!frameBuffer) {
+    frameBuffer = createFrameBuffer();
+  }
+
+  return frameBuffer;
+}
+
+GColor host_get_pixel(int x, int y) {
+  GBitmap* bitmap = host_get_frame_buffer();
+
+  if(bitmap->rowMinX && (x < bitmap->rowMinX[y] || x > bitmap->rowMaxX[y])) {
+    return GColorBlack;
+  }
+
+  return bitmapGetPixel(bitmap, x, y);
+}
+
+static void writePngChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length) {
+  uint8_t header[8] = {
+    length >> 24, length >> 16, length >> 8, length,
+    type[0], type[1], type[2], type[3]
+  };
+
+  uLong crc = crc32(0, header + 4, 4);
+  crc = crc32(crc, data, length);
+
+  uint8_t footer[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+
+  fwrite(header, 1, 8, file);
+
+  if(length > 0) {
+    fwrite(data, 1, length, file);
+  }
+
+  fwrite(footer, 1, 4, file);
+}
+
+bool host_write_png(const char* path) {
+  FILE* file = fopen(path, "wb");
+
+  if(!file) {
+    return false;
+  }
+
+  int width = PBL_DISPLAY_WIDTH;
+  int height = PBL_DISPLAY_HEIGHT;
+
+  // every row starts with filter type 0, followed by RGB triplets
+  size_t rawSize = height * (1 + width * 3);
+  uint8_t* raw = malloc(rawSize);
+  uint8_t* cursor = raw;
+
+  for(int y = 0; y < height; y++) {
+    *cursor++ = 0;
+
+    for(int x = 0; x < width; x++) {
+      GColor color = host_get_pixel(x, y);
+      *cursor++ = color.r * 85;
+      *cursor++ = color.g * 85;
+      *cursor++ = color.b * 85;
+    }
+  }
+
+  uLongf compressedSize = compressBound(rawSize);
+  uint8_t* compressed = malloc(compressedSize);
+  compress2(compressed, &compressedSize, raw, rawSize, 9);
+
+  uint8_t header[13] = {
+    0, 0, width >> 8, width, 0, 0, height >> 8, height,
+    8, 2, 0, 0, 0
+  };
+
+  fwrite("\x89PNG\r\n\x1a\n", 1, 8, file);
+  writePngChunk(file, "IHDR", header, sizeof(header));
+  writePngChunk(file, "IDAT", compressed, compressedSize);
+  writePngChunk(file, "IEND", NULL, 0);
+
+  free(raw);
+  free(compressed);
+
+  return fclose(file) == 0;
+}
+
+/********** event services **********/
+
+static TickHandler tickHandler;
+static TimeUnits tickUnits;
+
+static BatteryChargeState batteryState;
+static BatteryStateHandler batteryHandler;
+
+static bool bluetoothConnected;
+static BluetoothConnectionHandler bluetoothHandler;
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+  tickUnits = tick_units;
+  tickHandler = handler;
+}
+
+void tick_timer_service_unsubscribe() {
+  tickHandler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek() {
+  return batteryState;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  batteryHandler = handler;
+}
+
+void battery_state_service_unsubscribe() {
+  batteryHandler = NULL;
+}
+
+void host_set_battery(uint8_t percent, bool isCharging) {
+  batteryState.charge_percent = percent;
+  batteryState.is_charging = isCharging;
+  batteryState.is_plugged = isCharging;
+
+  if(batteryHandler) {
+    host_counters.wakeups++;
+    batteryHandler(batteryState);
+    host_render_frame();
+  }
+}
+
+bool bluetooth_connection_service_peek() {
+  return bluetoothConnected;
+}
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler) {
+  bluetoothHandler = handler;
+}
+
+void bluetooth_connection_service_unsubscribe() {
+  bluetoothHandler = NULL;
+}
+
+void host_set_bluetooth(bool isConnected) {
+  bluetoothConnected = isConnected;
+
+  if(bluetoothHandler) {
+    host_counters.wakeups++;
+    bluetoothHandler(isConnected);
+    host_render_frame();
+  }
+}
+
+static void countVibe(uint32_t milliseconds) {
+  host_counters.vibes++;
+  host_counters.vibeMilliseconds += milliseconds;
+}
+
+void vibes_short_pulse() {
+  countVibe(100);
+}
+
+void vibes_long_pulse() {
+  countVibe(500);
+}
+
+void vibes_double_pulse() {
+  countVibe(200);
+}
+
+void vibes_enqueue_custom_pattern(VibePattern pattern) {
+  uint32_t milliseconds = 0;
+
+  // even segments are on, odd segments are off
+  for(uint32_t i = 0; i < pattern.num_segments; i += 2) {
+    milliseconds += pattern.durations[i];
+  }
+
+  countVibe(milliseconds);
+}
+
+void vibes_cancel() {
+}
+
+/********** app timers **********/
+
+struct AppTimer {
+  int64_t dueMs;
+  AppTimerCallback callback;
+  void* data;
+  AppTimer* next;
+};
+
+static AppTimer* timers;
+
+static bool timerIsRegistered(AppTimer* timer) {
+  for(AppTimer* t = timers; t; t = t->next) {
+    if(t == timer) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void unlinkTimer(AppTimer* timer) {
+  AppTimer** link = &timers;
+
+  while(*link && *link != timer) {
+    link = &(*link)->next;
+  }
+
+  if(*link) {
+    *link = timer->next;
+  }
+}
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void* callback_data) {
+  AppTimer* timer = calloc(1, sizeof(AppTimer));
+
+  timer->dueMs = nowMs + timeout_ms;
+  timer->callback = callback;
+  timer->data = callback_data;
+  timer->next = timers;
+  timers = timer;
+
+  return timer;
+}
+
+bool app_timer_reschedule(AppTimer* timer_handle, uint32_t new_timeout_ms) {
+  if(!timerIsRegistered(timer_handle)) {
+    return false;
+  }
+
+  timer_handle->dueMs = nowMs + new_timeout_ms;
+  return true;
+}
+
+void app_timer_cancel(AppTimer* timer_handle) {
+  if(timerIsRegistered(timer_handle)) {
+    unlinkTimer(timer_handle);
+    free(timer_handle);
+  }
+}
+
+static AppTimer* nextDueTimer() {
+  AppTimer* next = NULL;
+
+  for(AppTimer* t = timers; t; t = t->next) {
+    if(!next || t->dueMs < next->dueMs) {
+      next = t;
+    }
+  }
+
+  return next;
+}
+
+static int64_t nextTickMs() {
+  int64_t period = (tickUnits & SECOND_UNIT) ? 1000 : (tickUnits & MINUTE_UNIT) ? 60000 :
+                   (tickUnits & HOUR_UNIT) ? 3600000 : 86400000;
+  return (nowMs / period + 1) * period;
+}
+
+static TimeUnits changedUnits(const struct tm* before, const struct tm* after) {
+  TimeUnits units = 0;
+
+  if(before->tm_sec != after->tm_sec) units |= SECOND_UNIT;
+  if(before->tm_min != after->tm_min) units |= MINUTE_UNIT;
+  if(before->tm_hour != after->tm_hour) units |= HOUR_UNIT;
+  if(before->tm_mday != after->tm_mday) units |= DAY_UNIT;
+  if(before->tm_mon != after->tm_mon) units |= MONTH_UNIT;
+  if(before->tm_year != after->tm_year) units |= YEAR_UNIT;
+
+  return units;
+}
+
+void host_set_time(time_t t) {
+  nowMs = (int64_t)t * 1000;
+}
+
+void host_advance_time(uint32_t ms) {
+  int64_t endMs = nowMs + ms;
+
+  while(true) {
+    AppTimer* timer = nextDueTimer();
+    int64_t tickMs = tickHandler ? nextTickMs() : INT64_MAX;
+    int64_t timerMs = timer ? timer->dueMs : INT64_MAX;
+    int64_t eventMs = (timerMs <= tickMs) ? timerMs : tickMs;
+
+    if(eventMs > endMs) {
+      break;
+    }
+
+    time_t before = host_time(NULL);
+    struct tm beforeInfo;
+    gmtime_r(&before, &beforeInfo);
+
+    if(eventMs > nowMs) {
+      nowMs = eventMs;
+    }
+
+    host_counters.wakeups++;
+
+    if(timerMs <= tickMs) {
+      unlinkTimer(timer);
+      timer->callback(timer->data);
+      free(timer);
+    } else {
+      time_t now = host_time(NULL);
+      struct tm tickInfo;
+      gmtime_r(&now, &tickInfo);
+
+      host_counters.ticks++;
+      tickHandler(&tickInfo, changedUnits(&beforeInfo, &tickInfo));
+    }
+
+    host_render_frame();
+  }
+
+  nowMs = endMs;
+}
+
+void app_event_loop() {
+  // the host drives events itself; just show the first frame
+  host_render_frame();
+}
+
+/********** persistent storage **********/
+
+typedef struct PersistEntry {
+  uint32_t key;
+  int size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+  struct PersistEntry* next;
+} PersistEntry;
+
+static PersistEntry* persistEntries;
+
+static PersistEntry* findPersistEntry(uint32_t key) {
+  for(PersistEntry* entry = persistEntries; entry; entry = entry->next) {
+    if(entry->key == key) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+static int writePersistEntry(uint32_t key, const void* data, size_t size) {
+  if(size > PERSIST_DATA_MAX_LENGTH) {
+    size = PERSIST_DATA_MAX_LENGTH;
+  }
+
+  PersistEntry* entry = findPersistEntry(key);
+
+  if(!entry) {
+    entry = calloc(1, sizeof(PersistEntry));
+    entry->key = key;
+    entry->next = persistEntries;
+    persistEntries = entry;
+  }
+
+  memcpy(entry->data, data, size);
+  entry->size = size;
+
+  host_counters.persistWrites++;
+  host_counters.persistBytesWritten += size;
+
+  return size;
+}
+
+bool persist_exists(const uint32_t key) {
+  return findPersistEntry(key) != NULL;
+}
+
+int persist_get_size(const uint32_t key) {
+  PersistEntry* entry = findPersistEntry(key);
+  return entry ? entry->size : E_DOES_NOT_EXIST;
+}
+
+bool persist_read_bool(const uint32_t key) {
+  PersistEntry* entry = findPersistEntry(key);
+  return entry ? entry->data[0] != 0 : false;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  PersistEntry* entry = findPersistEntry(key);
+  int32_t value = 0;
+
+  if(entry) {
+    memcpy(&value, entry->data, (entry->size < 4) ? entry->size : 4);
+  }
+
+  return value;
+}
+
+int persist_read_data(const uint32_t key, void* buffer, const size_t buffer_size) {
+  PersistEntry* entry = findPersistEntry(key);
+
+  if(!entry) {
+    return E_DOES_NOT_EXIST;
+  }
+
+  int size = ((size_t)entry->size < buffer_size) ? entry->size : (int)buffer_size;
+  memcpy(buffer, entry->data, size);
+
+  return size;
+}
+
+int persist_read_string(const uint32_t key, char* buffer, const size_t buffer_size) {
+  PersistEntry* entry = findPersistEntry(key);
+
+  if(!entry || buffer_size == 0) {
+    return E_DOES_NOT_EXIST;
+  }
+
+  size_t size = ((size_t)entry->size < buffer_size) ? (size_t)entry->size : buffer_size;
+  memcpy(buffer, entry->data, size);
+  buffer[size - 1] = '\0';
+
+  return size;
+}
+
+int persist_write_bool(const uint32_t key, const bool value) {
+  uint8_t byte = value;
+  return writePersistEntry(key, &byte, 1);
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+  return writePersistEntry(key, &value, sizeof(value));
+}
+
+int persist_write_data(const uint32_t key, const void* data, const size_t size) {
+  return writePersistEntry(key, data, size);
+}
+
+int persist_write_string(const uint32_t key, const char* cstring) {
+  return writePersistEntry(key, cstring, strlen(cstring) + 1);
+}
+
+int persist_delete(const uint32_t key) {
+  PersistEntry** link = &persistEntries;
+
+  while(*link && (*link)->key != key) {
+    link = &(*link)->next;
+  }
+
+  if(!*link) {
+    return E_DOES_NOT_EXIST;
+  }
+
+  PersistEntry* entry = *link;
+  *link = entry->next;
+  free(entry);
+
+  return S_SUCCESS;
+}
+
+/********** dictionaries and app messages **********/
+
+// a dictionary is a count byte followed by its tuples
+#define TUPLE_HEADER_SIZE 7
+
+DictionaryResult dict_write_begin(DictionaryIterator* iter, uint8_t* const buffer, const uint16_t size) {
+  if(!iter || !buffer || size < 1) {
+    return DICT_INVALID_ARGS;
+  }
+
+  buffer[0] = 0;
+  iter->begin = buffer;
+  iter->end = buffer + size;
+  iter->cursor = (Tuple*)(buffer + 1);
+
+  return DICT_OK;
+}
+
+uint32_t dict_write_end(DictionaryIterator* iter) {
+  uint32_t size = (uint8_t*)iter->cursor - iter->begin;
+
+  iter->end = (uint8_t*)iter->cursor;
+  iter->cursor = (Tuple*)(iter->begin + 1);
+
+  return size;
+}
+
+static DictionaryResult writeTuple(DictionaryIterator* iter, uint32_t key, TupleType type,
+                                   const void* data, uint16_t length) {
+  if(!iter || !iter->cursor) {
+    return DICT_INVALID_ARGS;
+  }
+
+  if((uint8_t*)iter->cursor + TUPLE_HEADER_SIZE + length > iter->end) {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+
+  Tuple* tuple = iter->cursor;
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  memcpy(tuple->value->data, data, length);
+
+  iter->begin[0]++;
+  iter->cursor = (Tuple*)((uint8_t*)tuple + TUPLE_HEADER_SIZE + length);
+
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator* iter, const uint32_t key, const uint8_t* data, const uint16_t size) {
+  return writeTuple(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_cstring(DictionaryIterator* iter, const uint32_t key, const char* cstring) {
+  return writeTuple(iter, key, TUPLE_CSTRING, cstring, cstring ? strlen(cstring) + 1 : 0);
+}
+
+DictionaryResult dict_write_int(DictionaryIterator* iter, const uint32_t key, const void* integer, const uint8_t width_bytes, const bool is_signed) {
+  if(width_bytes != 1 && width_bytes != 2 && width_bytes != 4) {
+    return DICT_INVALID_ARGS;
+  }
+
+  return writeTuple(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator* iter, const uint32_t key, const uint8_t value) {
+  return dict_write_int(iter, key, &value, 1, false);
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator* iter, const uint32_t key, const uint16_t value) {
+  return dict_write_int(iter, key, &value, 2, false);
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator* iter, const uint32_t key, const uint32_t value) {
+  return dict_write_int(iter, key, &value, 4, false);
+}
+
+DictionaryResult dict_write_int8(DictionaryIterator* iter, const uint32_t key, const int8_t value) {
+  return dict_write_int(iter, key, &value, 1, true);
+}
+
+DictionaryResult dict_write_int16(DictionaryIterator* iter, const uint32_t key, const int16_t value) {
+  return dict_write_int(iter, key, &value, 2, true);
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator* iter, const uint32_t key, const int32_t value) {
+  return dict_write_int(iter, key, &value, 4, true);
+}
+
+Tuple* dict_read_first(DictionaryIterator* iter) {
+  iter->cursor = (Tuple*)(iter->begin + 1);
+  return dict_read_next(iter);
+}
+
+Tuple* dict_read_next(DictionaryIterator* iter) {
+  uint8_t* position = (uint8_t*)iter->cursor;
+
+  if(position + TUPLE_HEADER_SIZE > iter->end) {
+    return NULL;
+  }
+
+  Tuple* tuple = iter->cursor;
+
+  if(position + TUPLE_HEADER_SIZE + tuple->length > iter->end) {
+    return NULL;
+  }
+
+  iter->cursor = (Tuple*)(position + TUPLE_HEADER_SIZE + tuple->length);
+
+  return tuple;
+}
+
+Tuple* dict_find(const DictionaryIterator* iter, const uint32_t key) {
+  DictionaryIterator search = *iter;
+  int count = iter->begin[0];
+  Tuple* tuple = dict_read_first(&search);
+
+  for(int i = 0; i < count && tuple; i++) {
+    if(tuple->key == key) {
+      return tuple;
+    }
+
+    tuple = dict_read_next(&search);
+  }
+
+  return NULL;
+}
+
+static AppMessageInboxReceived inboxReceived;
+static AppMessageInboxDropped inboxDropped;
+static AppMessageOutboxSent outboxSent;
+static AppMessageOutboxFailed outboxFailed;
+
+static uint8_t outboxBuffer[APP_MESSAGE_OUTBOX_SIZE_MINIMUM];
+static uint32_t outboxSize;
+static uint32_t inboxSize;
+static DictionaryIterator outbox;
+static bool outboxBusy;
+static bool outboxPending;
+static AppMessageResult outboxResult;
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  inboxSize = size_inbound;
+  outboxSize = (size_outbound < sizeof(outboxBuffer)) ? size_outbound : sizeof(outboxBuffer);
+  return APP_MSG_OK;
+}
+
+void app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+  inboxReceived = received_callback;
+}
+
+void app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) {
+  inboxDropped = dropped_callback;
+}
+
+void app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  outboxSent = sent_callback;
+}
+
+void app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+  outboxFailed = failed_callback;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator) {
+  if(outboxBusy || outboxPending) {
+    return APP_MSG_BUSY;
+  }
+
+  dict_write_begin(&outbox, outboxBuffer, outboxSize);
+  outboxBusy = true;
+  *iterator = &outbox;
+
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send() {
+  if(!outboxBusy) {
+    return APP_MSG_INVALID_ARGS;
+  }
+
+  outboxBusy = false;
+
+  if(!bluetoothConnected) {
+    return APP_MSG_NOT_CONNECTED;
+  }
+
+  uint32_t size = dict_write_end(&outbox);
+
+  host_counters.messagesSent++;
+  host_counters.messageBytesSent += size;
+  outboxPending = true;
+
+  return APP_MSG_OK;
+}
+
+void host_set_outbox_result(AppMessageResult result) {
+  outboxResult = result;
+}
+
+bool host_deliver_outbox() {
+  if(!outboxPending) {
+    return false;
+  }
+
+  outboxPending = false;
+  host_counters.wakeups++;
+
+  if(outboxResult == APP_MSG_OK) {
+    if(outboxSent) {
+      outboxSent(&outbox, NULL);
+    }
+  } else if(outboxFailed) {
+    outboxFailed(&outbox, outboxResult, NULL);
+  }
+
+  host_render_frame();
+
+  return true;
+}
+
+DictionaryIterator* host_get_last_outbox() {
+  return &outbox;
+}
+
+void host_app_message_receive(DictionaryIterator* iter) {
+  uint32_t size = dict_write_end(iter);
+
+  host_counters.wakeups++;
+
+  if(size > inboxSize) {
+    if(inboxDropped) {
+      inboxDropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+    }
+
+    return;
+  }
+
+  host_counters.messagesReceived++;
+  host_counters.messageBytesReceived += size;
+
+  if(inboxReceived) {
+    inboxReceived(iter, NULL);
+  }
+
+  host_render_frame();
+}
+
+/********** health **********/
+
+#ifdef PBL_HEALTH
+
+static HealthValue healthMetrics[HealthMetricHeartRateBPM + 1];
+static HealthActivityMask healthActivities;
+static uint8_t healthMinuteSteps;
+static HealthEventHandler healthHandler;
+
+HealthValue health_service_sum_today(HealthMetric metric) {
+  host_counters.healthQueries++;
+  return healthMetrics[metric];
+}
+
+HealthValue health_service_sum(HealthMetric metric, time_t time_start, time_t time_end) {
+  host_counters.healthQueries++;
+
+  // assume the day's total was spread evenly over the day so far
+  time_t elapsed = host_time(NULL) - time_start_of_today();
+  time_t span = time_end - time_start;
+
+  if(elapsed <= 0 || span <= 0) {
+    return 0;
+  }
+
+  return (HealthValue)((int64_t)healthMetrics[metric] * ((span < elapsed) ? span : elapsed) / elapsed);
+}
+
+HealthActivityMask health_service_peek_current_activities() {
+  host_counters.healthQueries++;
+  return healthActivities;
+}
+
+void health_service_activities_iterate(HealthActivityMask activity_mask, time_t time_start, time_t time_end,
+                                       HealthIterationDirection direction, HealthActivityIteratorCB callback,
+                                       void* context) {
+  host_counters.healthQueries++;
+
+  // the current activities are reported as covering the whole range
+  for(HealthActivity activity = HealthActivitySleep; activity <= HealthActivityOpenWorkout; activity <<= 1) {
+    if((activity_mask & healthActivities & activity) && !callback(activity, time_start, time_end, context)) {
+      return;
+    }
+  }
+}
+
+uint32_t health_service_get_minute_history(HealthMinuteData* minute_data, uint32_t max_records,
+                                           time_t* time_start, time_t* time_end) {
+  host_counters.healthQueries++;
+
+  time_t now = host_time(NULL);
+
+  if(*time_end > now) {
+    *time_end = now;
+  }
+
+  if(*time_start >= *time_end) {
+    return 0;
+  }
+
+  uint32_t minutes = (*time_end - *time_start) / SECONDS_PER_MINUTE;
+  uint32_t count = (minutes < max_records) ? minutes : max_records;
+
+  for(uint32_t i = 0; i < count; i++) {
+    memset(&minute_data[i], 0, sizeof(HealthMinuteData));
+    minute_data[i].steps = healthMinuteSteps;
+  }
+
+  *time_end = *time_start + count * SECONDS_PER_MINUTE;
+
+  return count;
+}
+
+bool health_service_events_subscribe(HealthEventHandler handler, void* context) {
+  healthHandler = handler;
+  return true;
+}
+
+bool health_service_events_unsubscribe() {
+  healthHandler = NULL;
+  return true;
+}
+
+void host_set_health_metric(HealthMetric metric, HealthValue value) {
+  healthMetrics[metric] = value;
+}
+
+void host_set_health_activities(HealthActivityMask activities) {
+  HealthActivityMask oldActivities = healthActivities;
+  healthActivities = activities;
+
+  if(healthHandler && oldActivities != activities) {
+    host_counters.wakeups++;
+    healthHandler(HealthEventSleepUpdate, NULL);
+    host_render_frame();
+  }
+}
+
+void host_set_health_minute_steps(uint8_t steps) {
+  healthMinuteSteps = steps;
+}
+
+static void resetHealth() {
+  memset(healthMetrics, 0, sizeof(healthMetrics));
+  healthActivities = HealthActivityNone;
+  healthMinuteSteps = 0;
+  healthHandler = NULL;
+}
+
+#endif
+
+/********** reset **********/
+
+void host_reset_counters() {
+  memset(&host_counters, 0, sizeof(host_counters));
+}
+
+void host_reset() {
+  while(persistEntries) {
+    PersistEntry* next = persistEntries->next;
+    free(persistEntries);
+    persistEntries = next;
+  }
+
+  while(timers) {
+    AppTimer* next = timers->next;
+    free(timers);
+    timers = next;
+  }
+
+  tickHandler = NULL;
+  batteryHandler = NULL;
+  bluetoothHandler = NULL;
+  inboxReceived = NULL;
+  inboxDropped = NULL;
+  outboxSent = NULL;
+  outboxFailed = NULL;
+  outboxBusy = false;
+  outboxPending = false;
+  outboxResult = APP_MSG_OK;
+  outboxSize = sizeof(outboxBuffer);
+  inboxSize = APP_MESSAGE_INBOX_SIZE_MINIMUM;
+
+  #ifdef PBL_HEALTH
+    resetHealth();
+  #endif
+
+  host_set_time(HOST_DEFAULT_TIME);
+  is24hStyle = true;
+  quietTimeActive = false;
+  batteryState = (BatteryChargeState){.charge_percent = 60, .is_charging = false, .is_plugged = false};
+  bluetoothConnected = true;
+  topWindow = NULL;
+  needsRender = false;
+
+  if(frameBuffer) {
+    memset(frameBuffer->data, 0, frameBuffer->bytesPerRow * frameBuffer->bounds.size.h);
+  }
+
+  host_reset_counters();
+}
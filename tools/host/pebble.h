@@ -0,0 +1,641 @@
+#pragma once
+
+/*
+ * A host-side stand-in for the Pebble SDK, just complete enough to compile
+ * and run the watchface sources on a desktop machine. Drawing goes into a
+ * software framebuffer (see host.h), and every call that costs power on the
+ * watch is counted.
+ *
+ * Select the platform with -DPBL_PLATFORM_APLITE, -DPBL_PLATFORM_BASALT or
+ * -DPBL_PLATFORM_CHALK.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <locale.h>
+
+#if defined(PBL_PLATFORM_APLITE)
+  #define PBL_BW
+  #define PBL_RECT
+  #define PBL_DISPLAY_WIDTH  144
+  #define PBL_DISPLAY_HEIGHT 168
+#elif defined(PBL_PLATFORM_CHALK)
+  #define PBL_COLOR
+  #define PBL_ROUND
+  #define PBL_HEALTH
+  #define PBL_DISPLAY_WIDTH  180
+  #define PBL_DISPLAY_HEIGHT 180
+#else
+  #ifndef PBL_PLATFORM_BASALT
+    #define PBL_PLATFORM_BASALT
+  #endif
+  #define PBL_COLOR
+  #define PBL_RECT
+  #define PBL_HEALTH
+  #define PBL_DISPLAY_WIDTH  144
+  #define PBL_DISPLAY_HEIGHT 168
+#endif
+
+#ifdef PBL_ROUND
+  #define PBL_IF_ROUND_ELSE(a, b) (a)
+  #define PBL_IF_RECT_ELSE(a, b) (b)
+#else
+  #define PBL_IF_ROUND_ELSE(a, b) (b)
+  #define PBL_IF_RECT_ELSE(a, b) (a)
+#endif
+
+#ifdef PBL_COLOR
+  #define PBL_IF_COLOR_ELSE(a, b) (a)
+  #define PBL_IF_BW_ELSE(a, b) (b)
+#else
+  #define PBL_IF_COLOR_ELSE(a, b) (b)
+  #define PBL_IF_BW_ELSE(a, b) (a)
+#endif
+
+// generated by the host build from appinfo.json
+#include "resource_ids.auto.h"
+
+/********** status codes, logging, time **********/
+
+typedef enum {
+  S_SUCCESS = 0,
+  E_ERROR = -1,
+  E_UNKNOWN = -2,
+  E_INTERNAL = -3,
+  E_INVALID_ARGUMENT = -4,
+  E_OUT_OF_MEMORY = -5,
+  E_OUT_OF_STORAGE = -6,
+  E_OUT_OF_RESOURCES = -7,
+  E_RANGE = -8,
+  E_DOES_NOT_EXIST = -9,
+  E_INVALID_OPERATION = -10,
+  E_BUSY = -11,
+} StatusCode;
+
+typedef enum {
+  APP_LOG_LEVEL_ERROR         = 1,
+  APP_LOG_LEVEL_WARNING       = 50,
+  APP_LOG_LEVEL_INFO          = 100,
+  APP_LOG_LEVEL_DEBUG         = 200,
+  APP_LOG_LEVEL_DEBUG_VERBOSE = 255
+} AppLogLevel;
+
+int host_printf(const char* fmt, ...);
+#define APP_LOG(level, fmt, ...) host_printf(fmt "\n", ##__VA_ARGS__)
+#define printf host_printf
+
+// the face's clock comes from the host's simulated time, in UTC
+time_t host_time(time_t* t);
+struct tm* host_localtime(const time_t* t);
+#define time(t) host_time(t)
+#define localtime(t) host_localtime(t)
+
+#define SECONDS_PER_MINUTE 60
+#define MINUTES_PER_HOUR 60
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_DAY 86400
+
+#define ARRAY_LENGTH(array) (sizeof((array)) / sizeof((array)[0]))
+
+time_t time_start_of_today(void);
+uint16_t time_ms(time_t* tloc, uint16_t* out_ms);
+bool clock_is_24h_style(void);
+
+/********** colors and geometry **********/
+
+typedef union GColor8 {
+  uint8_t argb;
+  struct {
+    uint8_t b:2;
+    uint8_t g:2;
+    uint8_t r:2;
+    uint8_t a:2;
+  };
+} GColor8;
+
+typedef GColor8 GColor;
+
+#define GColorARGB8(a, r, g, b) ((GColor8){.argb = (uint8_t)(((a) << 6) | ((r) << 4) | ((g) << 2) | (b))})
+
+#define GColorClear         ((GColor8){.argb = 0x00})
+#define GColorBlack         GColorARGB8(3, 0, 0, 0)
+#define GColorOxfordBlue    GColorARGB8(3, 0, 0, 1)
+#define GColorDukeBlue      GColorARGB8(3, 0, 0, 2)
+#define GColorBlue          GColorARGB8(3, 0, 0, 3)
+#define GColorDarkGreen     GColorARGB8(3, 0, 1, 0)
+#define GColorMidnightGreen GColorARGB8(3, 0, 1, 1)
+#define GColorCobaltBlue    GColorARGB8(3, 0, 1, 2)
+#define GColorBlueMoon      GColorARGB8(3, 0, 1, 3)
+#define GColorIslamicGreen  GColorARGB8(3, 0, 2, 0)
+#define GColorJaegerGreen   GColorARGB8(3, 0, 2, 1)
+#define GColorTiffanyBlue   GColorARGB8(3, 0, 2, 2)
+#define GColorVividCerulean GColorARGB8(3, 0, 2, 3)
+#define GColorGreen         GColorARGB8(3, 0, 3, 0)
+#define GColorMalachite     GColorARGB8(3, 0, 3, 1)
+#define GColorMediumSpringGreen GColorARGB8(3, 0, 3, 2)
+#define GColorCyan          GColorARGB8(3, 0, 3, 3)
+#define GColorBulgarianRose GColorARGB8(3, 1, 0, 0)
+#define GColorImperialPurple GColorARGB8(3, 1, 0, 1)
+#define GColorIndigo        GColorARGB8(3, 1, 0, 2)
+#define GColorElectricUltramarine GColorARGB8(3, 1, 0, 3)
+#define GColorArmyGreen     GColorARGB8(3, 1, 1, 0)
+#define GColorDarkGray      GColorARGB8(3, 1, 1, 1)
+#define GColorLiberty       GColorARGB8(3, 1, 1, 2)
+#define GColorVeryLightBlue GColorARGB8(3, 1, 1, 3)
+#define GColorKellyGreen    GColorARGB8(3, 1, 2, 0)
+#define GColorMayGreen      GColorARGB8(3, 1, 2, 1)
+#define GColorCadetBlue     GColorARGB8(3, 1, 2, 2)
+#define GColorPictonBlue    GColorARGB8(3, 1, 2, 3)
+#define GColorBrightGreen   GColorARGB8(3, 1, 3, 0)
+#define GColorScreaminGreen GColorARGB8(3, 1, 3, 1)
+#define GColorMediumAquamarine GColorARGB8(3, 1, 3, 2)
+#define GColorElectricBlue  GColorARGB8(3, 1, 3, 3)
+#define GColorDarkCandyAppleRed GColorARGB8(3, 2, 0, 0)
+#define GColorJazzberryJam  GColorARGB8(3, 2, 0, 1)
+#define GColorPurple        GColorARGB8(3, 2, 0, 2)
+#define GColorVividViolet   GColorARGB8(3, 2, 0, 3)
+#define GColorWindsorTan    GColorARGB8(3, 2, 1, 0)
+#define GColorRoseVale      GColorARGB8(3, 2, 1, 1)
+#define GColorPurpureus     GColorARGB8(3, 2, 1, 2)
+#define GColorLavenderIndigo GColorARGB8(3, 2, 1, 3)
+#define GColorLimerick      GColorARGB8(3, 2, 2, 0)
+#define GColorBrass         GColorARGB8(3, 2, 2, 1)
+#define GColorLightGray     GColorARGB8(3, 2, 2, 2)
+#define GColorBabyBlueEyes  GColorARGB8(3, 2, 2, 3)
+#define GColorSpringBud     GColorARGB8(3, 2, 3, 0)
+#define GColorInchworm      GColorARGB8(3, 2, 3, 1)
+#define GColorMintGreen     GColorARGB8(3, 2, 3, 2)
+#define GColorCeleste       GColorARGB8(3, 2, 3, 3)
+#define GColorRed           GColorARGB8(3, 3, 0, 0)
+#define GColorFolly         GColorARGB8(3, 3, 0, 1)
+#define GColorFashionMagenta GColorARGB8(3, 3, 0, 2)
+#define GColorMagenta       GColorARGB8(3, 3, 0, 3)
+#define GColorOrange        GColorARGB8(3, 3, 1, 0)
+#define GColorSunsetOrange  GColorARGB8(3, 3, 1, 1)
+#define GColorBrilliantRose GColorARGB8(3, 3, 1, 2)
+#define GColorShockingPink  GColorARGB8(3, 3, 1, 3)
+#define GColorChromeYellow  GColorARGB8(3, 3, 2, 0)
+#define GColorRajah         GColorARGB8(3, 3, 2, 1)
+#define GColorMelon         GColorARGB8(3, 3, 2, 2)
+#define GColorRichBrilliantLavender GColorARGB8(3, 3, 2, 3)
+#define GColorYellow        GColorARGB8(3, 3, 3, 0)
+#define GColorIcterine      GColorARGB8(3, 3, 3, 1)
+#define GColorPastelYellow  GColorARGB8(3, 3, 3, 2)
+#define GColorWhite         GColorARGB8(3, 3, 3, 3)
+
+GColor8 GColorFromRGBA(int red, int green, int blue, int alpha);
+GColor8 GColorFromRGB(int red, int green, int blue);
+GColor8 GColorFromHEX(uint32_t hex);
+bool gcolor_equal(GColor8 x, GColor8 y);
+
+typedef struct GPoint {
+  int16_t x;
+  int16_t y;
+} GPoint;
+
+typedef struct GSize {
+  int16_t w;
+  int16_t h;
+} GSize;
+
+typedef struct GRect {
+  GPoint origin;
+  GSize size;
+} GRect;
+
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GPointZero GPoint(0, 0)
+#define GRectZero GRect(0, 0, 0, 0)
+
+bool gpoint_equal(const GPoint* const point_a, const GPoint* const point_b);
+bool grect_equal(const GRect* const rect_a, const GRect* const rect_b);
+bool grect_contains_point(const GRect* rect, const GPoint* point);
+
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+#define DEG_TO_TRIGANGLE(angle) (((angle) * TRIG_MAX_ANGLE) / 360)
+#define TRIGANGLE_TO_DEG(trig_angle) (((trig_angle) * 360) / TRIG_MAX_ANGLE)
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+
+/********** resources **********/
+
+typedef void* ResHandle;
+
+ResHandle resource_get_handle(uint32_t resource_id);
+size_t resource_size(ResHandle h);
+size_t resource_load(ResHandle h, uint8_t* buffer, size_t max_length);
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t* buffer, size_t num_bytes);
+
+/********** bitmaps **********/
+
+typedef enum GBitmapFormat {
+  GBitmapFormat1Bit = 0,
+  GBitmapFormat8Bit,
+  GBitmapFormat1BitPalette,
+  GBitmapFormat2BitPalette,
+  GBitmapFormat4BitPalette,
+  GBitmapFormat8BitCircular,
+} GBitmapFormat;
+
+typedef struct GBitmap GBitmap;
+
+typedef struct GBitmapDataRowInfo {
+  uint8_t* data;
+  int16_t min_x;
+  int16_t max_x;
+} GBitmapDataRowInfo;
+
+GBitmap* gbitmap_create_with_resource(uint32_t resource_id);
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format);
+GBitmap* gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor* palette, bool free_on_destroy);
+void gbitmap_destroy(GBitmap* bitmap);
+GColor* gbitmap_get_palette(const GBitmap* bitmap);
+void gbitmap_set_palette(GBitmap* bitmap, GColor* palette, bool free_on_destroy);
+uint8_t* gbitmap_get_data(const GBitmap* bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap);
+GRect gbitmap_get_bounds(const GBitmap* bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap);
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap* bitmap, uint16_t y);
+
+/********** graphics **********/
+
+typedef struct GContext GContext;
+typedef struct GFontInfo* GFont;
+typedef struct GPath GPath;
+
+typedef enum {
+  GCornerNone        = 0,
+  GCornerTopLeft     = 1 << 0,
+  GCornerTopRight    = 1 << 1,
+  GCornerBottomLeft  = 1 << 2,
+  GCornerBottomRight = 1 << 3,
+  GCornersAll        = 0xf,
+  GCornersTop        = 0x3,
+  GCornersBottom     = 0xc,
+  GCornersLeft       = 0x5,
+  GCornersRight      = 0xa,
+} GCornerMask;
+
+typedef enum {
+  GCompOpAssign,
+  GCompOpAssignInverted,
+  GCompOpOr,
+  GCompOpAnd,
+  GCompOpClear,
+  GCompOpSet,
+} GCompOp;
+
+typedef enum {
+  GTextOverflowModeWordWrap,
+  GTextOverflowModeTrailingEllipsis,
+  GTextOverflowModeFill
+} GTextOverflowMode;
+
+typedef enum {
+  GTextAlignmentLeft,
+  GTextAlignmentCenter,
+  GTextAlignmentRight
+} GTextAlignment;
+
+typedef enum {
+  GOvalScaleModeFitCircle,
+  GOvalScaleModeFillCircle,
+} GOvalScaleMode;
+
+typedef struct GPathInfo {
+  uint32_t num_points;
+  GPoint* points;
+} GPathInfo;
+
+void graphics_context_set_stroke_color(GContext* ctx, GColor color);
+void graphics_context_set_fill_color(GContext* ctx, GColor color);
+void graphics_context_set_text_color(GContext* ctx, GColor color);
+void graphics_context_set_compositing_mode(GContext* ctx, GCompOp mode);
+void graphics_context_set_antialiased(GContext* ctx, bool enable);
+void graphics_context_set_stroke_width(GContext* ctx, uint8_t stroke_width);
+
+void graphics_draw_pixel(GContext* ctx, GPoint point);
+void graphics_draw_line(GContext* ctx, GPoint p0, GPoint p1);
+void graphics_draw_rect(GContext* ctx, GRect rect);
+void graphics_fill_rect(GContext* ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void graphics_draw_circle(GContext* ctx, GPoint p, uint16_t radius);
+void graphics_fill_circle(GContext* ctx, GPoint p, uint16_t radius);
+void graphics_fill_radial(GContext* ctx, GRect rect, GOvalScaleMode scale_mode, uint16_t inset_thickness,
+                          int32_t angle_start, int32_t angle_end);
+void graphics_draw_bitmap_in_rect(GContext* ctx, const GBitmap* bitmap, GRect rect);
+void graphics_draw_text(GContext* ctx, const char* text, const GFont font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        void* text_attributes);
+
+GBitmap* graphics_capture_frame_buffer(GContext* ctx);
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer);
+
+GPath* gpath_create(const GPathInfo* init);
+void gpath_destroy(GPath* gpath);
+void gpath_draw_filled(GContext* ctx, GPath* path);
+void gpath_draw_outline(GContext* ctx, GPath* path);
+void gpath_move_to(GPath* path, GPoint point);
+
+#define FONT_KEY_GOTHIC_14      "RESOURCE_ID_GOTHIC_14"
+#define FONT_KEY_GOTHIC_14_BOLD "RESOURCE_ID_GOTHIC_14_BOLD"
+#define FONT_KEY_GOTHIC_18      "RESOURCE_ID_GOTHIC_18"
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_24      "RESOURCE_ID_GOTHIC_24"
+#define FONT_KEY_GOTHIC_24_BOLD "RESOURCE_ID_GOTHIC_24_BOLD"
+#define FONT_KEY_GOTHIC_28      "RESOURCE_ID_GOTHIC_28"
+#define FONT_KEY_GOTHIC_28_BOLD "RESOURCE_ID_GOTHIC_28_BOLD"
+
+GFont fonts_get_system_font(const char* font_key);
+
+/********** draw commands (PDC) **********/
+
+typedef struct GDrawCommand GDrawCommand;
+typedef struct GDrawCommandList GDrawCommandList;
+typedef struct GDrawCommandImage GDrawCommandImage;
+
+typedef bool (*GDrawCommandListIteratorCb)(GDrawCommand* command, uint32_t index, void* context);
+
+GDrawCommandImage* gdraw_command_image_create_with_resource(uint32_t resource_id);
+void gdraw_command_image_destroy(GDrawCommandImage* image);
+void gdraw_command_image_draw(GContext* ctx, GDrawCommandImage* image, GPoint offset);
+GSize gdraw_command_image_get_bounds_size(GDrawCommandImage* image);
+GDrawCommandList* gdraw_command_image_get_command_list(GDrawCommandImage* image);
+void gdraw_command_list_iterate(GDrawCommandList* command_list, GDrawCommandListIteratorCb handle_command, void* callback_context);
+void gdraw_command_set_fill_color(GDrawCommand* command, GColor fill_color);
+void gdraw_command_set_stroke_color(GDrawCommand* command, GColor stroke_color);
+
+/********** layers and windows **********/
+
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef struct BitmapLayer BitmapLayer;
+
+typedef void (*LayerUpdateProc)(Layer* layer, GContext* ctx);
+
+Layer* layer_create(GRect frame);
+Layer* layer_create_with_data(GRect frame, size_t data_size);
+void layer_destroy(Layer* layer);
+void* layer_get_data(const Layer* layer);
+void layer_mark_dirty(Layer* layer);
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update_proc);
+void layer_set_frame(Layer* layer, GRect frame);
+GRect layer_get_frame(const Layer* layer);
+void layer_set_bounds(Layer* layer, GRect bounds);
+GRect layer_get_bounds(const Layer* layer);
+void layer_add_child(Layer* parent, Layer* child);
+void layer_remove_from_parent(Layer* child);
+void layer_set_hidden(Layer* layer, bool hidden);
+bool layer_get_hidden(const Layer* layer);
+
+typedef void (*WindowHandler)(Window* window);
+
+typedef struct WindowHandlers {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+Window* window_create(void);
+void window_destroy(Window* window);
+void window_set_window_handlers(Window* window, WindowHandlers handlers);
+Layer* window_get_root_layer(const Window* window);
+void window_set_background_color(Window* window, GColor background_color);
+void window_stack_push(Window* window, bool animated);
+
+BitmapLayer* bitmap_layer_create(GRect frame);
+void bitmap_layer_destroy(BitmapLayer* bitmap_layer);
+Layer* bitmap_layer_get_layer(const BitmapLayer* bitmap_layer);
+void bitmap_layer_set_bitmap(BitmapLayer* bitmap_layer, const GBitmap* bitmap);
+void bitmap_layer_set_compositing_mode(BitmapLayer* bitmap_layer, GCompOp mode);
+
+/********** event services **********/
+
+typedef enum {
+  SECOND_UNIT = 1 << 0,
+  MINUTE_UNIT = 1 << 1,
+  HOUR_UNIT   = 1 << 2,
+  DAY_UNIT    = 1 << 3,
+  MONTH_UNIT  = 1 << 4,
+  YEAR_UNIT   = 1 << 5
+} TimeUnits;
+
+typedef void (*TickHandler)(struct tm* tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+typedef struct {
+  uint8_t charge_percent;
+  bool is_charging;
+  bool is_plugged;
+} BatteryChargeState;
+
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+BatteryChargeState battery_state_service_peek(void);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+
+typedef void (*BluetoothConnectionHandler)(bool connected);
+bool bluetooth_connection_service_peek(void);
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler);
+void bluetooth_connection_service_unsubscribe(void);
+
+bool quiet_time_is_active(void);
+
+typedef struct {
+  const uint32_t* durations;
+  uint32_t num_segments;
+} VibePattern;
+
+void vibes_short_pulse(void);
+void vibes_long_pulse(void);
+void vibes_double_pulse(void);
+void vibes_enqueue_custom_pattern(VibePattern pattern);
+void vibes_cancel(void);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void* data);
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void* callback_data);
+bool app_timer_reschedule(AppTimer* timer_handle, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer* timer_handle);
+
+void app_event_loop(void);
+
+/********** persistent storage **********/
+
+#define PERSIST_DATA_MAX_LENGTH 256
+#define PERSIST_STRING_MAX_LENGTH PERSIST_DATA_MAX_LENGTH
+
+bool persist_exists(const uint32_t key);
+int persist_get_size(const uint32_t key);
+bool persist_read_bool(const uint32_t key);
+int32_t persist_read_int(const uint32_t key);
+int persist_read_data(const uint32_t key, void* buffer, const size_t buffer_size);
+int persist_read_string(const uint32_t key, char* buffer, const size_t buffer_size);
+int persist_write_bool(const uint32_t key, const bool value);
+int persist_write_int(const uint32_t key, const int32_t value);
+int persist_write_data(const uint32_t key, const void* data, const size_t size);
+int persist_write_string(const uint32_t key, const char* cstring);
+int persist_delete(const uint32_t key);
+
+/********** app messages **********/
+
+typedef enum {
+  TUPLE_BYTE_ARRAY = 0,
+  TUPLE_CSTRING    = 1,
+  TUPLE_UINT       = 2,
+  TUPLE_INT        = 3,
+} TupleType;
+
+typedef struct __attribute__((__packed__)) {
+  uint32_t key;
+  TupleType type:8;
+  uint16_t length;
+  union {
+    uint8_t data[0];
+    char cstring[0];
+    uint8_t uint8;
+    uint16_t uint16;
+    uint32_t uint32;
+    int8_t int8;
+    int16_t int16;
+    int32_t int32;
+  } value[];
+} Tuple;
+
+typedef struct DictionaryIterator {
+  uint8_t* begin;
+  uint8_t* end;
+  Tuple* cursor;
+} DictionaryIterator;
+
+typedef enum {
+  DICT_OK = 0,
+  DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+  DICT_INVALID_ARGS = 1 << 2,
+} DictionaryResult;
+
+DictionaryResult dict_write_begin(DictionaryIterator* iter, uint8_t* const buffer, const uint16_t size);
+uint32_t dict_write_end(DictionaryIterator* iter);
+Tuple* dict_find(const DictionaryIterator* iter, const uint32_t key);
+Tuple* dict_read_first(DictionaryIterator* iter);
+Tuple* dict_read_next(DictionaryIterator* iter);
+DictionaryResult dict_write_data(DictionaryIterator* iter, const uint32_t key, const uint8_t* data, const uint16_t size);
+DictionaryResult dict_write_cstring(DictionaryIterator* iter, const uint32_t key, const char* cstring);
+DictionaryResult dict_write_int(DictionaryIterator* iter, const uint32_t key, const void* integer, const uint8_t width_bytes, const bool is_signed);
+DictionaryResult dict_write_uint8(DictionaryIterator* iter, const uint32_t key, const uint8_t value);
+DictionaryResult dict_write_uint16(DictionaryIterator* iter, const uint32_t key, const uint16_t value);
+DictionaryResult dict_write_uint32(DictionaryIterator* iter, const uint32_t key, const uint32_t value);
+DictionaryResult dict_write_int8(DictionaryIterator* iter, const uint32_t key, const int8_t value);
+DictionaryResult dict_write_int16(DictionaryIterator* iter, const uint32_t key, const int16_t value);
+DictionaryResult dict_write_int32(DictionaryIterator* iter, const uint32_t key, const int32_t value);
+
+typedef enum {
+  APP_MSG_OK = 0,
+  APP_MSG_SEND_TIMEOUT = 1 << 1,
+  APP_MSG_SEND_REJECTED = 1 << 2,
+  APP_MSG_NOT_CONNECTED = 1 << 3,
+  APP_MSG_APP_NOT_RUNNING = 1 << 4,
+  APP_MSG_INVALID_ARGS = 1 << 5,
+  APP_MSG_BUSY = 1 << 6,
+  APP_MSG_BUFFER_OVERFLOW = 1 << 7,
+  APP_MSG_ALREADY_RELEASED = 1 << 9,
+  APP_MSG_CALLBACK_ALREADY_REGISTERED = 1 << 10,
+  APP_MSG_CALLBACK_NOT_REGISTERED = 1 << 11,
+  APP_MSG_OUT_OF_MEMORY = 1 << 12,
+  APP_MSG_CLOSED = 1 << 13,
+  APP_MSG_INTERNAL_ERROR = 1 << 14,
+} AppMessageResult;
+
+#define APP_MESSAGE_INBOX_SIZE_MINIMUM 124
+#define APP_MESSAGE_OUTBOX_SIZE_MINIMUM 636
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator* iterator, void* context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void* context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator* iterator, void* context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator* iterator, AppMessageResult reason, void* context);
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+void app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+void app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback);
+void app_message_register_outbox_sent(AppMessageOutboxSent sent_callback);
+void app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback);
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator);
+AppMessageResult app_message_outbox_send(void);
+
+/********** health **********/
+
+#ifdef PBL_HEALTH
+
+typedef int32_t HealthValue;
+
+typedef enum {
+  HealthMetricStepCount,
+  HealthMetricActiveSeconds,
+  HealthMetricWalkedDistanceMeters,
+  HealthMetricSleepSeconds,
+  HealthMetricSleepRestfulSeconds,
+  HealthMetricRestingKCalories,
+  HealthMetricActiveKCalories,
+  HealthMetricHeartRateBPM,
+} HealthMetric;
+
+typedef enum {
+  HealthActivityNone         = 0,
+  HealthActivitySleep        = 1 << 0,
+  HealthActivityRestfulSleep = 1 << 1,
+  HealthActivityWalk         = 1 << 2,
+  HealthActivityRun          = 1 << 3,
+  HealthActivityOpenWorkout  = 1 << 4,
+} HealthActivity;
+
+typedef uint32_t HealthActivityMask;
+#define HealthActivityMaskAll ((HealthActivityOpenWorkout << 1) - 1)
+
+typedef enum {
+  HealthIterationDirectionPast,
+  HealthIterationDirectionFuture,
+} HealthIterationDirection;
+
+typedef enum {
+  HealthEventSignificantUpdate = 0,
+  HealthEventMovementUpdate,
+  HealthEventSleepUpdate,
+  HealthEventMetricAlert,
+  HealthEventHeartRateUpdate,
+} HealthEventType;
+
+typedef struct {
+  uint8_t steps;
+  uint8_t orientation;
+  uint16_t vmc;
+  bool is_invalid:1;
+  uint8_t light:3;
+  uint8_t padding:4;
+  uint8_t heart_rate_bpm;
+  uint8_t reserved[6];
+} HealthMinuteData;
+
+typedef bool (*HealthActivityIteratorCB)(HealthActivity activity, time_t time_start, time_t time_end, void* context);
+typedef void (*HealthEventHandler)(HealthEventType event, void* context);
+
+HealthValue health_service_sum_today(HealthMetric metric);
+HealthValue health_service_sum(HealthMetric metric, time_t time_start, time_t time_end);
+HealthActivityMask health_service_peek_current_activities(void);
+void health_service_activities_iterate(HealthActivityMask activity_mask, time_t time_start, time_t time_end,
+                                       HealthIterationDirection direction, HealthActivityIteratorCB callback,
+                                       void* context);
+uint32_t health_service_get_minute_history(HealthMinuteData* minute_data, uint32_t max_records,
+                                           time_t* time_start, time_t* time_end);
+bool health_service_events_subscribe(HealthEventHandler handler, void* context);
+bool health_service_events_unsubscribe(void);
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * Renders the watchface once for every combination of sidebar widgets, font
+ * size and sidebar side, writing a PNG per combination and a CSV row with
+ * the draw calls and pixels written for that frame.
+ *
+ * The combinations are split into shards so that several processes can work
+ * through them in parallel: shard i of n renders every n-th combination.
+ *
+ * usage: render_sweep [--shard i] [--shards n] --out DIR
+ */
+
+// pull in the face itself, so that its static init and deinit are reachable
+#define main face_main
+#include "main.c"
+#undef main
+
+#include <errno.h>
+#include <sys/stat.h>
+#include "host.h"
+
+static const SidebarWidgetType sweepWidgets[] = {
+  EMPTY, BLUETOOTH_DISCONNECT, BATTERY_METER, ALT_TIME_ZONE, DATE, SECONDS,
+  WEEK_NUMBER, WEATHER_CURRENT, WEATHER_FORECAST_TODAY, TIME, HEALTH, DAY_NUMBER,
+  HOURLY_FORECAST, HEALTH_HISTORY
+};
+
+#define WIDGET_CHOICES ((int)ARRAY_LENGTH(sweepWidgets))
+
+typedef struct {
+  SidebarWidgetType widgets[3];
+  bool useLargeFonts;
+  bool sidebarOnLeft;
+} SweepCase;
+
+/*
+ * Round watches only show the first and last widget, and have a sidebar on
+ * both sides, so neither the middle widget nor the side varies there
+ */
+static int sweepCaseCount() {
+  #ifdef PBL_ROUND
+    return WIDGET_CHOICES * WIDGET_CHOICES * 2;
+  #else
+    return WIDGET_CHOICES * WIDGET_CHOICES * WIDGET_CHOICES * 2 * 2;
+  #endif
+}
+
+static SweepCase sweepCase(int index) {
+  SweepCase c;
+
+  #ifdef PBL_ROUND
+    c.sidebarOnLeft = false;
+    c.useLargeFonts = index % 2;
+    index /= 2;
+    c.widgets[1] = EMPTY;
+  #else
+    c.sidebarOnLeft = index % 2;
+    index /= 2;
+    c.useLargeFonts = index % 2;
+    index /= 2;
+    c.widgets[1] = sweepWidgets[index % WIDGET_CHOICES];
+    index /= WIDGET_CHOICES;
+  #endif
+
+  c.widgets[2] = sweepWidgets[index % WIDGET_CHOICES];
+  index /= WIDGET_CHOICES;
+  c.widgets[0] = sweepWidgets[index % WIDGET_CHOICES];
+
+  return c;
+}
+
+static void sweepCaseName(const SweepCase* c, char* name, size_t size) {
+  snprintf(name, size, "w%02d-%02d-%02d_%s_%s",
+           c->widgets[0], c->widgets[1], c->widgets[2],
+           c->useLargeFonts ? "lg" : "sm",
+           PBL_IF_ROUND_ELSE("both", c->sidebarOnLeft ? "left" : "right"));
+}
+
+// stores the settings and data that the face will load when it starts
+static void writeSweepSettings(const SweepCase* c) {
+  GColor timeColor = PBL_IF_COLOR_ELSE(GColorOrange, GColorWhite);
+  GColor timeBgColor = GColorBlack;
+  GColor sidebarColor = PBL_IF_COLOR_ELSE(GColorOrange, GColorWhite);
+  GColor sidebarTextColor = GColorBlack;
+
+  persist_write_data(SETTING_TIME_COLOR_KEY,         &timeColor,        sizeof(GColor));
+  persist_write_data(SETTING_TIME_BG_COLOR_KEY,      &timeBgColor,      sizeof(GColor));
+  persist_write_data(SETTING_SIDEBAR_COLOR_KEY,      &sidebarColor,     sizeof(GColor));
+  persist_write_data(SETTING_SIDEBAR_TEXT_COLOR_KEY, &sidebarTextColor, sizeof(GColor));
+
+  persist_write_int(SETTING_SIDEBAR_WIDGET0_KEY, c->widgets[0]);
+  persist_write_int(SETTING_SIDEBAR_WIDGET1_KEY, c->widgets[1]);
+  persist_write_int(SETTING_SIDEBAR_WIDGET2_KEY, c->widgets[2]);
+  persist_write_bool(SETTING_USE_LARGE_FONTS_KEY, c->useLargeFonts);
+  persist_write_bool(SETTING_SIDEBAR_LEFT_KEY, c->sidebarOnLeft);
+  persist_write_bool(SETTING_SHOW_BATTERY_PCT_KEY, true);
+  persist_write_int(SETTING_ALTCLOCK_OFFSET_KEY, -5);
+
+  WeatherInfo weather = {
+    .currentTemp = 21,
+    .currentIconResourceID = RESOURCE_ID_WEATHER_PARTLY_CLOUDY
+  };
+
+  WeatherForecastInfo forecast = {
+    .highTemp = 24,
+    .lowTemp = 12,
+    .forecastIconResourceID = RESOURCE_ID_WEATHER_LIGHT_RAIN
+  };
+
+  persist_write_data(WEATHERINFO_PERSIST_KEY, &weather, sizeof(WeatherInfo));
+  persist_write_data(WEATHERFORECAST_PERSIST_KEY, &forecast, sizeof(WeatherForecastInfo));
+
+  // a forecast that peaks this afternoon and cools off into the night,
+  // starting from the current weather above
+  static const int8_t hourlyTemps[] = {21, 22, 24, 23, 22, 20, 18, 16, 15, 14, 14, 15};
+
+  HourlyForecast hourly = {
+    .startTime = time(NULL) / SECONDS_PER_HOUR * SECONDS_PER_HOUR,
+    .hourCount = ARRAY_LENGTH(hourlyTemps)
+  };
+
+  memcpy(hourly.temperatures, hourlyTemps, sizeof(hourlyTemps));
+  memset(hourly.icons, WEATHER_ICON_PARTLY_CLOUDY | (WEATHER_ICON_PARTLY_CLOUDY << 4), sizeof(hourly.icons));
+  persist_write_data(HOURLYFORECAST_PERSIST_KEY, &hourly, sizeof(HourlyForecast));
+}
+
+int main(int argc, char** argv) {
+  int shard = 0;
+  int shards = 1;
+  const char* outDir = NULL;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+      shard = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+      shards = atoi(argv[++i]);
+    } else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      outDir = argv[++i];
+    } else if(strcmp(argv[i], "--verbose") == 0) {
+      host_set_verbose(true);
+    } else {
+      fprintf(stderr, "usage: %s [--shard i] [--shards n] [--verbose] --out DIR\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if(!outDir || shards < 1 || shard < 0 || shard >= shards) {
+    fprintf(stderr, "usage: %s [--shard i] [--shards n] [--verbose] --out DIR\n", argv[0]);
+    return 2;
+  }
+
+  if(mkdir(outDir, 0755) != 0 && errno != EEXIST) {
+    perror(outDir);
+    return 1;
+  }
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/shard%03d.csv", outDir, shard);
+  FILE* csv = fopen(path, "w");
+
+  if(!csv) {
+    perror(path);
+    return 1;
+  }
+
+  fprintf(csv, "name,draw_calls,pixels_written,layer_renders\n");
+
+  for(int i = shard; i < sweepCaseCount(); i += shards) {
+    SweepCase c = sweepCase(i);
+    char name[64];
+    sweepCaseName(&c, name, sizeof(name));
+
+    host_reset();
+
+    #ifdef PBL_HEALTH
+      host_set_health_metric(HealthMetricStepCount, 4321);
+      host_set_health_metric(HealthMetricWalkedDistanceMeters, 3170);
+      host_set_health_metric(HealthMetricSleepSeconds, 7 * SECONDS_PER_HOUR);
+      host_set_health_metric(HealthMetricSleepRestfulSeconds, 2 * SECONDS_PER_HOUR);
+      host_set_health_minute_steps(3);
+    #endif
+
+    writeSweepSettings(&c);
+    init();
+
+    // only count the cost of drawing the frame itself
+    host_reset_counters();
+    host_render_frame();
+
+    snprintf(path, sizeof(path), "%s/%s.png", outDir, name);
+
+    if(!host_write_png(path)) {
+      perror(path);
+      return 1;
+    }
+
+    fprintf(csv, "%s,%u,%u,%u\n", name, host_counters.drawCalls, host_counters.pixelsWritten,
+            host_counters.layerRenders);
+
+    deinit();
+  }
+
+  fclose(csv);
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#
+# Builds the watchface for the host against the software renderer in this
+# directory, renders every combination of sidebar widgets, font size and
+# sidebar side for aplite, basalt and chalk, and reports what each frame cost.
+#
+# The renders can be compared against (or saved as) a set of golden images:
+#
+#   tools/host/render_sweep.py --update-golden /tmp/golden
+#   ...change some drawing code...
+#   tools/host/render_sweep.py --golden /tmp/golden
+#
+# Requires gcc, libpng and zlib.
+
+import argparse
+import csv
+import multiprocessing
+import os
+import struct
+import subprocess
+import sys
+import zlib
+
+from host_build import BUILD_DIR, PLATFORMS, build
+
+
+def render_shard(job):
+    binary, shard, shards, out_dir = job
+    env = dict(os.environ, LC_ALL='C')
+    subprocess.check_call([binary, '--shard', str(shard), '--shards', str(shards), '--out', out_dir], env=env)
+
+
+def read_png_pixels(path):
+    """Decodes the RGB pixels of a PNG written by host_write_png()"""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    position = 8
+    idat = b''
+    width = height = 0
+
+    while position < len(data):
+        length, kind = struct.unpack('>I4s', data[position:position + 8])
+        body = data[position + 8:position + 8 + length]
+
+        if kind == b'IHDR':
+            width, height = struct.unpack('>II', body[:8])
+        elif kind == b'IDAT':
+            idat += body
+
+        position += 12 + length
+
+    raw = zlib.decompress(idat)
+    stride = 1 + width * 3
+
+    # every row uses filter type 0, so dropping the filter bytes is enough
+    return width, height, b''.join(raw[y * stride + 1:(y + 1) * stride] for y in range(height))
+
+
+def compare_with_golden(platform, out_dir, golden_dir):
+    """Returns a list of (name, differing pixels) for every image that changed"""
+    failures = []
+    golden_platform_dir = os.path.join(golden_dir, platform)
+
+    for name in sorted(os.listdir(out_dir)):
+        if not name.endswith('.png'):
+            continue
+
+        golden_path = os.path.join(golden_platform_dir, name)
+
+        if not os.path.exists(golden_path):
+            failures.append((name, 'missing golden'))
+            continue
+
+        width, height, pixels = read_png_pixels(os.path.join(out_dir, name))
+        golden_width, golden_height, golden_pixels = read_png_pixels(golden_path)
+
+        if (width, height) != (golden_width, golden_height):
+            failures.append((name, 'size changed'))
+        elif pixels != golden_pixels:
+            different = sum(1 for i in range(0, len(pixels), 3) if pixels[i:i + 3] != golden_pixels[i:i + 3])
+            failures.append((name, '%d pixels differ' % different))
+
+    return failures
+
+
+def merge_csv(out_dir, merged_path):
+    rows = []
+
+    for name in sorted(os.listdir(out_dir)):
+        if name.startswith('shard') and name.endswith('.csv'):
+            with open(os.path.join(out_dir, name)) as f:
+                rows += list(csv.DictReader(f))
+
+    rows.sort(key=lambda row: row['name'])
+
+    with open(merged_path, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=['name', 'draw_calls', 'pixels_written', 'layer_renders'])
+        writer.writeheader()
+        writer.writerows(rows)
+
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Render every sidebar configuration on the host.')
+    parser.add_argument('--platform', action='append', choices=PLATFORMS,
+                        help='platform to render (default: all of them)')
+    parser.add_argument('--jobs', type=int, default=multiprocessing.cpu_count(),
+                        help='number of renderer processes to run in parallel')
+    parser.add_argument('--out', default=os.path.join(BUILD_DIR, 'sweep'),
+                        help='directory for the rendered images and cost tables')
+    golden = parser.add_mutually_exclusive_group()
+    golden.add_argument('--golden', help='compare the renders against the images in this directory')
+    golden.add_argument('--update-golden', help='save the renders as the golden images in this directory')
+    args = parser.parse_args()
+
+    platforms = args.platform or PLATFORMS
+    exit_code = 0
+
+    for platform in platforms:
+        binary = build(platform, 'render_sweep')
+        out_dir = os.path.join(args.out, platform)
+        os.makedirs(out_dir, exist_ok=True)
+
+        for name in os.listdir(out_dir):
+            os.remove(os.path.join(out_dir, name))
+
+        # more shards than processes keeps all cores busy until the end
+        shards = max(1, args.jobs) * 4
+        jobs = [(binary, shard, shards, out_dir) for shard in range(shards)]
+
+        with multiprocessing.Pool(max(1, args.jobs)) as pool:
+            pool.map(render_shard, jobs)
+
+        rows = merge_csv(out_dir, os.path.join(args.out, platform + '.csv'))
+        draw_calls = [int(row['draw_calls']) for row in rows]
+        pixels = [int(row['pixels_written']) for row in rows]
+
+        print('%-7s %5d frames  draw calls %4d..%-4d (mean %.1f)  pixels %6d..%-6d (mean %.0f)' % (
+            platform, len(rows), min(draw_calls), max(draw_calls), sum(draw_calls) / len(rows),
+            min(pixels), max(pixels), sum(pixels) / len(rows)))
+
+        if args.update_golden:
+            golden_platform_dir = os.path.join(args.update_golden, platform)
+            os.makedirs(golden_platform_dir, exist_ok=True)
+
+            for name in os.listdir(out_dir):
+                if name.endswith('.png'):
+                    os.replace(os.path.join(out_dir, name), os.path.join(golden_platform_dir, name))
+        elif args.golden:
+            failures = compare_with_golden(platform, out_dir, args.golden)
+
+            for name, reason in failures:
+                print('  %s: %s' % (name, reason))
+
+            if failures:
+                print('  %d of %d images differ from the golden set' % (len(failures), len(rows)))
+                exit_code = 1
+
+    return exit_code
+
+
+if __name__ == '__main__':
+    sys.exit(main())
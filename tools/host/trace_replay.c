@@ -0,0 +1,443 @@
+/*
+ * Replays an event trace recorded on a watch (see src/event_trace.h) through
+ * the watchface: the same ticks, bluetooth and battery changes, sleep, and
+ * incoming messages, at the same times, starting from the same settings. Prints what
+ * the face did in response -- frames, storage writes, and every message it
+ * sent to the phone -- so that misbehaviour seen on a watch can be reproduced
+ * and stepped through on the host.
+ *
+ * The trace file holds the header followed by the records, as written to the
+ * log by EventTrace_deinit (trace_replay.py extracts it from `pebble logs`).
+ *
+ * usage: trace_replay [--verbose] TRACE
+ */
+
+// pull in the face itself, so that its static init and deinit are reachable
+#define main face_main
+#include "main.c"
+#undef main
+
+#include "host.h"
+
+// sends closer together than this are reported as possible duplicates
+#define DUPLICATE_SEND_SECONDS 60
+
+static bool isVerbose;
+static bool isRunning;
+
+static uint32_t recordedTicks;
+static uint32_t settingsMismatches;
+static uint32_t nightModeMismatches;
+static uint32_t tickRateMismatches;
+static uint32_t duplicateSends;
+static time_t lastSendTime = -1;
+
+static uint16_t readUint16(const uint8_t* in) {
+  return in[0] | (in[1] << 8);
+}
+
+static uint32_t readUint32(const uint8_t* in) {
+  return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static const char* formatTime(time_t t) {
+  static char text[32];
+  struct tm info;
+
+  gmtime_r(&t, &info);
+  strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &info);
+
+  return text;
+}
+
+static void applySettings(const uint8_t* snapshot) {
+  uint8_t flags = snapshot[8];
+
+  globalSettings.widgets[0]            = snapshot[0];
+  globalSettings.widgets[1]            = snapshot[1];
+  globalSettings.widgets[2]            = snapshot[2];
+  globalSettings.clockFontId           = snapshot[3];
+  globalSettings.languageId            = snapshot[4];
+  globalSettings.hourlyVibe            = snapshot[5];
+  globalSettings.altclockOffset        = (int8_t)snapshot[6];
+  globalSettings.decimalSeparator      = snapshot[7];
+  globalSettings.useLargeFonts         = flags & EVENT_TRACE_FLAG_LARGE_FONTS;
+  globalSettings.sidebarOnLeft         = flags & EVENT_TRACE_FLAG_SIDEBAR_LEFT;
+  globalSettings.btVibe                = flags & EVENT_TRACE_FLAG_BT_VIBE;
+  globalSettings.showLeadingZero       = flags & EVENT_TRACE_FLAG_LEADING_ZERO;
+  globalSettings.showBatteryPct        = flags & EVENT_TRACE_FLAG_BATTERY_PCT;
+  globalSettings.useMetric             = flags & EVENT_TRACE_FLAG_METRIC;
+  globalSettings.healthUseDistance     = flags & EVENT_TRACE_FLAG_HEALTH_DISTANCE;
+  globalSettings.healthUseRestfulSleep = flags & EVENT_TRACE_FLAG_HEALTH_RESTFUL_SLEEP;
+  globalSettings.timeColor.argb        = snapshot[9];
+  globalSettings.timeBgColor.argb      = snapshot[10];
+  globalSettings.sidebarColor.argb     = snapshot[11];
+  globalSettings.sidebarTextColor.argb = snapshot[12];
+  globalSettings.chimePattern          = snapshot[13];
+  globalSettings.quietHoursStart       = snapshot[14];
+  globalSettings.quietHoursEnd         = snapshot[15];
+  globalSettings.nightModeEnabled      = snapshot[16];
+  globalSettings.nightStartHour        = snapshot[17];
+  globalSettings.nightEndHour          = snapshot[18];
+
+  Settings_saveToStorage();
+}
+
+// gives the health service the sleep state the face saw on the watch
+static void applySleep(uint8_t nightMode) {
+  #ifdef PBL_HEALTH
+    host_set_health_activities((nightMode & EVENT_TRACE_NIGHT_MODE_ASLEEP) ? HealthActivitySleep : HealthActivityNone);
+  #endif
+}
+
+// compares how often the face ticks with what the watch recorded
+static void checkTickRate(bool isTickingEverySecond) {
+  if(updatingEverySecond != isTickingEverySecond) {
+    fprintf(stdout, "%s  the face ticks every %s, but ticked every %s in the recording\n",
+            formatTime(host_time(NULL)), updatingEverySecond ? "second" : "minute",
+            isTickingEverySecond ? "second" : "minute");
+    tickRateMismatches++;
+  }
+}
+
+/*
+ * Puts the simulated watch in the given state and launches the face, which
+ * should then tick as often as it did on the watch
+ */
+static void startSession(time_t t, uint8_t battery, bool isPhoneConnected, const uint8_t* settings,
+                         uint8_t nightMode, bool isTickingEverySecond) {
+  if(isRunning) {
+    deinit();
+  }
+
+  host_set_time(t);
+  host_set_battery(battery & ~EVENT_TRACE_BATTERY_CHARGING, battery & EVENT_TRACE_BATTERY_CHARGING);
+  host_set_bluetooth(isPhoneConnected);
+  applySettings(settings);
+  applySleep(nightMode);
+
+  init();
+  host_render_frame();
+  isRunning = true;
+
+  if(isVerbose) {
+    fprintf(stdout, "%s  session starts\n", formatTime(t));
+  }
+
+  checkTickRate(isTickingEverySecond);
+}
+
+// lets the phone answer whatever the face sent, and reports the send
+static void deliverOutbox() {
+  if(!host_deliver_outbox()) {
+    return;
+  }
+
+  time_t now = host_time(NULL);
+  bool isDuplicate = lastSendTime >= 0 && now - lastSendTime < DUPLICATE_SEND_SECONDS;
+
+  fprintf(stdout, "%s  message sent to phone%s\n", formatTime(now),
+          isDuplicate ? "  (possible duplicate)" : "");
+
+  if(isDuplicate) {
+    duplicateSends++;
+  }
+
+  lastSendTime = now;
+}
+
+/*
+ * Moves the clock forward to the given time a minute boundary at a time, so
+ * that every send is delivered at the tick that made it
+ */
+static void advanceTo(time_t t) {
+  while(host_time(NULL) < t) {
+    time_t now = host_time(NULL);
+    time_t next = (now / SECONDS_PER_MINUTE + 1) * SECONDS_PER_MINUTE;
+
+    if(next > t) {
+      next = t;
+    }
+
+    host_advance_time((next - now) * 1000);
+    deliverOutbox();
+  }
+}
+
+// rebuilds a recorded message and hands it to the face
+static void receiveMessage(const uint8_t* record) {
+  uint8_t buffer[1024];
+  DictionaryIterator iter;
+  int offset = 4;
+
+  dict_write_begin(&iter, buffer, sizeof(buffer));
+
+  for(int i = 0; i < record[3]; i++) {
+    uint8_t key = record[offset];
+    uint8_t type = record[offset + 1];
+    uint8_t length = record[offset + 2];
+    const uint8_t* value = &record[offset + 3];
+
+    if(type == TUPLE_CSTRING) {
+      char text[EVENT_TRACE_MAX_TUPLE_LENGTH + 1];
+      memcpy(text, value, length);
+      text[length] = '\0';
+      dict_write_cstring(&iter, key, text);
+    } else if(type == TUPLE_UINT || type == TUPLE_INT) {
+      dict_write_int(&iter, key, value, length, type == TUPLE_INT);
+    } else {
+      dict_write_data(&iter, key, value, length);
+    }
+
+    offset += 3 + length;
+  }
+
+  host_app_message_receive(&iter);
+  deliverOutbox();
+}
+
+// compares the face's settings with those the watch recorded
+static void checkSettings(const uint8_t* recorded) {
+  uint8_t replayed[EVENT_TRACE_SETTINGS_SIZE];
+  EventTrace_snapshotSettings(replayed);
+
+  if(memcmp(replayed, recorded, EVENT_TRACE_SETTINGS_SIZE) != 0) {
+    fprintf(stdout, "%s  settings differ from the recording; using the recorded ones\n",
+            formatTime(host_time(NULL)));
+
+    settingsMismatches++;
+    applySettings(recorded);
+    redrawScreen();
+    host_render_frame();
+  }
+}
+
+// compares the face's night mode with what the watch recorded
+static void checkNightMode(uint8_t recorded) {
+  bool isActive = recorded & EVENT_TRACE_NIGHT_MODE_ACTIVE;
+
+  if(isVerbose) {
+    fprintf(stdout, "%s  night mode %s%s\n", formatTime(host_time(NULL)), isActive ? "on" : "off",
+            (recorded & EVENT_TRACE_NIGHT_MODE_ASLEEP) ? ", asleep" : "");
+  }
+
+  if(NightMode_isActive != isActive) {
+    fprintf(stdout, "%s  night mode differs from the recording\n", formatTime(host_time(NULL)));
+    nightModeMismatches++;
+  }
+}
+
+/*
+ * Finds the NIGHT_MODE record among those that follow at the same time. The
+ * face recorded it after the event that made it check, so the sleep state
+ * has to be in place before that event is replayed
+ */
+static const uint8_t* findNightMode(const uint8_t* records, int length) {
+  for(int offset = 0; offset < length; ) {
+    const uint8_t* record = &records[offset];
+    int size = EventTrace_recordSize(record, length - offset);
+
+    if(size == 0 || record[0] == EVENT_TRACE_SESSION || record[0] == EVENT_TRACE_TIME ||
+       readUint16(&record[1]) != 0) {
+      return NULL;
+    }
+
+    if(record[0] == EVENT_TRACE_NIGHT_MODE) {
+      return record;
+    }
+
+    offset += size;
+  }
+
+  return NULL;
+}
+
+static void replayRecord(const uint8_t* record, time_t t) {
+  if(!isRunning) {
+    return;
+  }
+
+  advanceTo(t);
+
+  switch(record[0]) {
+    case EVENT_TRACE_TICKS:
+      recordedTicks += record[4];
+      break;
+    case EVENT_TRACE_BLUETOOTH:
+      if(isVerbose) {
+        fprintf(stdout, "%s  phone %s\n", formatTime(t), record[3] ? "connected" : "disconnected");
+      }
+
+      host_set_bluetooth(record[3]);
+      deliverOutbox();
+      break;
+    case EVENT_TRACE_BATTERY:
+      if(isVerbose) {
+        fprintf(stdout, "%s  battery %d%%%s\n", formatTime(t), record[3] & ~EVENT_TRACE_BATTERY_CHARGING,
+                (record[3] & EVENT_TRACE_BATTERY_CHARGING) ? ", charging" : "");
+      }
+
+      host_set_battery(record[3] & ~EVENT_TRACE_BATTERY_CHARGING, record[3] & EVENT_TRACE_BATTERY_CHARGING);
+      break;
+    case EVENT_TRACE_MESSAGE:
+      if(isVerbose) {
+        fprintf(stdout, "%s  message received, %d tuples\n", formatTime(t), record[3]);
+      }
+
+      receiveMessage(record);
+      break;
+    case EVENT_TRACE_SETTINGS:
+      checkSettings(&record[3]);
+      break;
+    case EVENT_TRACE_NIGHT_MODE:
+      checkNightMode(record[3]);
+      break;
+    case EVENT_TRACE_TICK_RATE:
+      if(isVerbose) {
+        fprintf(stdout, "%s  ticks every %s\n", formatTime(t), record[3] ? "second" : "minute");
+      }
+
+      checkTickRate(record[3]);
+      break;
+  }
+}
+
+static uint8_t* readFile(const char* path, int* size) {
+  FILE* file = fopen(path, "rb");
+
+  if(!file) {
+    return NULL;
+  }
+
+  uint8_t* data = malloc(EVENT_TRACE_HEADER_SIZE + EVENT_TRACE_SIZE);
+  *size = fread(data, 1, EVENT_TRACE_HEADER_SIZE + EVENT_TRACE_SIZE, file);
+  fclose(file);
+
+  return data;
+}
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s [--verbose] TRACE\n", name);
+}
+
+int main(int argc, char** argv) {
+  const char* path = NULL;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--verbose") == 0) {
+      isVerbose = true;
+    } else if(argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if(!path) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int size;
+  uint8_t* trace = readFile(path, &size);
+
+  if(!trace) {
+    fprintf(stderr, "can't read %s\n", path);
+    return 2;
+  }
+
+  const uint8_t* header = trace;
+  int length = readUint16(&header[EVENT_TRACE_HEADER_SIZE - 2]);
+
+  if(size < EVENT_TRACE_HEADER_SIZE || length != size - EVENT_TRACE_HEADER_SIZE) {
+    fprintf(stderr, "%s is not a complete event trace\n", path);
+    return 2;
+  }
+
+  if(header[0] != EVENT_TRACE_VERSION) {
+    fprintf(stderr, "%s was recorded by a different version of the face\n", path);
+    return 2;
+  }
+
+  const uint8_t* records = trace + EVENT_TRACE_HEADER_SIZE;
+  time_t start = readUint32(&header[1]);
+  time_t t = start;
+  int sessions = 0;
+
+  host_reset();
+
+  // unless the trace starts with a launch, the face was already running, in
+  // the state the header describes
+  if(length == 0 || records[0] != EVENT_TRACE_SESSION) {
+    startSession(start, header[5], header[6], &header[7], header[7 + EVENT_TRACE_SETTINGS_SIZE],
+                 header[8 + EVENT_TRACE_SETTINGS_SIZE]);
+  }
+
+  host_reset_counters();
+
+  for(int offset = 0; offset < length; ) {
+    const uint8_t* record = &records[offset];
+    int recordSize = EventTrace_recordSize(record, length - offset);
+
+    if(recordSize == 0) {
+      fprintf(stderr, "damaged record at offset %d\n", offset);
+      return 2;
+    }
+
+    if(record[0] == EVENT_TRACE_SESSION || record[0] == EVENT_TRACE_TIME) {
+      t = readUint32(&record[1]);
+    } else {
+      t += readUint16(&record[1]);
+    }
+
+    const uint8_t* nightMode = findNightMode(record + recordSize, length - offset - recordSize);
+
+    if(nightMode) {
+      // only the last tick of a run is the one that noticed
+      if(record[0] == EVENT_TRACE_TICKS && isRunning) {
+        advanceTo(t - 1);
+      }
+
+      applySleep(nightMode[3]);
+    }
+
+    if(record[0] == EVENT_TRACE_SESSION) {
+      HostCounters counters = host_counters;
+
+      startSession(t, record[5], record[6], &record[7], record[7 + EVENT_TRACE_SETTINGS_SIZE],
+                   record[8 + EVENT_TRACE_SETTINGS_SIZE]);
+      sessions++;
+
+      // launching the face isn't part of what is being replayed
+      host_counters = counters;
+    } else {
+      replayRecord(record, t);
+    }
+
+    offset += recordSize;
+  }
+
+  HostCounters replayed = host_counters;
+
+  if(isRunning) {
+    deinit();
+  }
+
+  fprintf(stdout, "\nreplayed %s", formatTime(start));
+  fprintf(stdout, " to %s, %d launches\n", formatTime(t), sessions);
+  fprintf(stdout, "ticks:             %u recorded, %u replayed\n", recordedTicks, replayed.ticks);
+  fprintf(stdout, "frames:            %u (%u layer renders, %u dirty marks)\n",
+          replayed.frames, replayed.layerRenders, replayed.dirtyMarks);
+  fprintf(stdout, "pixels written:    %u\n", replayed.pixelsWritten);
+  fprintf(stdout, "storage writes:    %u (%u bytes)\n", replayed.persistWrites, replayed.persistBytesWritten);
+  fprintf(stdout, "messages:          %u received, %u sent, %u possible duplicates\n",
+          replayed.messagesReceived, replayed.messagesSent, duplicateSends);
+  fprintf(stdout, "vibrations:        %u\n", replayed.vibes);
+
+  free(trace);
+
+  // a replay that didn't follow the recording can't be trusted
+  return (recordedTicks != replayed.ticks || settingsMismatches > 0 || nightModeMismatches > 0 ||
+          tickRateMismatches > 0) ? 1 : 0;
+}
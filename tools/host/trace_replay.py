@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#
+# Replays an event trace recorded on a watch through a host build of the
+# watchface, to reproduce what it did: when it redrew, what it wrote to
+# storage, and when it sent messages to the phone.
+#
+# The face writes its trace to the log when it exits, so a trace can be
+# captured with
+#
+#   pebble logs > watch.log      ...then switch to another watchface
+#   tools/host/trace_replay.py --platform basalt watch.log
+#
+# A binary trace (as saved by day_sim --save-trace) works too.
+#
+#   tools/host/trace_replay.py --check    replay day_sim's traces, fail if any diverge
+#
+# Requires gcc, libpng and zlib.
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from host_build import PLATFORMS, build
+
+TRACE_LINE = re.compile(r'event trace: (.*)$')
+
+# simulated days whose traces must replay exactly; name -> arguments for day_sim
+CHECKS = {
+    'minute-ticks':    ['--widgets', '10,7,13'],
+    # the buffer wraps while the seconds widget ticks, and night mode and the
+    # battery switch it between second and minute ticks
+    'seconds-wrapped': ['--widgets', '5,10,14', '--night-mode'],
+}
+
+
+def trace_from_log(text):
+    """Returns the bytes of the last complete trace in a log, or None"""
+    trace = None
+    current = None
+
+    for line in text.splitlines():
+        match = TRACE_LINE.search(line)
+
+        if not match:
+            continue
+
+        body = match.group(1).strip()
+
+        if body.startswith('begin'):
+            current = []
+        elif body == 'end':
+            if current is not None:
+                trace = bytes.fromhex(''.join(current))
+            current = None
+        elif current is not None:
+            current.append(body)
+
+    return trace
+
+
+def read_trace(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    try:
+        text = data.decode('utf-8')
+    except UnicodeDecodeError:
+        return data
+
+    trace = trace_from_log(text)
+    return trace if trace is not None else data
+
+
+def check(platforms):
+    """Replays the trace of every simulated day in CHECKS; returns True if they all followed the recording"""
+    env = dict(os.environ, LC_ALL='C')
+    ok = True
+
+    for platform in platforms:
+        day_sim = build(platform, 'day_sim')
+        replay = build(platform, 'trace_replay')
+
+        for name, arguments in CHECKS.items():
+            with tempfile.TemporaryDirectory() as directory:
+                path = os.path.join(directory, 'trace.bin')
+                subprocess.check_call([day_sim] + arguments + ['--save-trace', path],
+                                      stdout=subprocess.DEVNULL, env=env)
+                result = subprocess.run([replay, path], stdout=subprocess.PIPE, env=env,
+                                        universal_newlines=True)
+
+            print('%-8s %-17s %s' % (platform, name, 'ok' if result.returncode == 0 else 'FAILED'))
+
+            if result.returncode != 0:
+                print(result.stdout)
+                ok = False
+
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Replay a recorded event trace through the watchface.')
+    parser.add_argument('trace', nargs='?', help='log containing an event trace, or a binary trace file')
+    parser.add_argument('--platform', choices=PLATFORMS,
+                        help='platform the trace was recorded on (default: basalt; with --check, all of them)')
+    parser.add_argument('--verbose', action='store_true', help='print every replayed event')
+    parser.add_argument('--check', action='store_true',
+                        help="replay the traces of day_sim's simulated days instead, and fail if any diverge")
+    args = parser.parse_args()
+
+    if args.check:
+        return 0 if check([args.platform] if args.platform else PLATFORMS) else 1
+
+    if not args.trace:
+        parser.error('a trace is needed, unless --check is given')
+
+    trace = read_trace(args.trace)
+    binary = build(args.platform or 'basalt', 'trace_replay')
+
+    with tempfile.NamedTemporaryFile(suffix='.bin') as f:
+        f.write(trace)
+        f.flush()
+
+        command = [binary, f.name] + (['--verbose'] if args.verbose else [])
+        return subprocess.call(command, env=dict(os.environ, LC_ALL='C'))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
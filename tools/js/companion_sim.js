@@ -0,0 +1,507 @@
+#!/usr/bin/env node
+//
+// Runs the phone side of the watchface (src/js/messaging.js) through
+// scripted scenarios, with the phone faked around it: a clock that only
+// moves when the scenario says so, localStorage, the position service, the
+// network, and a watch that asks for weather and acknowledges messages.
+// Counts what the script did in each scenario -- web requests, position
+// lookups, messages sent to the watch -- and fails if any count is outside
+// the limits the scenario sets.
+//
+//   tools/js/companion_sim.js                  runs every scenario
+//   tools/js/companion_sim.js flaky_network    runs just that one
+//   tools/js/companion_sim.js --verbose ...    also prints the script's log
+//   tools/js/companion_sim.js --script FILE    runs another copy of the script
+//
+// Scenarios live in tools/js/scenarios. Requires node.
+
+var fs = require('fs');
+var path = require('path');
+var vm = require('vm');
+
+var REPO_DIR = path.resolve(__dirname, '..', '..');
+var DEFAULT_SCRIPT_PATH = path.join(REPO_DIR, 'src', 'js', 'messaging.js');
+var SCENARIO_DIR = path.join(__dirname, 'scenarios');
+
+// Monday 2016-03-14 00:00:00 UTC, the same day the host tools simulate
+var DAY_START = 1457913600000;
+
+var MINUTE = 60 * 1000;
+var HOUR = 60 * MINUTE;
+
+// a small deterministic generator, so that every run retries the same way
+function makeRandom(seed) {
+  var state = seed >>> 0;
+
+  return function() {
+    state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+    return state / 4294967296;
+  };
+}
+
+/*
+ * The answers the fake weather service gives by default: yahoo's reverse
+ * geocoding and forecast queries, in the shape the yahoo provider reads
+ */
+function yahooResponse(url) {
+  var query = decodeURIComponent(url.split('?q=')[1] || '');
+
+  // forecasts for a typed location look the place up in a subquery, so
+  // check for those first
+  if(query.indexOf('from weather.forecast') !== -1) {
+    return {status: 200, body: {query: {count: 1, results: {channel: {item: {
+      condition: {temp: '12', code: '30'},
+      forecast: {code: '11', high: '18', low: '9'}
+    }}}}}};
+  }
+
+  if(query.indexOf('from geo.places') !== -1) {
+    return {status: 200, body: {query: {count: 1, results: {place: {woeid: '12345'}}}}};
+  }
+
+  return {status: 404, body: ''};
+}
+
+/*
+ * A phone with the script loaded. Scenarios drive it through the methods
+ * below, and can swap in their own network, position and watch behaviour.
+ */
+function Phone(options) {
+  var phone = this;
+
+  this.now = DAY_START;
+  this.timers = [];
+  this.nextTimerId = 1;
+  this.store = {};
+  this.listeners = {};
+  this.verbose = options.verbose;
+  this.random = makeRandom(options.seed || 1);
+
+  this.counts = {
+    requests: 0,
+    failedRequests: 0,
+    geolocations: 0,
+    appMessages: 0,
+    appMessagesDelivered: 0,
+    weatherDelivered: 0,
+    settingsDelivered: 0
+  };
+
+  // how the outside world answers; scenarios replace these as they need
+  this.position = {latitude: 47.61, longitude: -122.33};
+
+  // returns {status, body, delay}, or null for a request that never finishes
+  this.network = function(url) {
+    return yahooResponse(url);
+  };
+
+  // returns null with a position, or an error code (1 is permission denied)
+  this.locate = function() {
+    return null;
+  };
+
+  // returns true if the watch acknowledges a message
+  this.watchAccepts = function(dictionary) {
+    return true;
+  };
+
+  // everything the script would find on a phone
+  var sandbox = {
+    console: {
+      log: function() {
+        var line = Array.prototype.join.call(arguments, ' ');
+
+        if(phone.verbose) {
+          console.log('  [' + phone.clockText() + '] ' + line);
+        }
+      }
+    },
+
+    setTimeout: function(callback, delay) {
+      return phone.addTimer(callback, delay);
+    },
+
+    clearTimeout: function(id) {
+      phone.timers = phone.timers.filter(function(timer) {
+        return timer.id !== id;
+      });
+    },
+
+    Date: phone.fakeDate(),
+    Math: Object.create(Math, {random: {value: phone.random}}),
+
+    window: {
+      localStorage: {
+        getItem: function(key) {
+          return phone.store.hasOwnProperty(key) ? phone.store[key] : null;
+        },
+        setItem: function(key, value) {
+          phone.store[key] = String(value);
+        },
+        removeItem: function(key) {
+          delete phone.store[key];
+        }
+      }
+    },
+
+    navigator: {
+      geolocation: {
+        getCurrentPosition: function(onSuccess, onError, options) {
+          phone.counts.geolocations++;
+
+          var error = phone.locate();
+
+          phone.addTimer(function() {
+            if(error) {
+              onError({code: error, message: 'position unavailable (' + error + ')'});
+            } else {
+              onSuccess({coords: phone.position, timestamp: phone.now});
+            }
+          }, 500);
+        }
+      }
+    },
+
+    XMLHttpRequest: function() {
+      return phone.fakeRequest();
+    },
+
+    Pebble: {
+      addEventListener: function(name, callback) {
+        phone.listeners[name] = callback;
+      },
+
+      sendAppMessage: function(dictionary, onSuccess, onFailure) {
+        phone.counts.appMessages++;
+
+        var accepted = phone.watchAccepts(dictionary);
+
+        phone.addTimer(function() {
+          if(accepted) {
+            phone.counts.appMessagesDelivered++;
+
+            if(dictionary.KEY_WEATHER_DATA) {
+              phone.counts.weatherDelivered++;
+            }
+
+            if(Object.keys(dictionary).some(function(key) { return key.indexOf('KEY_SETTING') === 0; })) {
+              phone.counts.settingsDelivered++;
+            }
+
+            onSuccess({data: {transactionId: phone.counts.appMessages}});
+          } else {
+            onFailure({data: {transactionId: phone.counts.appMessages}, error: {message: 'nack'}});
+          }
+        }, 200);
+      },
+
+      getActiveWatchInfo: function() {
+        return {platform: 'basalt'};
+      },
+
+      openURL: function(url) {}
+    }
+  };
+
+  vm.createContext(sandbox);
+  vm.runInContext(fs.readFileSync(options.script, 'utf8'), sandbox, {filename: options.script});
+}
+
+// a Date that reads the fake clock when asked for the current time
+Phone.prototype.fakeDate = function() {
+  var phone = this;
+
+  function FakeDate() {
+    if(arguments.length === 0) {
+      return new Date(phone.now);
+    }
+
+    return new (Function.prototype.bind.apply(Date, [null].concat(Array.prototype.slice.call(arguments))))();
+  }
+
+  FakeDate.now = function() {
+    return phone.now;
+  };
+
+  return FakeDate;
+};
+
+Phone.prototype.fakeRequest = function() {
+  var phone = this;
+  var timer = null;
+  var xhr = {status: 0, responseText: ''};
+
+  xhr.open = function(type, url) {
+    xhr.url = url;
+  };
+
+  xhr.send = function() {
+    phone.counts.requests++;
+
+    var response = phone.network(xhr.url);
+
+    // a request nobody answers is left for the script's own timeout
+    if(!response) {
+      return;
+    }
+
+    timer = phone.addTimer(function() {
+      timer = null;
+
+      if(response.status === 0) {
+        phone.counts.failedRequests++;
+        xhr.onerror();
+        return;
+      }
+
+      if(response.status < 200 || response.status >= 300) {
+        phone.counts.failedRequests++;
+      }
+
+      xhr.status = response.status;
+      xhr.responseText = (typeof response.body === 'string') ? response.body : JSON.stringify(response.body);
+      xhr.onload();
+    }, response.delay || 300);
+  };
+
+  xhr.abort = function() {
+    phone.counts.failedRequests++;
+
+    if(timer !== null) {
+      phone.timers = phone.timers.filter(function(t) { return t.id !== timer; });
+      timer = null;
+    }
+  };
+
+  return xhr;
+};
+
+Phone.prototype.addTimer = function(callback, delay) {
+  var id = this.nextTimerId++;
+  this.timers.push({id: id, time: this.now + Math.max(0, delay || 0), callback: callback});
+  return id;
+};
+
+// moves the clock forward, running every timer that comes due on the way
+Phone.prototype.advance = function(milliseconds) {
+  var end = this.now + milliseconds;
+
+  for(;;) {
+    var next = null;
+
+    this.timers.forEach(function(timer) {
+      if(timer.time <= end && (!next || timer.time < next.time)) {
+        next = timer;
+      }
+    });
+
+    if(!next) {
+      break;
+    }
+
+    this.timers.splice(this.timers.indexOf(next), 1);
+    this.now = Math.max(this.now, next.time);
+    next.callback();
+  }
+
+  this.now = end;
+};
+
+Phone.prototype.clockText = function() {
+  return new Date(this.now).toISOString().substr(11, 8);
+};
+
+Phone.prototype.dispatch = function(name, event) {
+  if(this.listeners[name]) {
+    this.listeners[name](event);
+  }
+};
+
+// the face starts, and the script with it
+Phone.prototype.launch = function() {
+  this.dispatch('ready', {});
+};
+
+// the watch asks for weather, as it does every half hour, with anything
+// else the payload adds
+Phone.prototype.watchRequest = function(payload) {
+  var request = {KEY_REQUEST_WEATHER: 1};
+
+  for(var key in payload) {
+    request[key] = payload[key];
+  }
+
+  this.dispatch('appmessage', {payload: request});
+};
+
+// the configuration page is closed with the given settings
+Phone.prototype.saveConfig = function(config) {
+  this.dispatch('webviewclosed', {response: encodeURIComponent(JSON.stringify(config))});
+};
+
+/*
+ * Runs a day (or the given number of hours) as the watch sees it: a request
+ * for weather every half hour, with each minute's timers run in between
+ */
+Phone.prototype.runDay = function(hours, onMinute) {
+  var minutes = (hours || 24) * 60;
+
+  for(var minute = 0; minute < minutes; minute++) {
+    if(onMinute) {
+      onMinute(minute);
+    }
+
+    if(minute % 30 === 0) {
+      this.watchRequest();
+    }
+
+    this.advance(MINUTE);
+  }
+};
+
+// settings as the configuration page sends them, with weather on
+function defaultConfig() {
+  return {
+    color_bg: '000000',
+    color_sidebar: 'ff5500',
+    color_time: 'ff5500',
+    sidebar_text_color: '000000',
+    language_id: 0,
+    leading_zero_setting: 'no',
+    clock_font_setting: 'default',
+    bluetooth_vibe_setting: 'no',
+    hourly_vibe_setting: 'no',
+    widget_0_id: 7,
+    widget_1_id: 0,
+    widget_2_id: 4,
+    sidebar_position: 'right',
+    use_large_sidebar_font_setting: 'no',
+    units: 'c',
+    weather_loc: '',
+    battery_meter_setting: 'icon-only',
+    altclock_name: 'ALT',
+    altclock_offset: '0',
+    decimal_separator: '.',
+    health_use_distance: 'no',
+    health_use_restful_sleep: 'no'
+  };
+}
+
+function loadScenarios(names) {
+  var files = fs.readdirSync(SCENARIO_DIR).filter(function(name) {
+    return /\.js$/.test(name);
+  }).sort();
+
+  return files.filter(function(file) {
+    return names.length === 0 || names.indexOf(path.basename(file, '.js')) !== -1;
+  }).map(function(file) {
+    var scenario = require(path.join(SCENARIO_DIR, file));
+    scenario.id = path.basename(file, '.js');
+    return scenario;
+  });
+}
+
+// returns a description of every count outside the scenario's limits
+function checkLimits(scenario, counts) {
+  var failures = [];
+
+  Object.keys(scenario.limits || {}).forEach(function(key) {
+    var limit = scenario.limits[key];
+
+    if(limit.max !== undefined && counts[key] > limit.max) {
+      failures.push(key + ' ' + counts[key] + ' > ' + limit.max);
+    }
+
+    if(limit.min !== undefined && counts[key] < limit.min) {
+      failures.push(key + ' ' + counts[key] + ' < ' + limit.min);
+    }
+  });
+
+  return failures;
+}
+
+function pad(text, width) {
+  text = String(text);
+  return text.length >= width ? text : text + new Array(width - text.length + 1).join(' ');
+}
+
+function padLeft(text, width) {
+  text = String(text);
+  return text.length >= width ? text : new Array(width - text.length + 1).join(' ') + text;
+}
+
+function main() {
+  var args = process.argv.slice(2);
+  var verbose = false;
+  var script = DEFAULT_SCRIPT_PATH;
+  var names = [];
+
+  for(var i = 0; i < args.length; i++) {
+    if(args[i] === '--verbose') {
+      verbose = true;
+    } else if(args[i] === '--script' && i + 1 < args.length) {
+      script = path.resolve(args[++i]);
+    } else if(args[i].indexOf('--') !== 0) {
+      names.push(args[i]);
+    } else {
+      console.error('usage: companion_sim.js [--verbose] [--script FILE] [SCENARIO...]');
+      return 2;
+    }
+  }
+  var scenarios = loadScenarios(names);
+
+  if(scenarios.length === 0) {
+    console.error('no scenarios match ' + names.join(', '));
+    return 2;
+  }
+
+  var failed = 0;
+
+  console.log(pad('scenario', 24) + padLeft('requests', 10) + padLeft('failed', 8) +
+              padLeft('positions', 11) + padLeft('messages', 10) + padLeft('weather', 9) +
+              padLeft('settings', 10) + padLeft('ms', 7));
+
+  scenarios.forEach(function(scenario) {
+    if(verbose) {
+      console.log(scenario.id + ': ' + scenario.description);
+    }
+
+    var started = process.hrtime();
+    var phone = new Phone({verbose: verbose, seed: scenario.seed, script: script});
+
+    scenario.run(phone, {defaultConfig: defaultConfig, MINUTE: MINUTE, HOUR: HOUR});
+
+    var elapsed = process.hrtime(started);
+    var c = phone.counts;
+
+    console.log(pad(scenario.id, 24) + padLeft(c.requests, 10) + padLeft(c.failedRequests, 8) +
+                padLeft(c.geolocations, 11) + padLeft(c.appMessages, 10) + padLeft(c.weatherDelivered, 9) +
+                padLeft(c.settingsDelivered, 10) +
+                padLeft(Math.round(elapsed[0] * 1000 + elapsed[1] / 1e6), 7));
+
+    var failures = checkLimits(scenario, c);
+
+    failures.forEach(function(failure) {
+      console.log('  outside the limits: ' + failure);
+    });
+
+    if(failures.length > 0) {
+      failed++;
+    }
+  });
+
+  console.log('');
+  console.log(failed === 0 ? 'all scenarios within limits' : failed + ' scenario(s) outside their limits');
+
+  return failed === 0 ? 0 : 1;
+}
+
+module.exports = {
+  Phone: Phone,
+  yahooResponse: yahooResponse,
+  defaultConfig: defaultConfig
+};
+
+if(require.main === module) {
+  process.exit(main());
+}
@@ -0,0 +1,29 @@
+// the wearer won't share their position: until they type in a location,
+// there's no weather to get, and asking again and again only costs power
+module.exports = {
+  description: 'position permission denied all morning, then a location typed in at noon',
+
+  run: function(phone, sim) {
+    phone.locate = function() {
+      return 1;
+    };
+
+    phone.launch();
+    phone.saveConfig(sim.defaultConfig());
+    phone.runDay(12);
+
+    var config = sim.defaultConfig();
+    config.weather_loc = 'Seattle, WA';
+
+    phone.saveConfig(config);
+    phone.runDay(12);
+  },
+
+  // no more than one position lookup per request while it's denied, none
+  // once there's a typed location, and weather from then on
+  limits: {
+    geolocations: {max: 24},
+    requests: {max: 26},
+    weatherDelivered: {min: 23}
+  }
+};
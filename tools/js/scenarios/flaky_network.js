@@ -0,0 +1,41 @@
+// the same day on a bad connection: web requests fail, stall or come back
+// with errors, and the watch misses some messages
+var yahooResponse = require('../companion_sim.js').yahooResponse;
+
+module.exports = {
+  description: 'a day with a third of web requests and a fifth of watch messages failing',
+  seed: 7,
+
+  run: function(phone, sim) {
+    phone.network = function(url) {
+      var roll = phone.random();
+
+      if(roll < 0.1) {
+        return null;                                // never answered
+      } else if(roll < 0.2) {
+        return {status: 0};                         // connection dropped
+      } else if(roll < 0.33) {
+        return {status: 503, body: 'unavailable'};
+      }
+
+      return yahooResponse(url);
+    };
+
+    phone.watchAccepts = function() {
+      return phone.random() >= 0.2;
+    };
+
+    phone.launch();
+    phone.saveConfig(sim.defaultConfig());
+    phone.runDay(24);
+  },
+
+  // retries may at most double the traffic of a normal day, and most
+  // weather should still get through
+  limits: {
+    requests: {max: 100},
+    geolocations: {max: 24},
+    appMessages: {max: 100},
+    weatherDelivered: {min: 40}
+  }
+};
@@ -0,0 +1,20 @@
+// an ordinary day: the settings are saved once, the face runs from midnight,
+// and the watch asks for weather every half hour with everything working
+module.exports = {
+  description: 'a day of half-hourly weather requests, with nothing failing',
+
+  run: function(phone, sim) {
+    phone.launch();
+    phone.saveConfig(sim.defaultConfig());
+    phone.runDay(24);
+  },
+
+  // a forecast per half-hourly request and one place lookup; the position
+  // is checked at most hourly; every weather message gets through
+  limits: {
+    requests: {max: 50},
+    geolocations: {max: 24},
+    appMessages: {max: 50},
+    weatherDelivered: {min: 48}
+  }
+};
@@ -0,0 +1,39 @@
+// the settings page saved over and over: only what changed should reach
+// the watch, and the weather shouldn't be fetched again for each save
+module.exports = {
+  description: 'twenty saves of the same settings, then a changed color saved five times',
+
+  run: function(phone, sim) {
+    var config = sim.defaultConfig();
+
+    phone.launch();
+    phone.saveConfig(config);
+    phone.advance(sim.HOUR);
+
+    for(var i = 0; i < 20; i++) {
+      phone.saveConfig(config);
+      phone.advance(5 * 1000);
+    }
+
+    config.color_time = '00aaff';
+
+    for(i = 0; i < 5; i++) {
+      phone.saveConfig(config);
+      phone.advance(5 * 1000);
+    }
+
+    // a reinstalled face has lost its settings, and asks for all of them
+    phone.watchRequest({KEY_SETTINGS_NEEDED: 1});
+    phone.advance(sim.MINUTE);
+    phone.saveConfig(config);
+    phone.advance(sim.MINUTE);
+  },
+
+  // the settings go out three times: when first saved, when the color
+  // changes, and after the reinstall. the weather is fetched at most twice
+  limits: {
+    settingsDelivered: {max: 3},
+    appMessages: {max: 8},
+    requests: {max: 4}
+  }
+};
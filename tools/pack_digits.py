@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+#
+# Packs the clock digit images into run-length encoded glyph blobs that the
+# face blits straight into the framebuffer (see src/clock_glyphs.h), so that
+# showing a digit doesn't mean allocating and decoding a bitmap.
+#
+# Each blob holds a colour section (four gray levels, 2 bits per pixel) and a
+# black & white section (two levels, 1 bit per pixel), quantized the same way
+# the SDK's resource compiler quantizes the PNGs. Rerun this whenever the
+# digit images change:
+#
+#   tools/pack_digits.py
+#
+# Needs nothing beyond the python standard library.
+
+import os
+import struct
+import sys
+import zlib
+
+REPO_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+IMAGES_DIR = os.path.join(REPO_DIR, 'resources', 'images')
+DATA_DIR = os.path.join(REPO_DIR, 'resources', 'data')
+
+# image name prefix -> blob name
+FONTS = [('digit_', 'digits_default'),
+         ('digit_leco_', 'digits_leco'),
+         ('digit_bold_', 'digits_bold')]
+
+HEADER_SIZE = 10
+SECTION_HEADER_SIZE = 2 + 10 * 2
+
+
+def read_png(path):
+    """Returns the width, height and rows of gray values of an 8-bit RGB(A) or gray PNG"""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    pos = 8
+    idat = b''
+
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+
+        if kind == b'IHDR':
+            width, height, depth, colorType, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+        elif kind == b'IDAT':
+            idat += chunk
+
+    channels = {0: 1, 2: 3, 4: 2, 6: 4}.get(colorType)
+
+    if depth != 8 or interlace != 0 or channels is None:
+        sys.exit('%s: only 8-bit, non-interlaced gray or RGB images are supported' % path)
+
+    raw = zlib.decompress(idat)
+    stride = width * channels
+    previous = bytearray(stride)
+    rows = []
+
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        line = bytearray(raw[start + 1:start + 1 + stride])
+
+        for x in range(stride):
+            a = line[x - channels] if x >= channels else 0
+            b = previous[x]
+            c = previous[x - channels] if x >= channels else 0
+
+            if kind == 1:
+                line[x] = (line[x] + a) & 0xFF
+            elif kind == 2:
+                line[x] = (line[x] + b) & 0xFF
+            elif kind == 3:
+                line[x] = (line[x] + (a + b) // 2) & 0xFF
+            elif kind == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                line[x] = (line[x] + (a if pa <= pb and pa <= pc else b if pb <= pc else c)) & 0xFF
+
+        # the digits are drawn in gray, so the first channel is the gray level
+        rows.append([line[x * channels] for x in range(width)])
+        previous = line
+
+    return width, height, rows
+
+
+def pack_section(glyphs, levels):
+    """Encodes the ten glyphs at the given number of gray levels"""
+    quantized = [[[(gray * (levels - 1) + 127) // 255 for gray in row] for row in rows] for rows in glyphs]
+
+    # as in a bitmap palette, the levels used become entries, darkest first
+    used = sorted(set(value for rows in quantized for row in rows for value in row))
+    index = dict((level, i) for i, level in enumerate(used))
+    bpp = 1 if len(used) <= 2 else 2
+    maxRun = 1 << (8 - bpp)
+
+    offsets = []
+    runs = bytearray()
+
+    for rows in quantized:
+        offsets.append(SECTION_HEADER_SIZE + len(runs))
+
+        # runs never cross a row, so every row starts on a byte
+        for row in rows:
+            x = 0
+
+            while x < len(row):
+                count = 1
+
+                while x + count < len(row) and row[x + count] == row[x] and count < maxRun:
+                    count += 1
+
+                runs.append(((count - 1) << bpp) | index[row[x]])
+                x += count
+
+    return struct.pack('<BB10H', bpp, len(used), *offsets) + bytes(runs)
+
+
+def pack_font(prefix):
+    glyphs = []
+    size = None
+
+    for number in range(10):
+        width, height, rows = read_png(os.path.join(IMAGES_DIR, '%s%d.png' % (prefix, number)))
+
+        if size not in (None, (width, height)):
+            sys.exit('%s%d.png is not the same size as the other digits' % (prefix, number))
+
+        size = (width, height)
+        glyphs.append(rows)
+
+    color = pack_section(glyphs, 4)
+    bw = pack_section(glyphs, 2)
+    header = struct.pack('<BBHHHH', size[0], size[1], HEADER_SIZE, len(color),
+                         HEADER_SIZE + len(color), len(bw))
+
+    return header + color + bw
+
+
+def main():
+    for prefix, name in FONTS:
+        blob = pack_font(prefix)
+        path = os.path.join(DATA_DIR, name + '.bin')
+
+        with open(path, 'wb') as f:
+            f.write(blob)
+
+        print('%s: %d bytes' % (os.path.relpath(path, REPO_DIR), len(blob)))
+
+
+if __name__ == '__main__':
+    main()